@@ -9,17 +9,40 @@
 
 #include <math.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include <functional>
+#include <memory>
+#include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "google/ads/googleads/v16/services/google_ads_service.upbdefs.h"
 #include "google/protobuf/descriptor.pb.h"
+#include "absl/base/casts.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/absl_check.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "google/protobuf/descriptor_database.h"
 #include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/io/gzip_stream.h"
+#include "google/protobuf/io/strtod.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/json/json.h"
+#include "google/protobuf/map.h"
+#include "google/protobuf/util/delimited_message_util.h"
+#include "google/protobuf/util/field_access_plan.h"
+#include "google/protobuf/util/parallel_message_util.h"
+#include "google/protobuf/util/type_resolver.h"
+#include "google/protobuf/util/type_resolver_util.h"
 #include "benchmarks/descriptor.pb.h"
 #include "benchmarks/descriptor.upb.h"
 #include "benchmarks/descriptor.upbdefs.h"
@@ -240,6 +263,191 @@ static void BM_LoadAdsDescriptor_Proto2(benchmark::State& state) {
 BENCHMARK_TEMPLATE(BM_LoadAdsDescriptor_Proto2, NoLayout);
 BENCHMARK_TEMPLATE(BM_LoadAdsDescriptor_Proto2, WithLayout);
 
+// Startup with a pool that builds the Ads files lazily, as the generated pool
+// does, from either the per-file encoded descriptors or a precompiled image.
+enum LazyDatabaseMode {
+  Encoded,
+  Image,
+};
+
+template <LazyDatabaseMode DbMode, LoadDescriptorMode Mode>
+static void BM_LazyLoadAdsDescriptor_Proto2(benchmark::State& state) {
+  extern _upb_DefPool_Init
+      google_ads_googleads_v16_services_google_ads_service_proto_upbdefinit;
+  std::vector<upb_StringView> serialized_files;
+  absl::flat_hash_set<const _upb_DefPool_Init*> seen_files;
+  CollectFileDescriptors(
+      &google_ads_googleads_v16_services_google_ads_service_proto_upbdefinit,
+      serialized_files, seen_files);
+  protobuf::FileDescriptorSet file_set;
+  for (auto file : serialized_files) {
+    ABSL_CHECK(file_set.add_file()->ParseFromArray(file.data, file.size));
+  }
+  std::string image;
+  ABSL_CHECK(protobuf::DescriptorImageDatabase::Serialize(file_set, &image));
+
+  for (auto _ : state) {
+    protobuf::EncodedDescriptorDatabase encoded_db;
+    protobuf::DescriptorImageDatabase image_db;
+    protobuf::DescriptorDatabase* db;
+    if (DbMode == Encoded) {
+      for (auto file : serialized_files) {
+        encoded_db.Add(file.data, static_cast<int>(file.size));
+      }
+      db = &encoded_db;
+    } else {
+      ABSL_CHECK(image_db.Load(image.data(), image.size()));
+      db = &image_db;
+    }
+    protobuf::DescriptorPool pool(db);
+    const protobuf::Descriptor* d = pool.FindMessageTypeByName(
+        "google.ads.googleads.v16.services.SearchGoogleAdsResponse");
+    ABSL_CHECK(d != nullptr);
+    if (Mode == WithLayout) {
+      protobuf::DynamicMessageFactory factory;
+      factory.GetPrototype(d);
+    }
+  }
+  state.counters["image_bytes"] = image.size();
+}
+BENCHMARK_TEMPLATE(BM_LazyLoadAdsDescriptor_Proto2, Encoded, NoLayout);
+BENCHMARK_TEMPLATE(BM_LazyLoadAdsDescriptor_Proto2, Encoded, WithLayout);
+BENCHMARK_TEMPLATE(BM_LazyLoadAdsDescriptor_Proto2, Image, NoLayout);
+BENCHMARK_TEMPLATE(BM_LazyLoadAdsDescriptor_Proto2, Image, WithLayout);
+
+// Reflection-driven lookups of already-built symbols in the generated pool,
+// from many threads at once.
+static void BM_FindByName_GeneratedPool(benchmark::State& state) {
+  const protobuf::DescriptorPool* pool =
+      protobuf::DescriptorPool::generated_pool();
+  const protobuf::FileDescriptor* file =
+      protobuf::FileDescriptorProto::descriptor()->file();
+  std::vector<std::string> message_names;
+  std::vector<std::string> field_names;
+  for (int i = 0; i < file->message_type_count(); i++) {
+    const protobuf::Descriptor* message = file->message_type(i);
+    message_names.push_back(message->full_name());
+    for (int j = 0; j < message->field_count(); j++) {
+      field_names.push_back(message->field(j)->full_name());
+    }
+  }
+  for (auto _ : state) {
+    for (const std::string& name : message_names) {
+      benchmark::DoNotOptimize(pool->FindMessageTypeByName(name));
+    }
+    for (const std::string& name : field_names) {
+      benchmark::DoNotOptimize(pool->FindFieldByName(name));
+    }
+    benchmark::DoNotOptimize(pool->FindFileByName(file->name()));
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          (message_names.size() + field_names.size() + 1));
+}
+BENCHMARK(BM_FindByName_GeneratedPool)->Threads(1)->Threads(8)->Threads(64);
+
+static void AddMessageTypes(const protobuf::Descriptor* type,
+                            std::vector<const protobuf::Descriptor*>* types) {
+  types->push_back(type);
+  for (int i = 0; i < type->nested_type_count(); i++) {
+    AddMessageTypes(type->nested_type(i), types);
+  }
+}
+
+static void BM_GetPrototype_DynamicFactory(benchmark::State& state) {
+  // Shared by all of the benchmark's threads, and prebuilt so that the loop
+  // only measures lookups of existing prototypes.
+  static const auto* types = [] {
+    auto* types = new std::vector<const protobuf::Descriptor*>;
+    const protobuf::FileDescriptor* file =
+        protobuf::FileDescriptorProto::descriptor()->file();
+    for (int i = 0; i < file->message_type_count(); i++) {
+      AddMessageTypes(file->message_type(i), types);
+    }
+    return types;
+  }();
+  static auto* factory = [] {
+    auto* factory = new protobuf::DynamicMessageFactory;
+    factory->PrebuildPrototypes(
+        protobuf::FileDescriptorProto::descriptor()->file());
+    return factory;
+  }();
+  for (auto _ : state) {
+    for (const protobuf::Descriptor* type : *types) {
+      benchmark::DoNotOptimize(factory->GetPrototype(type));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * types->size());
+}
+BENCHMARK(BM_GetPrototype_DynamicFactory)->Threads(1)->Threads(8)->Threads(64);
+
+enum FieldAccess {
+  UseReflection,
+  UsePlan,
+};
+
+// Reads a few fields, one of them nested, from every field of
+// descriptor.proto, as an exporter turning messages into columns would.
+template <FieldAccess Access>
+static void BM_ExtractFields_Proto2(benchmark::State& state) {
+  protobuf::FileDescriptorProto file;
+  file.ParseFromString(absl::string_view(descriptor.data, descriptor.size));
+  std::vector<const protobuf::Message*> fields;
+  for (const protobuf::DescriptorProto& message : file.message_type()) {
+    for (const protobuf::FieldDescriptorProto& field : message.field()) {
+      fields.push_back(&field);
+    }
+  }
+  std::vector<int32_t> numbers(fields.size());
+  std::vector<int32_t> types(fields.size());
+  std::vector<absl::string_view> names(fields.size());
+  std::unique_ptr<bool[]> packed(new bool[fields.size()]);
+
+  const protobuf::Descriptor* field_type =
+      protobuf::FieldDescriptorProto::descriptor();
+  const protobuf::FieldDescriptor* number =
+      field_type->FindFieldByName("number");
+  const protobuf::FieldDescriptor* type = field_type->FindFieldByName("type");
+  const protobuf::FieldDescriptor* name = field_type->FindFieldByName("name");
+  const protobuf::FieldDescriptor* options =
+      field_type->FindFieldByName("options");
+  const protobuf::FieldDescriptor* packed_field =
+      protobuf::FieldOptions::descriptor()->FindFieldByName("packed");
+  absl::StatusOr<protobuf::util::FieldAccessPlan> plan =
+      protobuf::util::FieldAccessPlan::Create(
+          protobuf::FieldDescriptorProto::default_instance(),
+          {"number", "type", "name", "options.packed"});
+  ABSL_CHECK_OK(plan.status());
+
+  for (auto _ : state) {
+    if (Access == UseReflection) {
+      for (size_t i = 0; i < fields.size(); i++) {
+        const protobuf::Message& field = *fields[i];
+        const protobuf::Reflection* reflection = field.GetReflection();
+        numbers[i] = reflection->GetInt32(field, number);
+        types[i] = reflection->GetEnumValue(field, type);
+        names[i] = reflection->GetStringReference(field, name, nullptr);
+        const protobuf::Message& field_options =
+            reflection->GetMessage(field, options);
+        packed[i] = field_options.GetReflection()->GetBool(field_options,
+                                                           packed_field);
+      }
+    } else {
+      plan->Extract<int32_t>(0, fields, absl::MakeSpan(numbers));
+      plan->Extract<int32_t>(1, fields, absl::MakeSpan(types));
+      plan->Extract<absl::string_view>(2, fields, absl::MakeSpan(names));
+      plan->Extract<bool>(3, fields,
+                          absl::MakeSpan(packed.get(), fields.size()));
+    }
+    benchmark::DoNotOptimize(numbers.data());
+    benchmark::DoNotOptimize(types.data());
+    benchmark::DoNotOptimize(names.data());
+    benchmark::DoNotOptimize(packed.get());
+  }
+  state.SetItemsProcessed(state.iterations() * fields.size());
+}
+BENCHMARK_TEMPLATE(BM_ExtractFields_Proto2, UseReflection);
+BENCHMARK_TEMPLATE(BM_ExtractFields_Proto2, UsePlan);
+
 enum CopyStrings {
   Copy,
   Alias,
@@ -249,6 +457,9 @@ enum ArenaMode {
   NoArena,
   UseArena,
   InitBlock,
+  BlockCache,
+  SizeHint,
+  HugePages,
 };
 
 template <ArenaMode AMode, CopyStrings Copy>
@@ -315,6 +526,22 @@ struct Proto2Factory<InitBlock, P> {
   protobuf::Arena arena;
 };
 
+template <class P>
+struct Proto2Factory<BlockCache, P> {
+ public:
+  Proto2Factory() : arena(GetOptions()) {}
+  P* GetProto() { return protobuf::Arena::Create<P>(&arena); }
+
+ private:
+  protobuf::ArenaOptions GetOptions() {
+    protobuf::ArenaOptions opts;
+    opts.thread_block_cache_size = 1 << 20;
+    return opts;
+  }
+
+  protobuf::Arena arena;
+};
+
 using FileDesc = ::upb_benchmark::FileDescriptorProto;
 using FileDescSV = ::upb_benchmark::sv::FileDescriptorProto;
 
@@ -339,8 +566,272 @@ void BM_Parse_Proto2(benchmark::State& state) {
 BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDesc, NoArena, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDesc, UseArena, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDesc, InitBlock, Copy);
+BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDesc, BlockCache, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDescSV, InitBlock, Alias);
 
+// Models a server that creates one arena per request: each iteration builds
+// an arena, grows it to `state.range(0)` bytes and destroys it.
+template <ArenaMode AMode>
+static void BM_ArenaPerRequest_Proto2(benchmark::State& state) {
+  const size_t request_bytes = state.range(0);
+  protobuf::ArenaOptions opts;
+  if (AMode == BlockCache) opts.thread_block_cache_size = 4 * request_bytes;
+  protobuf::ArenaSizeHint hint;
+  if (AMode == SizeHint) opts.size_hint = &hint;
+  for (auto _ : state) {
+    protobuf::Arena arena(opts);
+    for (size_t allocated = 0; allocated < request_bytes; allocated += 64) {
+      benchmark::DoNotOptimize(protobuf::Arena::CreateArray<char>(&arena, 64));
+    }
+  }
+  protobuf::Arena::ReleaseThreadBlockCache();
+}
+BENCHMARK_TEMPLATE(BM_ArenaPerRequest_Proto2, UseArena)
+    ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_ArenaPerRequest_Proto2, BlockCache)
+    ->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_ArenaPerRequest_Proto2, SizeHint)
+    ->Range(1 << 10, 1 << 20);
+
+enum ArenaReuse {
+  Recreate,
+  PlainReset,
+  RetainCapacity,
+};
+
+// Models a long-lived worker that handles one request after another with an
+// arena of `state.range(0)` bytes, either destroying and recreating the arena
+// or resetting it between requests.
+template <ArenaReuse kReuse>
+static void BM_ArenaReuse_Proto2(benchmark::State& state) {
+  const size_t request_bytes = state.range(0);
+  auto arena = std::make_unique<protobuf::Arena>();
+  for (auto _ : state) {
+    for (size_t allocated = 0; allocated < request_bytes; allocated += 64) {
+      benchmark::DoNotOptimize(
+          protobuf::Arena::CreateArray<char>(arena.get(), 64));
+    }
+    switch (kReuse) {
+      case Recreate:
+        arena = std::make_unique<protobuf::Arena>();
+        break;
+      case PlainReset:
+        arena->Reset();
+        break;
+      case RetainCapacity:
+        arena->ResetRetainingCapacity(2 * request_bytes);
+        break;
+    }
+  }
+}
+BENCHMARK_TEMPLATE(BM_ArenaReuse_Proto2, Recreate)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_ArenaReuse_Proto2, PlainReset)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_ArenaReuse_Proto2, RetainCapacity)
+    ->Range(1 << 10, 1 << 20);
+
+// Parses `state.range(0)` copies of descriptor.proto into a single arena and
+// then walks all of them, as a batch job holding a large arena would.
+template <ArenaMode AMode>
+static void BM_ParseAndTraverseLargeArena_Proto2(benchmark::State& state) {
+  protobuf::ArenaOptions opts;
+  opts.max_block_size = 1 << 20;
+  if (AMode == HugePages) opts.use_huge_page_blocks = true;
+  absl::string_view input(descriptor.data, descriptor.size);
+  for (auto _ : state) {
+    protobuf::Arena arena(opts);
+    std::vector<FileDesc*> protos;
+    for (int i = 0; i < state.range(0); ++i) {
+      FileDesc* proto = protobuf::Arena::Create<FileDesc>(&arena);
+      if (!proto->ParseFromString(input)) {
+        printf("Failed to parse.\n");
+        exit(1);
+      }
+      protos.push_back(proto);
+    }
+    size_t fields = 0;
+    for (const FileDesc* proto : protos) {
+      for (const auto& message : proto->message_type()) {
+        for (const auto& field : message.field()) {
+          fields += field.name().size();
+        }
+      }
+    }
+    benchmark::DoNotOptimize(fields);
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0) *
+                          descriptor.size);
+}
+BENCHMARK_TEMPLATE(BM_ParseAndTraverseLargeArena_Proto2, UseArena)
+    ->Range(64, 4096);
+BENCHMARK_TEMPLATE(BM_ParseAndTraverseLargeArena_Proto2, HugePages)
+    ->Range(64, 4096);
+
+enum VarintLength {
+  OneByte,
+  TwoBytes,
+  FiveBytes,
+  TenBytes,
+  MixedLengths,
+};
+
+static int32_t VarintValue(VarintLength length, int i) {
+  switch (length) {
+    case OneByte:
+      return i % 128;
+    case TwoBytes:
+      return 128 + i % 16000;
+    case FiveBytes:
+      return (1 << 28) + i;
+    case TenBytes:
+      return -1 - i;
+    case MixedLengths:
+      return i % 4 == 3 ? -i : i % 300;
+  }
+  return 0;
+}
+
+// Parses a packed int32 field of `state.range(0)` elements whose varints have
+// the given encoded length.
+template <VarintLength kLength>
+static void BM_ParsePackedVarint_Proto2(benchmark::State& state) {
+  upb_benchmark::SourceCodeInfo::Location location;
+  for (int i = 0; i < state.range(0); i++) {
+    location.add_path(VarintValue(kLength, i));
+  }
+  const std::string serialized = location.SerializeAsString();
+  upb_benchmark::SourceCodeInfo::Location parsed;
+  for (auto _ : state) {
+    parsed.ParseFromString(serialized);
+    benchmark::DoNotOptimize(parsed.path().data());
+  }
+  state.SetBytesProcessed(state.iterations() * serialized.size());
+}
+BENCHMARK_TEMPLATE(BM_ParsePackedVarint_Proto2, OneByte)->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_ParsePackedVarint_Proto2, TwoBytes)->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_ParsePackedVarint_Proto2, FiveBytes)
+    ->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_ParsePackedVarint_Proto2, TenBytes)->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_ParsePackedVarint_Proto2, MixedLengths)
+    ->Range(16, 1 << 16);
+
+// Sizes and serializes a packed int32 field of `state.range(0)` elements whose
+// varints have the given encoded length.
+template <VarintLength kLength>
+static void BM_SerializePackedVarint_Proto2(benchmark::State& state) {
+  upb_benchmark::SourceCodeInfo::Location location;
+  for (int i = 0; i < state.range(0); i++) {
+    location.add_path(VarintValue(kLength, i));
+  }
+  std::string serialized;
+  for (auto _ : state) {
+    location.SerializeToString(&serialized);
+    benchmark::DoNotOptimize(serialized.data());
+  }
+  state.SetBytesProcessed(state.iterations() * serialized.size());
+}
+BENCHMARK_TEMPLATE(BM_SerializePackedVarint_Proto2, OneByte)
+    ->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_SerializePackedVarint_Proto2, TwoBytes)
+    ->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_SerializePackedVarint_Proto2, FiveBytes)
+    ->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_SerializePackedVarint_Proto2, TenBytes)
+    ->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_SerializePackedVarint_Proto2, MixedLengths)
+    ->Range(16, 1 << 16);
+
+static void BM_MapInsert_Proto2(benchmark::State& state) {
+  for (auto _ : state) {
+    protobuf::Map<int64_t, int64_t> map;
+    for (int64_t i = 0; i < state.range(0); i++) {
+      map[i * 7919] = i;
+    }
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MapInsert_Proto2)->Range(16, 1 << 16);
+
+enum MapLookup { Hit, Miss };
+
+template <MapLookup kLookup>
+static void BM_MapLookup_Proto2(benchmark::State& state) {
+  protobuf::Map<std::string, int64_t> map;
+  std::vector<std::string> keys;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    map[absl::StrCat("key_", i)] = i;
+    keys.push_back(absl::StrCat(kLookup == Hit ? "key_" : "absent_", i));
+  }
+  for (auto _ : state) {
+    for (const auto& key : keys) {
+      benchmark::DoNotOptimize(map.find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_MapLookup_Proto2, Hit)->Range(16, 1 << 16);
+BENCHMARK_TEMPLATE(BM_MapLookup_Proto2, Miss)->Range(16, 1 << 16);
+
+static void BM_MapIterate_Proto2(benchmark::State& state) {
+  protobuf::Map<int64_t, int64_t> map;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    map[i] = i;
+  }
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (const auto& entry : map) {
+      sum += entry.second;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MapIterate_Proto2)->Range(16, 1 << 16);
+
+enum FloatValues { ShortDecimals, RandomBits };
+
+// Returns finite values that either print with a few digits, like most
+// hand-written values, or need all 17 (double) or 9 (float) digits.
+template <typename T, FloatValues kValues>
+static std::vector<T> MakeFloatValues() {
+  using Bits = std::conditional_t<sizeof(T) == 8, uint64_t, uint32_t>;
+  std::mt19937_64 random(12345);
+  std::vector<T> values;
+  while (values.size() < 1024) {
+    T value = kValues == ShortDecimals
+                  ? static_cast<T>(random() % 100000) / 100
+                  : absl::bit_cast<T>(static_cast<Bits>(random()));
+    if (std::isfinite(value)) values.push_back(value);
+  }
+  return values;
+}
+
+template <FloatValues kValues>
+static void BM_SimpleDtoa_Proto2(benchmark::State& state) {
+  std::vector<double> values = MakeFloatValues<double, kValues>();
+  for (auto _ : state) {
+    for (double value : values) {
+      benchmark::DoNotOptimize(protobuf::io::SimpleDtoa(value));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK_TEMPLATE(BM_SimpleDtoa_Proto2, ShortDecimals);
+BENCHMARK_TEMPLATE(BM_SimpleDtoa_Proto2, RandomBits);
+
+template <FloatValues kValues>
+static void BM_SimpleFtoa_Proto2(benchmark::State& state) {
+  std::vector<float> values = MakeFloatValues<float, kValues>();
+  for (auto _ : state) {
+    for (float value : values) {
+      benchmark::DoNotOptimize(protobuf::io::SimpleFtoa(value));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK_TEMPLATE(BM_SimpleFtoa_Proto2, ShortDecimals);
+BENCHMARK_TEMPLATE(BM_SimpleFtoa_Proto2, RandomBits);
+
 static void BM_SerializeDescriptor_Proto2(benchmark::State& state) {
   upb_benchmark::FileDescriptorProto proto;
   proto.ParseFromArray(descriptor.data, descriptor.size);
@@ -351,6 +842,125 @@ static void BM_SerializeDescriptor_Proto2(benchmark::State& state) {
 }
 BENCHMARK(BM_SerializeDescriptor_Proto2);
 
+// Serializes a FileDescriptorSet of `state.range(0)` MB whose files are
+// written by `state.range(1)` threads. One thread is the plain serial
+// SerializeToString().
+static void BM_SerializeRepeatedFieldInParallel_Proto2(
+    benchmark::State& state) {
+  upb_benchmark::FileDescriptorProto file;
+  file.ParseFromArray(descriptor.data, descriptor.size);
+  upb_benchmark::FileDescriptorSet set;
+  const size_t num_files = (state.range(0) << 20) / descriptor.size;
+  for (size_t i = 0; i < num_files; i++) {
+    *set.add_file() = file;
+  }
+  const protobuf::FieldDescriptor* field =
+      upb_benchmark::FileDescriptorSet::descriptor()->FindFieldByName("file");
+  const int num_threads = static_cast<int>(state.range(1));
+
+  std::string output;
+  for (auto _ : state) {
+    if (num_threads == 1) {
+      set.SerializeToString(&output);
+    } else {
+      std::vector<std::thread> threads;
+      protobuf::util::SerializeRepeatedFieldInParallel(
+          set, field, num_threads,
+          [&threads](std::function<void()> task) {
+            threads.emplace_back(std::move(task));
+          },
+          &output);
+      for (auto& thread : threads) thread.join();
+    }
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetBytesProcessed(state.iterations() * output.size());
+}
+BENCHMARK(BM_SerializeRepeatedFieldInParallel_Proto2)
+    ->ArgsProduct({{64, 256}, {1, 2, 4, 8}})
+    ->Unit(benchmark::kMillisecond);
+
+enum FileReader { PlainFile, PrefetchingFile };
+
+// Reads a file of `state.range(0)` MB of delimited FileDescriptorProtos. The
+// file is written once and is usually in the page cache, so this measures
+// how well I/O waits overlap with parsing rather than raw disk bandwidth.
+template <FileReader kReader>
+static void BM_ReadDelimitedFile_Proto2(benchmark::State& state) {
+  upb_benchmark::FileDescriptorProto proto;
+  proto.ParseFromArray(descriptor.data, descriptor.size);
+  char filename[] = "/tmp/protobuf_benchmark_XXXXXX";
+  const int fd = mkstemp(filename);
+  ABSL_CHECK_GE(fd, 0);
+  unlink(filename);
+  const size_t num_records = (state.range(0) << 20) / descriptor.size;
+  {
+    protobuf::io::FileOutputStream output(fd);
+    for (size_t i = 0; i < num_records; i++) {
+      ABSL_CHECK(
+          protobuf::util::SerializeDelimitedToZeroCopyStream(proto, &output));
+    }
+  }
+
+  for (auto _ : state) {
+    ABSL_CHECK_EQ(lseek(fd, 0, SEEK_SET), 0);
+    std::unique_ptr<protobuf::io::ZeroCopyInputStream> input;
+    if (kReader == PlainFile) {
+      input = std::make_unique<protobuf::io::FileInputStream>(fd);
+    } else {
+      input = std::make_unique<protobuf::io::PrefetchingFileInputStream>(fd);
+    }
+    bool clean_eof = false;
+    size_t count = 0;
+    while (protobuf::util::ParseDelimitedFromZeroCopyStream(
+        &proto, input.get(), &clean_eof)) {
+      count++;
+    }
+    ABSL_CHECK(clean_eof);
+    ABSL_CHECK_EQ(count, num_records);
+  }
+  close(fd);
+  state.SetBytesProcessed(state.iterations() * num_records * descriptor.size);
+}
+BENCHMARK_TEMPLATE(BM_ReadDelimitedFile_Proto2, PlainFile)
+    ->Arg(64)
+    ->Arg(512)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ReadDelimitedFile_Proto2, PrefetchingFile)
+    ->Arg(64)
+    ->Arg(512)
+    ->Unit(benchmark::kMillisecond);
+
+// Compresses `state.range(0)` MB of serialized FileDescriptorProtos with
+// `state.range(1)` threads. One thread is the serial GzipOutputStream.
+static void BM_GzipCompress_Proto2(benchmark::State& state) {
+  upb_benchmark::FileDescriptorProto file;
+  file.ParseFromArray(descriptor.data, descriptor.size);
+  upb_benchmark::FileDescriptorSet set;
+  const size_t num_files = (state.range(0) << 20) / descriptor.size;
+  for (size_t i = 0; i < num_files; i++) {
+    *set.add_file() = file;
+  }
+  const size_t data_size = set.ByteSizeLong();
+
+  protobuf::io::GzipOutputStream::Options options;
+  options.num_threads = static_cast<int>(state.range(1));
+  std::string output;
+  for (auto _ : state) {
+    output.clear();
+    protobuf::io::StringOutputStream string_output(&output);
+    protobuf::io::GzipOutputStream gzip_output(&string_output, options);
+    ABSL_CHECK(set.SerializeToZeroCopyStream(&gzip_output));
+    ABSL_CHECK(gzip_output.Close());
+  }
+  state.SetBytesProcessed(state.iterations() * data_size);
+  state.counters["ratio"] =
+      static_cast<double>(data_size) / static_cast<double>(output.size());
+}
+BENCHMARK(BM_GzipCompress_Proto2)
+    ->ArgsProduct({{64}, {1, 2, 4, 8}})
+    ->Unit(benchmark::kMillisecond);
+
 static upb_benchmark_FileDescriptorProto* UpbParseDescriptor(upb_Arena* arena) {
   upb_benchmark_FileDescriptorProto* set =
       upb_benchmark_FileDescriptorProto_parse(descriptor.data, descriptor.size,
@@ -432,6 +1042,25 @@ static void BM_JsonParse_Proto2(benchmark::State& state) {
 }
 BENCHMARK(BM_JsonParse_Proto2);
 
+// Indented JSON, as often served by REST APIs, spends more of its time in
+// whitespace.
+static void BM_JsonParsePretty_Proto2(benchmark::State& state) {
+  protobuf::FileDescriptorProto proto;
+  absl::string_view input(descriptor.data, descriptor.size);
+  proto.ParseFromString(input);
+  std::string json;
+  google::protobuf::json::PrintOptions options;
+  options.add_whitespace = true;
+  ABSL_CHECK_OK(
+      google::protobuf::json::MessageToJsonString(proto, &json, options));
+  for (auto _ : state) {
+    protobuf::FileDescriptorProto proto;
+    ABSL_CHECK_OK(google::protobuf::json::JsonStringToMessage(json, &proto));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_JsonParsePretty_Proto2);
+
 static void BM_JsonSerialize_Upb(benchmark::State& state) {
   upb_Arena* arena = upb_Arena_New();
   upb_benchmark_FileDescriptorProto* set =
@@ -469,3 +1098,180 @@ static void BM_JsonSerialize_Proto2(benchmark::State& state) {
   state.SetBytesProcessed(state.iterations() * json.size());
 }
 BENCHMARK(BM_JsonSerialize_Proto2);
+
+// Schema-driven conversions between JSON and binary, as done by proxies that
+// only have descriptors for the types they handle.
+enum JsonSchemaMode {
+  TypeResolver,
+  PoolAndFactory,
+};
+
+template <JsonSchemaMode Mode>
+static void BM_JsonToBinary_Proto2(benchmark::State& state) {
+  protobuf::FileDescriptorProto proto;
+  absl::string_view input(descriptor.data, descriptor.size);
+  proto.ParseFromString(input);
+  std::string json;
+  ABSL_CHECK_OK(google::protobuf::json::MessageToJsonString(proto, &json));
+  std::string type_url =
+      absl::StrCat("type.googleapis.com/", proto.GetTypeName());
+  std::unique_ptr<protobuf::util::TypeResolver> resolver(
+      protobuf::util::NewTypeResolverForDescriptorPool(
+          "type.googleapis.com", protobuf::DescriptorPool::generated_pool()));
+  protobuf::DynamicMessageFactory factory;
+  std::string binary;
+  for (auto _ : state) {
+    binary.clear();
+    protobuf::io::ArrayInputStream in(json.data(), json.size());
+    protobuf::io::StringOutputStream out(&binary);
+    if (Mode == TypeResolver) {
+      ABSL_CHECK_OK(google::protobuf::json::JsonToBinaryStream(
+          resolver.get(), type_url, &in, &out));
+    } else {
+      ABSL_CHECK_OK(google::protobuf::json::JsonToBinaryStream(
+          protobuf::DescriptorPool::generated_pool(), &factory, type_url, &in,
+          &out));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK_TEMPLATE(BM_JsonToBinary_Proto2, TypeResolver);
+BENCHMARK_TEMPLATE(BM_JsonToBinary_Proto2, PoolAndFactory);
+
+template <JsonSchemaMode Mode>
+static void BM_BinaryToJson_Proto2(benchmark::State& state) {
+  protobuf::FileDescriptorProto proto;
+  absl::string_view input(descriptor.data, descriptor.size);
+  proto.ParseFromString(input);
+  std::string type_url =
+      absl::StrCat("type.googleapis.com/", proto.GetTypeName());
+  std::unique_ptr<protobuf::util::TypeResolver> resolver(
+      protobuf::util::NewTypeResolverForDescriptorPool(
+          "type.googleapis.com", protobuf::DescriptorPool::generated_pool()));
+  protobuf::DynamicMessageFactory factory;
+  std::string json;
+  for (auto _ : state) {
+    json.clear();
+    protobuf::io::ArrayInputStream in(input.data(), input.size());
+    protobuf::io::StringOutputStream out(&json);
+    if (Mode == TypeResolver) {
+      ABSL_CHECK_OK(google::protobuf::json::BinaryToJsonStream(
+          resolver.get(), type_url, &in, &out));
+    } else {
+      ABSL_CHECK_OK(google::protobuf::json::BinaryToJsonStream(
+          protobuf::DescriptorPool::generated_pool(), &factory, type_url, &in,
+          &out));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK_TEMPLATE(BM_BinaryToJson_Proto2, TypeResolver);
+BENCHMARK_TEMPLATE(BM_BinaryToJson_Proto2, PoolAndFactory);
+
+// A message with hundreds of fields, a quarter of which have a custom
+// json_name, and every field set once.
+static void BM_JsonParseWide_Proto2(benchmark::State& state) {
+  protobuf::FileDescriptorProto file;
+  file.set_name("wide.proto");
+  file.set_syntax("proto3");
+  protobuf::DescriptorProto* message_type = file.add_message_type();
+  message_type->set_name("Wide");
+  std::string json = "{";
+  for (int i = 1; i <= 400; ++i) {
+    protobuf::FieldDescriptorProto* field = message_type->add_field();
+    field->set_name(absl::StrCat("field_", i));
+    field->set_number(i);
+    field->set_type(protobuf::FieldDescriptorProto::TYPE_INT32);
+    field->set_label(protobuf::FieldDescriptorProto::LABEL_OPTIONAL);
+    std::string key = absl::StrCat("field", i);
+    if (i % 4 == 0) {
+      key = absl::StrCat("f", i);
+      field->set_json_name(key);
+    }
+    absl::StrAppend(&json, i == 1 ? "" : ",", "\"", key, "\":", i);
+  }
+  json += "}";
+
+  protobuf::DescriptorPool pool;
+  const protobuf::FileDescriptor* file_desc = pool.BuildFile(file);
+  ABSL_CHECK(file_desc != nullptr);
+  protobuf::DynamicMessageFactory factory;
+  std::unique_ptr<protobuf::Message> message(
+      factory.GetPrototype(file_desc->message_type(0))->New());
+  for (auto _ : state) {
+    ABSL_CHECK_OK(
+        google::protobuf::json::JsonStringToMessage(json, message.get()));
+  }
+  state.SetItemsProcessed(state.iterations() * 400);
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_JsonParseWide_Proto2);
+
+// Newline-delimited JSON with one DescriptorProto per line, as in a bulk
+// export.
+static std::string JsonRecords(int* count) {
+  protobuf::FileDescriptorProto proto;
+  absl::string_view input(descriptor.data, descriptor.size);
+  proto.ParseFromString(input);
+  std::string json;
+  {
+    google::protobuf::io::StringOutputStream output(&json);
+    google::protobuf::json::JsonRecordWriter writer(
+        &output, google::protobuf::json::RecordFormat::kNewlineDelimited);
+    for (const auto& message : proto.message_type()) {
+      ABSL_CHECK_OK(writer.Write(message));
+    }
+  }
+  *count = proto.message_type_size();
+  return json;
+}
+
+static void BM_JsonRecordsPerLine_Proto2(benchmark::State& state) {
+  int count;
+  std::string json = JsonRecords(&count);
+  for (auto _ : state) {
+    for (absl::string_view line :
+         absl::StrSplit(json, '\n', absl::SkipEmpty())) {
+      protobuf::DescriptorProto record;
+      ABSL_CHECK_OK(google::protobuf::json::JsonStringToMessage(line, &record));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_JsonRecordsPerLine_Proto2);
+
+static void BM_JsonRecordReader_Proto2(benchmark::State& state) {
+  int count;
+  std::string json = JsonRecords(&count);
+  for (auto _ : state) {
+    google::protobuf::io::ArrayInputStream input(json.data(), json.size());
+    google::protobuf::json::JsonRecordReader reader(
+        &input, google::protobuf::json::RecordFormat::kNewlineDelimited);
+    while (reader.NextOnArena(protobuf::DescriptorProto::default_instance())) {
+    }
+    ABSL_CHECK_OK(reader.status());
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_JsonRecordReader_Proto2);
+
+static void BM_JsonRecordWriter_Proto2(benchmark::State& state) {
+  protobuf::FileDescriptorProto proto;
+  absl::string_view input(descriptor.data, descriptor.size);
+  proto.ParseFromString(input);
+  std::string json;
+  for (auto _ : state) {
+    json.clear();
+    google::protobuf::io::StringOutputStream output(&json);
+    google::protobuf::json::JsonRecordWriter writer(
+        &output, google::protobuf::json::RecordFormat::kNewlineDelimited);
+    for (const auto& message : proto.message_type()) {
+      ABSL_CHECK_OK(writer.Write(message));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * proto.message_type_size());
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_JsonRecordWriter_Proto2);
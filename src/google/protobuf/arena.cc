@@ -7,6 +7,10 @@
 
 #include "google/protobuf/arena.h"
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
 #include <algorithm>
 #include <atomic>
 #include <cstddef>
@@ -20,6 +24,7 @@
 #include "absl/container/internal/layout.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "absl/numeric/bits.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "google/protobuf/arena_allocation_policy.h"
@@ -67,8 +72,244 @@ inline size_t AllocationSize(size_t last_size, size_t start_size,
   return std::min(2 * last_size, max_size);
 }
 
+// Bounded cache of blocks released by arenas that opted in through
+// `AllocationPolicy::thread_block_cache_size`. Each thread owns one, so no
+// synchronization is needed. Blocks are binned by floor(log2(size)), so
+// arenas that repeatedly request the same sizes find them in the same bin.
+struct ThreadBlockCache {
+  static constexpr size_t kNumBins = 64;
+  // Number of blocks inspected in the best-fit bin before falling back to the
+  // next larger bin.
+  static constexpr int kMaxProbes = 4;
+
+  // Header written over a retained block.
+  struct FreeBlock {
+    FreeBlock* next;
+    size_t size;
+  };
+
+  FreeBlock* bins[kNumBins];
+  uint64_t retained_bytes;
+  uint64_t hits;
+  uint64_t misses;
+  bool reaper_registered;
+  // Set once the owning thread runs its thread_local destructors. Blocks
+  // released after that point bypass the cache.
+  bool exiting;
+};
+
+#if !defined(PROTOBUF_NO_THREADLOCAL)
+// Trivially destructible, so it stays valid until the thread is gone even if
+// arenas are destroyed by other thread_local destructors.
+PROTOBUF_CONSTINIT PROTOBUF_THREAD_LOCAL ThreadBlockCache thread_block_cache;
+
+ThreadBlockCache* GetThreadBlockCache() { return &thread_block_cache; }
+#else
+ThreadBlockCache* GetThreadBlockCache() { return nullptr; }
+#endif  // !PROTOBUF_NO_THREADLOCAL
+
+void ReleaseBlocks(ThreadBlockCache& cache) {
+  for (auto*& head : cache.bins) {
+    while (head != nullptr) {
+      ThreadBlockCache::FreeBlock* b = head;
+      head = b->next;
+      const size_t size = b->size;
+      PROTOBUF_UNPOISON_MEMORY_REGION(b, size);
+      internal::SizedDelete(b, size);
+    }
+  }
+  cache.retained_bytes = 0;
+}
+
+#if !defined(PROTOBUF_NO_THREADLOCAL)
+// Frees the calling thread's cache on thread exit.
+struct ThreadBlockCacheReaper {
+  ~ThreadBlockCacheReaper() {
+    ReleaseBlocks(thread_block_cache);
+    thread_block_cache.exiting = true;
+  }
+};
+
+void RegisterThreadBlockCacheReaper() {
+  static thread_local ThreadBlockCacheReaper reaper;
+  (void)reaper;
+}
+#else
+void RegisterThreadBlockCacheReaper() {}
+#endif  // !PROTOBUF_NO_THREADLOCAL
+
+SizedPtr AllocateFromThreadBlockCache(size_t size) {
+  ThreadBlockCache* cache = GetThreadBlockCache();
+  if (cache == nullptr) return {nullptr, 0};
+  const size_t bin = absl::bit_width(size) - 1;
+  // Blocks in `bin` may still be smaller than `size`, but every block in the
+  // next bin is large enough.
+  ThreadBlockCache::FreeBlock** link = &cache->bins[bin];
+  for (int i = 0; i < ThreadBlockCache::kMaxProbes && *link != nullptr &&
+                  (*link)->size < size;
+       ++i) {
+    link = &(*link)->next;
+  }
+  if ((*link == nullptr || (*link)->size < size) &&
+      bin + 1 < ThreadBlockCache::kNumBins) {
+    link = &cache->bins[bin + 1];
+  }
+  ThreadBlockCache::FreeBlock* b = *link;
+  if (b == nullptr || b->size < size) {
+    ++cache->misses;
+    return {nullptr, 0};
+  }
+  const size_t n = b->size;
+  *link = b->next;
+  PROTOBUF_UNPOISON_MEMORY_REGION(b, n);
+  cache->retained_bytes -= n;
+  ++cache->hits;
+  return {b, n};
+}
+
+// Returns true if `mem` was taken over by the cache.
+bool RetainInThreadBlockCache(SizedPtr mem, size_t limit) {
+  ThreadBlockCache* cache = GetThreadBlockCache();
+  if (cache == nullptr || cache->exiting ||
+      mem.n < sizeof(ThreadBlockCache::FreeBlock) ||
+      cache->retained_bytes + mem.n > limit) {
+    return false;
+  }
+  if (PROTOBUF_PREDICT_FALSE(!cache->reaper_registered)) {
+    cache->reaper_registered = true;
+    RegisterThreadBlockCacheReaper();
+  }
+  auto& head = cache->bins[absl::bit_width(mem.n) - 1];
+  head = new (mem.p) ThreadBlockCache::FreeBlock{head, mem.n};
+  cache->retained_bytes += mem.n;
+  PROTOBUF_POISON_MEMORY_REGION(head + 1,
+                                mem.n - sizeof(ThreadBlockCache::FreeBlock));
+  return true;
+}
+
+#if defined(__linux__) && !defined(PROTOBUF_NO_THREADLOCAL)
+// Blocks of arenas created with `AllocationPolicy::huge_page_blocks` are carved
+// from kHugePageRegionSize-aligned anonymous mappings advised with
+// MADV_HUGEPAGE. Each thread carves from its own current region, so the blocks
+// of a SerialArena live in regions first touched by the thread owning it and,
+// under the kernel's default local allocation policy, on that thread's NUMA
+// node. A region is unmapped once all blocks carved from it have been freed
+// and no thread carves from it anymore.
+constexpr size_t kHugePageRegionSize = size_t{2} << 20;
+
+struct HugePageRegion {
+  HugePageRegion(size_t refs, size_t size) : refs(refs), size(size) {}
+
+  // Live blocks, plus one while a thread carves from the region.
+  std::atomic<size_t> refs;
+  const size_t size;
+};
+
+// Blocks start at a cache line boundary after the header.
+constexpr size_t kHugePageRegionHeaderSize = 64;
+static_assert(sizeof(HugePageRegion) <= kHugePageRegionHeaderSize, "");
+
+struct HugePageCarver {
+  HugePageRegion* region;
+  char* ptr;
+  char* limit;
+  bool reaper_registered;
+  // Set once the owning thread runs its thread_local destructors. Blocks
+  // allocated after that point get dedicated regions.
+  bool exiting;
+};
+
+PROTOBUF_CONSTINIT PROTOBUF_THREAD_LOCAL HugePageCarver huge_page_carver;
+
+HugePageRegion* MapHugePageRegion(size_t size) {
+  // Over-map so that an aligned region of `size` bytes can be cut out.
+  const size_t map_size = size + kHugePageRegionSize;
+  void* mem = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ABSL_CHECK(mem != MAP_FAILED) << "Failed to map " << map_size << " bytes.";
+  const uintptr_t start = reinterpret_cast<uintptr_t>(mem);
+  const uintptr_t begin =
+      (start + kHugePageRegionSize - 1) & ~(kHugePageRegionSize - 1);
+  const uintptr_t end = begin + size;
+  if (begin != start) munmap(mem, begin - start);
+  if (end != start + map_size) {
+    munmap(reinterpret_cast<void*>(end), start + map_size - end);
+  }
+#ifdef MADV_HUGEPAGE
+  // Best effort: transparent huge pages may be disabled.
+  madvise(reinterpret_cast<void*>(begin), size, MADV_HUGEPAGE);
+#endif
+  return new (reinterpret_cast<void*>(begin)) HugePageRegion{1, size};
+}
+
+void UnrefHugePageRegion(HugePageRegion* region) {
+  if (region->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    munmap(region, region->size);
+  }
+}
+
+// Drops the calling thread's carving reference on thread exit.
+struct HugePageCarverReaper {
+  ~HugePageCarverReaper() {
+    if (huge_page_carver.region != nullptr) {
+      UnrefHugePageRegion(huge_page_carver.region);
+    }
+    huge_page_carver = {};
+    huge_page_carver.exiting = true;
+  }
+};
+
+SizedPtr AllocateHugePageBlock(size_t size) {
+  size = (size + kHugePageRegionHeaderSize - 1) &
+         ~(kHugePageRegionHeaderSize - 1);
+  HugePageCarver& carver = huge_page_carver;
+  if (size > kHugePageRegionSize / 4 || carver.exiting) {
+    // Large blocks get a region of their own, rounded up to whole huge pages.
+    const size_t region_size =
+        (size + kHugePageRegionHeaderSize + kHugePageRegionSize - 1) &
+        ~(kHugePageRegionSize - 1);
+    HugePageRegion* region = MapHugePageRegion(region_size);
+    return {reinterpret_cast<char*>(region) + kHugePageRegionHeaderSize,
+            region_size - kHugePageRegionHeaderSize};
+  }
+  if (carver.region == nullptr ||
+      static_cast<size_t>(carver.limit - carver.ptr) < size) {
+    if (carver.region != nullptr) {
+      UnrefHugePageRegion(carver.region);
+    } else if (!carver.reaper_registered) {
+      carver.reaper_registered = true;
+      static thread_local HugePageCarverReaper reaper;
+      (void)reaper;
+    }
+    carver.region = MapHugePageRegion(kHugePageRegionSize);
+    carver.ptr = reinterpret_cast<char*>(carver.region) +
+                 kHugePageRegionHeaderSize;
+    carver.limit = reinterpret_cast<char*>(carver.region) + kHugePageRegionSize;
+  }
+  carver.region->refs.fetch_add(1, std::memory_order_relaxed);
+  void* p = carver.ptr;
+  carver.ptr += size;
+  return {p, size};
+}
+
+void FreeHugePageBlock(SizedPtr mem) {
+  // Every block starts within the first huge page of its region.
+  UnrefHugePageRegion(reinterpret_cast<HugePageRegion*>(
+      reinterpret_cast<uintptr_t>(mem.p) & ~(kHugePageRegionSize - 1)));
+}
+#else
+SizedPtr AllocateHugePageBlock(size_t size) { return AllocateAtLeast(size); }
+
+void FreeHugePageBlock(SizedPtr mem) { internal::SizedDelete(mem.p, mem.n); }
+#endif  // __linux__ && !PROTOBUF_NO_THREADLOCAL
+
 SizedPtr AllocateMemory(const AllocationPolicy& policy, size_t size) {
   if (policy.block_alloc == nullptr) {
+    if (policy.huge_page_blocks) return AllocateHugePageBlock(size);
+    if (policy.thread_block_cache_size != 0) {
+      SizedPtr mem = AllocateFromThreadBlockCache(size);
+      if (mem.p != nullptr) return mem;
+    }
     return AllocateAtLeast(size);
   }
   return {policy.block_alloc(size), size};
@@ -102,18 +343,28 @@ SizedPtr AllocateCleanupChunk(const AllocationPolicy* policy_ptr,
 class GetDeallocator {
  public:
   explicit GetDeallocator(const AllocationPolicy* policy)
-      : dealloc_(policy ? policy->block_dealloc : nullptr) {}
+      : dealloc_(policy ? policy->block_dealloc : nullptr),
+        huge_page_blocks_(policy && policy->block_alloc == nullptr &&
+                          policy->huge_page_blocks),
+        block_cache_size_(policy && policy->block_alloc == nullptr
+                              ? policy->thread_block_cache_size
+                              : 0) {}
 
   void operator()(SizedPtr mem) const {
     if (dealloc_) {
       dealloc_(mem.p, mem.n);
-    } else {
+    } else if (huge_page_blocks_) {
+      FreeHugePageBlock(mem);
+    } else if (block_cache_size_ == 0 ||
+               !RetainInThreadBlockCache(mem, block_cache_size_)) {
       internal::SizedDelete(mem.p, mem.n);
     }
   }
 
  private:
   void (*dealloc_)(void*, size_t);
+  bool huge_page_blocks_;
+  size_t block_cache_size_;
 };
 
 }  // namespace
@@ -326,7 +577,10 @@ void SerialArena::AllocateNewBlock(size_t n) {
   // but with a CPU regression. The regression might have been an artifact of
   // the microbenchmark.
 
-  auto mem = AllocateBlock(parent_.AllocPolicy(), old_head->size, n);
+  auto mem = parent_.AllocateSpareBlock(kBlockHeaderSize + n);
+  if (mem.p == nullptr) {
+    mem = AllocateBlock(parent_.AllocPolicy(), old_head->size, n);
+  }
   AddSpaceAllocated(mem.n);
   ThreadSafeArenaStats::RecordAllocateStats(parent_.arena_stats_.MutableStats(),
                                             /*used=*/used,
@@ -628,6 +882,10 @@ void ThreadSafeArena::InitializeWithPolicy(const AllocationPolicy& policy) {
     return;
   }
   new (p) AllocationPolicy{policy};
+  if (policy.size_hint != nullptr) {
+    ThreadSafeArenaStats::RecordHintedStartBlockSize(
+        arena_stats_.MutableStats(), policy.start_block_size);
+  }
   // Low bits store flags, so they mustn't be overwritten.
   ABSL_DCHECK_EQ(0u, reinterpret_cast<uintptr_t>(p) & 3);
   alloc_policy_.set_policy(reinterpret_cast<AllocationPolicy*>(p));
@@ -735,6 +993,8 @@ void ThreadSafeArena::Init() {
 }
 
 ThreadSafeArena::~ThreadSafeArena() {
+  RecordSizeHint();
+
   // Have to do this in a first pass, because some of the destructors might
   // refer to memory in other blocks.
   CleanupList();
@@ -748,8 +1008,31 @@ ThreadSafeArena::~ThreadSafeArena() {
   }
 }
 
-SizedPtr ThreadSafeArena::Free() {
-  auto deallocator = GetDeallocator(alloc_policy_.get());
+SizedPtr ThreadSafeArena::Free(size_t max_retained_bytes, uint64_t& retained,
+                               uint64_t& released) {
+  GetDeallocator dealloc(alloc_policy_.get());
+  size_t budget = max_retained_bytes;
+  auto deallocator = [&](SizedPtr mem) {
+    if (mem.n <= budget) {
+      budget -= mem.n;
+      retained += mem.n;
+      AddSpareBlock(mem);
+    } else {
+      released += mem.n;
+      dealloc(mem);
+    }
+  };
+
+  // Blocks kept by an earlier reset compete for the budget like the others.
+  SpareBlock* spare =
+      spare_blocks_.exchange(nullptr, std::memory_order_relaxed);
+  while (spare != nullptr) {
+    SpareBlock* next = spare->next;
+    const size_t size = spare->size;
+    PROTOBUF_UNPOISON_MEMORY_REGION(spare, size);
+    deallocator({spare, size});
+    spare = next;
+  }
 
   WalkSerialArenaChunk([&](SerialArenaChunk* chunk) {
     absl::Span<std::atomic<SerialArena*>> span = chunk->arenas();
@@ -774,18 +1057,73 @@ SizedPtr ThreadSafeArena::Free() {
   return first_arena_.Free(deallocator);
 }
 
+void ThreadSafeArena::RecordSizeHint() {
+  AllocationPolicy* policy = alloc_policy_.get();
+  if (PROTOBUF_PREDICT_TRUE(policy == nullptr ||
+                            policy->size_hint == nullptr)) {
+    return;
+  }
+  // Record what the first block would have needed to hold everything.
+  // SpaceAllocated() is not used as it never drops below the start block size
+  // picked from the hint.
+  policy->size_hint->Record(SpaceUsed() + kBlockHeaderSize + kAllocPolicySize);
+}
+
+void ThreadSafeArena::AddSpareBlock(SizedPtr mem) {
+  auto* b = new (mem.p)
+      SpareBlock{spare_blocks_.load(std::memory_order_relaxed), mem.n};
+  spare_blocks_.store(b, std::memory_order_relaxed);
+  PROTOBUF_POISON_MEMORY_REGION(b + 1, mem.n - sizeof(SpareBlock));
+}
+
+SizedPtr ThreadSafeArena::AllocateSpareBlockSlow(size_t min_size) {
+  absl::MutexLock lock(&mutex_);
+  SpareBlock* prev = nullptr;
+  for (SpareBlock* b = spare_blocks_.load(std::memory_order_relaxed);
+       b != nullptr; prev = b, b = b->next) {
+    if (b->size < min_size) continue;
+    if (prev == nullptr) {
+      spare_blocks_.store(b->next, std::memory_order_relaxed);
+    } else {
+      prev->next = b->next;
+    }
+    const size_t size = b->size;
+    PROTOBUF_UNPOISON_MEMORY_REGION(b, size);
+    return {b, size};
+  }
+  return {nullptr, 0};
+}
+
 uint64_t ThreadSafeArena::Reset() {
+  uint64_t retained = 0;
+  uint64_t released = 0;
+  return ResetRetainingCapacity(0, retained, released);
+}
+
+uint64_t ThreadSafeArena::ResetRetainingCapacity(size_t max_retained_bytes,
+                                                 uint64_t& retained,
+                                                 uint64_t& released) {
   const size_t space_allocated = SpaceAllocated();
 
+  RecordSizeHint();
+  if (AllocationPolicy* policy = alloc_policy_.get()) {
+    // Pick up the latest proposal for blocks of new SerialArenas.
+    if (policy->size_hint != nullptr &&
+        policy->size_hint->start_block_size() != 0) {
+      policy->start_block_size = policy->size_hint->start_block_size();
+    }
+  }
+
   // Have to do this in a first pass, because some of the destructors might
   // refer to memory in other blocks.
   CleanupList();
   // Reset the first arena's cleanup list.
   first_arena_.cleanup_list_ = cleanup::ChunkList();
 
-  // Discard all blocks except the first one. Whether it is user-provided or
-  // allocated, always reuse the first block for the first arena.
-  auto mem = Free();
+  // Discard all blocks except the first one and the ones kept as spare
+  // capacity. Whether it is user-provided or allocated, always reuse the first
+  // block for the first arena.
+  auto mem = Free(max_retained_bytes, retained, released);
 
   // Reset the first arena with the first block. This avoids redundant
   // free / allocation and re-allocating for AllocationPolicy. Adjust offset if
@@ -960,8 +1298,11 @@ SerialArena* ThreadSafeArena::GetSerialArenaFallback(size_t n) {
     // This thread doesn't have any SerialArena, which also means it doesn't
     // have any blocks yet.  So we'll allocate its first block now. It must be
     // big enough to host SerialArena and the pending request.
-    serial = SerialArena::New(
-        AllocateBlock(alloc_policy_.get(), 0, n + kSerialArenaSize), *this);
+    SizedPtr mem = AllocateSpareBlock(kBlockHeaderSize + n + kSerialArenaSize);
+    if (mem.p == nullptr) {
+      mem = AllocateBlock(alloc_policy_.get(), 0, n + kSerialArenaSize);
+    }
+    serial = SerialArena::New(mem, *this);
 
     AddSerialArena(id, serial);
   }
@@ -972,6 +1313,48 @@ SerialArena* ThreadSafeArena::GetSerialArenaFallback(size_t n) {
 
 }  // namespace internal
 
+void ArenaSizeHint::Record(uint64_t space_used) {
+  const size_t bin = std::min<size_t>(
+      absl::bit_width(space_used == 0 ? 0 : space_used - 1), kNumBins - 1);
+  bins_[bin].fetch_add(1, std::memory_order_relaxed);
+  const uint64_t n = num_samples_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+  // Concurrent updates may race with the decay and get lost; the histogram is
+  // only a hint, so that is acceptable.
+  uint32_t counts[kNumBins];
+  uint64_t total = 0;
+  const bool decay = n % kDecayInterval == 0;
+  for (size_t i = 0; i < kNumBins; ++i) {
+    counts[i] = bins_[i].load(std::memory_order_relaxed);
+    if (decay) {
+      counts[i] /= 2;
+      bins_[i].store(counts[i], std::memory_order_relaxed);
+    }
+    total += counts[i];
+  }
+  if (n < kMinSamples || total == 0) return;
+
+  // Smallest bin covering the 90th percentile.
+  const uint64_t threshold = (total * 9 + 9) / 10;
+  uint64_t covered = 0;
+  size_t i = 0;
+  for (; i < kNumBins - 1; ++i) {
+    covered += counts[i];
+    if (covered >= threshold) break;
+  }
+  size_t size = static_cast<size_t>(std::min<uint64_t>(
+      uint64_t{1} << i, max_start_block_size_));
+  size = std::max(size, internal::AllocationPolicy::kDefaultStartBlockSize);
+  start_block_size_.store(size, std::memory_order_relaxed);
+}
+
+ArenaResetStats Arena::ResetRetainingCapacity(size_t max_retained_bytes) {
+  ArenaResetStats stats;
+  stats.space_allocated = impl_.ResetRetainingCapacity(
+      max_retained_bytes, stats.retained_bytes, stats.released_bytes);
+  return stats;
+}
+
 void* Arena::Allocate(size_t n) { return impl_.AllocateAligned(n); }
 
 void* Arena::AllocateForArray(size_t n) {
@@ -983,6 +1366,23 @@ void* Arena::AllocateAlignedWithCleanup(size_t n, size_t align,
   return impl_.AllocateAlignedWithCleanup(n, align, destructor);
 }
 
+ArenaBlockCacheStats Arena::GetThreadBlockCacheStats() {
+  ArenaBlockCacheStats stats;
+  if (const internal::ThreadBlockCache* cache =
+          internal::GetThreadBlockCache()) {
+    stats.hits = cache->hits;
+    stats.misses = cache->misses;
+    stats.retained_bytes = cache->retained_bytes;
+  }
+  return stats;
+}
+
+void Arena::ReleaseThreadBlockCache() {
+  if (internal::ThreadBlockCache* cache = internal::GetThreadBlockCache()) {
+    internal::ReleaseBlocks(*cache);
+  }
+}
+
 std::vector<void*> Arena::PeekCleanupListForTesting() {
   return impl_.PeekCleanupListForTesting();
 }
@@ -10,6 +10,7 @@
 #ifndef GOOGLE_PROTOBUF_ARENA_H__
 #define GOOGLE_PROTOBUF_ARENA_H__
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
@@ -110,6 +111,56 @@ inline bool CanMoveWithInternalSwap(Arena* lhs, Arena* rhs) {
 
 }  // namespace internal
 
+// Learns how much memory the arenas created for one purpose (for example, one
+// RPC method) end up using, and proposes a start block size for later arenas so
+// that they rarely need to grow. Point ArenaOptions::size_hint at one instance
+// per call site, typically a function-level static. ArenaSizeHint is
+// thread-safe and must outlive every arena created with it.
+//
+// Every destroyed or reset arena adds its final space usage to a histogram of
+// power-of-two bins that is periodically halved, so older lifetimes decay. The
+// proposal is the smallest power of two covering the 90th percentile, capped at
+// `max_start_block_size`.
+class PROTOBUF_EXPORT ArenaSizeHint {
+ public:
+  static constexpr size_t kDefaultMaxStartBlockSize = 1 << 20;
+
+  ArenaSizeHint() : ArenaSizeHint(kDefaultMaxStartBlockSize) {}
+  explicit ArenaSizeHint(size_t max_start_block_size)
+      : max_start_block_size_(max_start_block_size) {}
+
+  ArenaSizeHint(const ArenaSizeHint&) = delete;
+  ArenaSizeHint& operator=(const ArenaSizeHint&) = delete;
+
+  // Returns the start block size proposed for the next arena, or zero while
+  // too few arenas have been observed.
+  size_t start_block_size() const {
+    return start_block_size_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the number of arena lifetimes observed so far.
+  uint64_t num_samples() const {
+    return num_samples_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class internal::ThreadSafeArena;
+
+  static constexpr size_t kNumBins = 40;
+  // The histogram is halved every kDecayInterval samples.
+  static constexpr uint64_t kDecayInterval = 256;
+  // No proposal is made before this many samples have been recorded.
+  static constexpr uint64_t kMinSamples = 4;
+
+  void Record(uint64_t space_used);
+
+  const size_t max_start_block_size_;
+  std::atomic<uint64_t> num_samples_{0};
+  std::atomic<size_t> start_block_size_{0};
+  // `bins_[i]` counts arenas that needed at most 2^i bytes.
+  std::atomic<uint32_t> bins_[kNumBins] = {};
+};
+
 // ArenaOptions provides optional additional parameters to arena construction
 // that control its block-allocation behavior.
 struct ArenaOptions {
@@ -143,6 +194,31 @@ struct ArenaOptions {
   // calls free.
   void (*block_dealloc)(void*, size_t) = nullptr;
 
+  // If non-zero, blocks released by this arena (on destruction or Reset()) are
+  // parked in a per-thread cache instead of being returned to the system, and
+  // later block allocations by opted-in arenas on the same thread are served
+  // from it. The value bounds the total bytes the calling thread's cache may
+  // hold after a release. Has no effect when `block_alloc` is set.
+  //
+  // This is intended for servers that create and destroy an arena per request:
+  // in steady state such arenas need no system allocations at all. See
+  // Arena::GetThreadBlockCacheStats().
+  size_t thread_block_cache_size = 0;
+
+  // If true, and neither `block_alloc` nor `block_dealloc` is set, blocks are
+  // carved from 2MiB-aligned regions advised to use transparent huge pages.
+  // Each thread carves its blocks from its own regions, which keeps them on the
+  // thread's NUMA node under the kernel's default first-touch policy. This
+  // reduces TLB pressure for very large arenas (hundreds of MiB) but wastes
+  // address space for small ones. Linux only; elsewhere this is a no-op.
+  // Overrides `thread_block_cache_size`.
+  bool use_huge_page_blocks = false;
+
+  // If set, `start_block_size` is replaced by the hint's proposal once it has
+  // one, and the arena reports its space usage to the hint when it is destroyed
+  // or reset. The hint must outlive the arena. See ArenaSizeHint.
+  ArenaSizeHint* size_hint = nullptr;
+
  private:
   internal::AllocationPolicy AllocationPolicy() const {
     internal::AllocationPolicy res;
@@ -150,6 +226,13 @@ struct ArenaOptions {
     res.max_block_size = max_block_size;
     res.block_alloc = block_alloc;
     res.block_dealloc = block_dealloc;
+    res.thread_block_cache_size = thread_block_cache_size;
+    res.huge_page_blocks = use_huge_page_blocks && block_alloc == nullptr &&
+                           block_dealloc == nullptr;
+    res.size_hint = size_hint;
+    if (size_hint != nullptr && size_hint->start_block_size() != 0) {
+      res.start_block_size = size_hint->start_block_size();
+    }
     return res;
   }
 
@@ -157,6 +240,27 @@ struct ArenaOptions {
   friend class ArenaOptionsTestFriend;
 };
 
+// Result of Arena::ResetRetainingCapacity().
+struct ArenaResetStats {
+  // Same as the return value of Arena::Reset().
+  uint64_t space_allocated = 0;
+  // Bytes kept as spare blocks.
+  uint64_t retained_bytes = 0;
+  // Bytes returned to the block deallocator.
+  uint64_t released_bytes = 0;
+};
+
+// Counters for the calling thread's arena block cache. See
+// ArenaOptions::thread_block_cache_size.
+struct ArenaBlockCacheStats {
+  // Block allocations served from the cache.
+  uint64_t hits = 0;
+  // Block allocations by opted-in arenas that had to go to the system.
+  uint64_t misses = 0;
+  // Bytes currently held by the cache.
+  uint64_t retained_bytes = 0;
+};
+
 // Arena allocator. Arena allocation replaces ordinary (heap-based) allocation
 // with new/delete, and improves performance by aggregating allocations into
 // larger blocks and freeing allocations all at once. Protocol messages are
@@ -322,6 +426,22 @@ class PROTOBUF_EXPORT PROTOBUF_ALIGNAS(8) Arena final {
   // of the allocated blocks. This method is not thread-safe.
   uint64_t Reset() { return impl_.Reset(); }
 
+  // Like Reset(), but instead of freeing every block except the first one,
+  // keeps up to `max_retained_bytes` of them (from all threads) as spare
+  // capacity. Later allocations from any thread reuse spare blocks before
+  // allocating new ones, so a long-lived arena reset between requests stops
+  // paying for re-growth. Spare blocks are not included in SpaceAllocated()
+  // until they are reused; a later Reset() or the destructor frees them. This
+  // method is not thread-safe.
+  ArenaResetStats ResetRetainingCapacity(size_t max_retained_bytes);
+
+  // Returns the counters of the calling thread's block cache.
+  static ArenaBlockCacheStats GetThreadBlockCacheStats();
+
+  // Returns every block retained by the calling thread's block cache to the
+  // system allocator. Threads release their cache automatically on exit.
+  static void ReleaseThreadBlockCache();
+
   // Adds |object| to a list of heap-allocated objects to be freed with |delete|
   // when the arena is destroyed or reset.
   template <typename T>
@@ -13,6 +13,9 @@
 
 namespace google {
 namespace protobuf {
+
+class ArenaSizeHint;  // defined in arena.h
+
 namespace internal {
 
 // `AllocationPolicy` defines `Arena` allocation policies. Applications can
@@ -30,10 +33,24 @@ struct AllocationPolicy {
   void* (*block_alloc)(size_t) = nullptr;
   void (*block_dealloc)(void*, size_t) = nullptr;
 
+  // Upper bound on the bytes the calling thread's block cache may retain when
+  // this arena releases blocks. Zero disables the cache. Ignored if
+  // `block_alloc` is set.
+  size_t thread_block_cache_size = 0;
+
+  // If true, blocks are carved from huge page backed regions instead of being
+  // allocated with operator new. Ignored if `block_alloc` is set.
+  bool huge_page_blocks = false;
+
+  // If set, receives the space used by the arena when it is destroyed or reset
+  // and proposes `start_block_size` for later arenas.
+  ArenaSizeHint* size_hint = nullptr;
+
   bool IsDefault() const {
     return start_block_size == kDefaultStartBlockSize &&
            max_block_size == kDefaultMaxBlockSize && block_alloc == nullptr &&
-           block_dealloc == nullptr;
+           block_dealloc == nullptr && thread_block_cache_size == 0 &&
+           !huge_page_blocks && size_hint == nullptr;
   }
 };
 
@@ -1752,6 +1752,223 @@ TEST(ArenaTest, BlockSizeSmallerThanAllocation) {
   }
 }
 
+TEST(ArenaTest, ThreadBlockCacheRecyclesBlocks) {
+  Arena::ReleaseThreadBlockCache();
+  ArenaOptions options;
+  options.thread_block_cache_size = 1 << 20;
+
+  {
+    Arena arena(options);
+    Arena::CreateArray<char>(&arena, 10000);
+  }
+  ArenaBlockCacheStats after_first = Arena::GetThreadBlockCacheStats();
+  EXPECT_GT(after_first.retained_bytes, 0);
+
+  {
+    Arena arena(options);
+    Arena::CreateArray<char>(&arena, 10000);
+  }
+  ArenaBlockCacheStats after_second = Arena::GetThreadBlockCacheStats();
+  EXPECT_GT(after_second.hits, after_first.hits);
+  EXPECT_EQ(after_second.misses, after_first.misses);
+  EXPECT_EQ(after_second.retained_bytes, after_first.retained_bytes);
+
+  Arena::ReleaseThreadBlockCache();
+  EXPECT_EQ(0, Arena::GetThreadBlockCacheStats().retained_bytes);
+}
+
+TEST(ArenaTest, ThreadBlockCacheIsBounded) {
+  Arena::ReleaseThreadBlockCache();
+  ArenaOptions options;
+  options.thread_block_cache_size = 1024;
+
+  {
+    Arena arena(options);
+    Arena::CreateArray<char>(&arena, 10000);
+  }
+  EXPECT_LE(Arena::GetThreadBlockCacheStats().retained_bytes, 1024);
+  Arena::ReleaseThreadBlockCache();
+}
+
+TEST(ArenaTest, ThreadBlockCacheIsOptIn) {
+  Arena::ReleaseThreadBlockCache();
+  ArenaBlockCacheStats before = Arena::GetThreadBlockCacheStats();
+  {
+    Arena arena;
+    Arena::CreateArray<char>(&arena, 10000);
+  }
+  ArenaBlockCacheStats after = Arena::GetThreadBlockCacheStats();
+  EXPECT_EQ(before.hits, after.hits);
+  EXPECT_EQ(before.misses, after.misses);
+  EXPECT_EQ(0, after.retained_bytes);
+}
+
+TEST(ArenaTest, ThreadBlockCacheSurvivesReset) {
+  Arena::ReleaseThreadBlockCache();
+  ArenaOptions options;
+  options.thread_block_cache_size = 1 << 20;
+  Arena arena(options);
+  for (int i = 0; i < 10; ++i) {
+    TestAllTypes* message = Arena::Create<TestAllTypes>(&arena);
+    TestUtil::SetAllFields(message);
+    TestUtil::ExpectAllFieldsSet(*message);
+    arena.Reset();
+  }
+  EXPECT_GT(Arena::GetThreadBlockCacheStats().hits, 0);
+  Arena::ReleaseThreadBlockCache();
+}
+
+TEST(ArenaTest, HugePageBlocks) {
+  ArenaOptions options;
+  options.use_huge_page_blocks = true;
+  Arena arena(options);
+
+  TestAllTypes* message = Arena::Create<TestAllTypes>(&arena);
+  TestUtil::SetAllFields(message);
+  // Larger than a huge page, so it gets a region of its own.
+  char* large = Arena::CreateArray<char>(&arena, 5 << 20);
+  memset(large, 0xaa, 5 << 20);
+  for (int i = 0; i < 1000; ++i) {
+    char* p = Arena::CreateArray<char>(&arena, 1000);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % 8, 0);
+    memset(p, i, 1000);
+  }
+  TestUtil::ExpectAllFieldsSet(*message);
+  EXPECT_GE(arena.SpaceAllocated(), (5 << 20) + 1000 * 1000);
+}
+
+TEST(ArenaTest, HugePageBlocksMultiThreaded) {
+  ArenaOptions options;
+  options.use_huge_page_blocks = true;
+  Arena arena(options);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&arena] {
+      for (int i = 0; i < 100; ++i) {
+        TestAllTypes* message = Arena::Create<TestAllTypes>(&arena);
+        TestUtil::SetAllFields(message);
+        TestUtil::ExpectAllFieldsSet(*message);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  // The blocks outlive the threads that carved them.
+  arena.Reset();
+}
+
+TEST(ArenaTest, ResetRetainingCapacity) {
+  Arena arena;
+  for (int i = 0; i < 100; ++i) Arena::CreateArray<char>(&arena, 1000);
+  const uint64_t space_allocated = arena.SpaceAllocated();
+
+  ArenaResetStats stats = arena.ResetRetainingCapacity(1 << 20);
+  EXPECT_EQ(space_allocated, stats.space_allocated);
+  EXPECT_GT(stats.retained_bytes, 0);
+  EXPECT_EQ(0, stats.released_bytes);
+  EXPECT_LE(arena.SpaceAllocated() + stats.retained_bytes, space_allocated);
+
+  // Growing back to the same size reuses the spare blocks.
+  for (int i = 0; i < 100; ++i) Arena::CreateArray<char>(&arena, 1000);
+  EXPECT_EQ(space_allocated, arena.SpaceAllocated());
+  stats = arena.ResetRetainingCapacity(1 << 20);
+  EXPECT_EQ(space_allocated, stats.space_allocated);
+  EXPECT_EQ(0, stats.released_bytes);
+}
+
+TEST(ArenaTest, ResetRetainingCapacityHonorsBudget) {
+  Arena arena;
+  for (int i = 0; i < 100; ++i) Arena::CreateArray<char>(&arena, 1000);
+  ArenaResetStats stats = arena.ResetRetainingCapacity(10000);
+  EXPECT_LE(stats.retained_bytes, 10000);
+  EXPECT_GT(stats.released_bytes, 0);
+
+  // A plain Reset() frees the spare blocks again.
+  Arena::CreateArray<char>(&arena, 10);
+  stats = arena.ResetRetainingCapacity(0);
+  EXPECT_EQ(0, stats.retained_bytes);
+  arena.Reset();
+}
+
+TEST(ArenaTest, ResetRetainingCapacityMultiThreaded) {
+  Arena arena;
+  for (int round = 0; round < 3; ++round) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&arena] {
+        for (int i = 0; i < 100; ++i) {
+          TestAllTypes* message = Arena::Create<TestAllTypes>(&arena);
+          TestUtil::SetAllFields(message);
+          TestUtil::ExpectAllFieldsSet(*message);
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    arena.ResetRetainingCapacity(1 << 20);
+  }
+}
+
+TEST(ArenaTest, SizeHintLearnsStartBlockSize) {
+  ArenaSizeHint hint;
+  ArenaOptions options;
+  options.size_hint = &hint;
+  EXPECT_EQ(0, hint.start_block_size());
+
+  for (int i = 0; i < 16; ++i) {
+    Arena arena(options);
+    Arena::CreateArray<char>(&arena, 50000);
+  }
+  EXPECT_EQ(16, hint.num_samples());
+  EXPECT_GE(hint.start_block_size(), 50000);
+
+  // The next arena holds everything in its first block.
+  Arena arena(options);
+  Arena::CreateArray<char>(&arena, 50000);
+  EXPECT_EQ(hint.start_block_size(), arena.SpaceAllocated());
+}
+
+TEST(ArenaTest, SizeHintIsCapped) {
+  ArenaSizeHint hint(/*max_start_block_size=*/4096);
+  ArenaOptions options;
+  options.size_hint = &hint;
+  for (int i = 0; i < 16; ++i) {
+    Arena arena(options);
+    Arena::CreateArray<char>(&arena, 50000);
+  }
+  EXPECT_EQ(4096, hint.start_block_size());
+}
+
+TEST(ArenaTest, SizeHintAdaptsToSmallerArenas) {
+  ArenaSizeHint hint;
+  ArenaOptions options;
+  options.size_hint = &hint;
+  for (int i = 0; i < 16; ++i) {
+    Arena arena(options);
+    Arena::CreateArray<char>(&arena, 50000);
+  }
+  const size_t large = hint.start_block_size();
+  // Small arenas must not be reported as large just because their first block
+  // was sized from the hint.
+  for (int i = 0; i < 1000; ++i) {
+    Arena arena(options);
+    Arena::CreateArray<char>(&arena, 100);
+  }
+  EXPECT_LT(hint.start_block_size(), large);
+}
+
+TEST(ArenaTest, SizeHintRecordsOnReset) {
+  ArenaSizeHint hint;
+  ArenaOptions options;
+  options.size_hint = &hint;
+  Arena arena(options);
+  for (int i = 0; i < 8; ++i) {
+    Arena::CreateArray<char>(&arena, 10000);
+    arena.Reset();
+  }
+  EXPECT_EQ(8, hint.num_samples());
+  EXPECT_GE(hint.start_block_size(), 10000);
+}
+
 TEST(ArenaTest, GetArenaShouldReturnTheArenaForArenaAllocatedMessages) {
   Arena arena;
   ArenaMessage* message = Arena::Create<ArenaMessage>(&arena);
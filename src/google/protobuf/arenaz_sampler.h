@@ -68,6 +68,9 @@ struct ThreadSafeArenaStats
 
   // Records the largest block allocated for the arena.
   std::atomic<size_t> max_block_size;
+  // Records the start block size an ArenaSizeHint picked for the arena, or
+  // zero if the arena was not created with a hint.
+  std::atomic<size_t> hinted_start_block_size;
   // Bit `i` is set to 1 indicates that a thread with `tid % 63 = i` accessed
   // the underlying arena.  We use `% 63` as a rudimentary hash to ensure some
   // bit mixing for thread-ids; `% 64` would only grab the low bits and might
@@ -88,6 +91,12 @@ struct ThreadSafeArenaStats
     RecordAllocateSlow(info, used, allocated, wasted);
   }
 
+  static void RecordHintedStartBlockSize(ThreadSafeArenaStats* info,
+                                         size_t size) {
+    if (PROTOBUF_PREDICT_TRUE(info == nullptr)) return;
+    info->hinted_start_block_size.store(size, std::memory_order_relaxed);
+  }
+
   // Returns the bin for the provided size.
   static size_t FindBin(size_t bytes);
 
@@ -167,6 +176,8 @@ using SamplingState = int64_t;
 struct ThreadSafeArenaStats {
   static void RecordAllocateStats(ThreadSafeArenaStats*, size_t /*requested*/,
                                   size_t /*allocated*/, size_t /*wasted*/) {}
+  static void RecordHintedStartBlockSize(ThreadSafeArenaStats*,
+                                         size_t /*size*/) {}
 };
 
 ThreadSafeArenaStats* SampleSlow(SamplingState& next_sample);
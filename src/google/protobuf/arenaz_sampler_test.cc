@@ -78,6 +78,7 @@ TEST(ThreadSafeArenaStatsTest, PrepareForSampling) {
     EXPECT_EQ(block_stats.bytes_wasted.load(std::memory_order_relaxed), 0);
   }
   EXPECT_EQ(info.max_block_size.load(std::memory_order_relaxed), 0);
+  EXPECT_EQ(info.hinted_start_block_size.load(std::memory_order_relaxed), 0);
   EXPECT_EQ(info.weight, kTestStride);
 
   for (auto& block_stats : info.block_histogram) {
@@ -87,6 +88,7 @@ TEST(ThreadSafeArenaStatsTest, PrepareForSampling) {
     block_stats.bytes_wasted.store(1, std::memory_order_relaxed);
   }
   info.max_block_size.store(1, std::memory_order_relaxed);
+  info.hinted_start_block_size.store(1, std::memory_order_relaxed);
 
   info.PrepareForSampling(2 * kTestStride);
   for (auto& block_stats : info.block_histogram) {
@@ -96,6 +98,7 @@ TEST(ThreadSafeArenaStatsTest, PrepareForSampling) {
     EXPECT_EQ(block_stats.bytes_wasted.load(std::memory_order_relaxed), 0);
   }
   EXPECT_EQ(info.max_block_size.load(std::memory_order_relaxed), 0);
+  EXPECT_EQ(info.hinted_start_block_size.load(std::memory_order_relaxed), 0);
   EXPECT_EQ(info.weight, 2 * kTestStride);
 }
 
@@ -592,6 +595,32 @@ TEST(ThreadSafeArenazSamplerTest, UsedAndWasted) {
   });
   SetThreadSafeArenazSampleParameter(oldparam);
 }
+
+TEST(ThreadSafeArenazSamplerTest, HintedStartBlockSize) {
+  SetThreadSafeArenazEnabled(true);
+  int32_t oldparam = ThreadSafeArenazSampleParameter();
+  SetThreadSafeArenazSampleParameter(1);
+  SetThreadSafeArenazGlobalNextSample(0);
+  auto& sampler = GlobalThreadSafeArenazSampler();
+  ArenaSizeHint hint;
+  ArenaOptions options;
+  options.size_hint = &hint;
+  for (int i = 0; i < 16; ++i) {
+    google::protobuf::Arena arena(options);
+    Arena::CreateArray<char>(&arena, 5000);
+  }
+  ASSERT_NE(hint.start_block_size(), 0);
+  google::protobuf::Arena arena(options);
+  bool found = false;
+  sampler.Iterate([&](const ThreadSafeArenaStats& h) {
+    if (h.hinted_start_block_size.load(std::memory_order_relaxed) ==
+        hint.start_block_size()) {
+      found = true;
+    }
+  });
+  EXPECT_TRUE(found);
+  SetThreadSafeArenazSampleParameter(oldparam);
+}
 #endif  // defined(PROTOBUF_ARENAZ_SAMPLE)
 
 }  // namespace
@@ -1235,6 +1235,8 @@ class FileDescriptorTables {
       const void* parent, absl::string_view lowercase_name) const;
   inline const FieldDescriptor* FindFieldByCamelcaseName(
       const void* parent, absl::string_view camelcase_name) const;
+  inline const FieldDescriptor* FindFieldByJsonKey(
+      const Descriptor* parent, absl::string_view key) const;
   inline const EnumValueDescriptor* FindEnumValueByNumber(
       const EnumDescriptor* parent, int number) const;
   // This creates a new EnumValueDescriptor if not found, in a thread-safe way.
@@ -1275,15 +1277,20 @@ class FileDescriptorTables {
   static void FieldsByCamelcaseNamesLazyInitStatic(
       const FileDescriptorTables* tables);
   void FieldsByCamelcaseNamesLazyInitInternal() const;
+  static void FieldsByJsonKeysLazyInitStatic(
+      const FileDescriptorTables* tables);
+  void FieldsByJsonKeysLazyInitInternal() const;
 
   SymbolsByParentSet symbols_by_parent_;
   mutable absl::once_flag fields_by_lowercase_name_once_;
   mutable absl::once_flag fields_by_camelcase_name_once_;
+  mutable absl::once_flag fields_by_json_key_once_;
   // Make these fields atomic to avoid race conditions with
   // GetEstimatedOwnedMemoryBytesSize. Once the pointer is set the map won't
   // change anymore.
   mutable std::atomic<const FieldsByNameMap*> fields_by_lowercase_name_{};
   mutable std::atomic<const FieldsByNameMap*> fields_by_camelcase_name_{};
+  mutable std::atomic<const FieldsByNameMap*> fields_by_json_key_{};
   FieldsByNumberSet fields_by_number_;  // Not including extensions.
   EnumValuesByNumberSet enum_values_by_number_;
   mutable EnumValuesByNumberSet unknown_enum_values_by_number_
@@ -1516,6 +1523,26 @@ class DescriptorPool::Tables {
   inline void FindAllExtensions(const Descriptor* extendee,
                                 std::vector<const FieldDescriptor*>* out) const;
 
+  // -----------------------------------------------------------------
+  // Lock-free lookups.
+  //
+  // Pools with a mutex publish an immutable snapshot of their committed
+  // symbols and files, which can be searched without taking the mutex.  Only
+  // entries added since the last snapshot need the locked tables.
+
+  // Like FindSymbol() and FindFile(), but only search the snapshot.  These
+  // may be called without holding the mutex.
+  inline Symbol FindSymbolInSnapshot(absl::string_view key) const;
+  inline const FileDescriptor* FindFileInSnapshot(absl::string_view key) const;
+
+  // Returns true if the snapshot is missing committed entries and replacing it
+  // stays within the memory budget.  Requires at least a reader lock.
+  bool ShouldPublishSnapshot() const;
+
+  // Replaces the snapshot if ShouldPublishSnapshot().  Requires the exclusive
+  // lock.
+  void MaybePublishSnapshot();
+
   // -----------------------------------------------------------------
   // Adding items.
 
@@ -1604,6 +1631,19 @@ class DescriptorPool::Tables {
   std::vector<Symbol> symbols_after_checkpoint_;
   std::vector<const FileDescriptor*> files_after_checkpoint_;
   std::vector<std::pair<const Descriptor*, int>> extensions_after_checkpoint_;
+
+  struct Snapshot {
+    SymbolsByNameSet symbols_by_name;
+    DescriptorsByNameSet<FileDescriptor> files_by_name;
+  };
+  // The latest snapshot, or nullptr if none has been published yet.
+  std::atomic<const Snapshot*> snapshot_{nullptr};
+  // Every snapshot ever published.  Readers may still be using a replaced
+  // snapshot, and there is no way to tell when they are done, so snapshots
+  // are only freed along with the pool.
+  std::vector<std::unique_ptr<const Snapshot>> snapshots_;
+  // The total number of entries in snapshots_.
+  size_t snapshot_entries_ = 0;
 };
 
 DescriptorPool::Tables::Tables() {
@@ -1634,6 +1674,7 @@ FileDescriptorTables::FileDescriptorTables() = default;
 FileDescriptorTables::~FileDescriptorTables() {
   delete fields_by_lowercase_name_.load(std::memory_order_acquire);
   delete fields_by_camelcase_name_.load(std::memory_order_acquire);
+  delete fields_by_json_key_.load(std::memory_order_acquire);
 }
 
 inline const FileDescriptorTables& FileDescriptorTables::GetEmptyInstance() {
@@ -1704,12 +1745,24 @@ inline Symbol FileDescriptorTables::FindNestedSymbol(
 Symbol DescriptorPool::Tables::FindByNameHelper(const DescriptorPool* pool,
                                                 absl::string_view name) {
   if (pool->mutex_ != nullptr) {
+    // Fastest path: the Symbol is in the snapshot, which needs no lock.
+    Symbol result = FindSymbolInSnapshot(name);
+    if (!result.IsNull()) return result;
+
     // Fast path: the Symbol is already cached.  This is just a hash lookup.
-    absl::ReaderMutexLock lock(pool->mutex_);
-    if (known_bad_symbols_.empty() && known_bad_files_.empty()) {
-      Symbol result = FindSymbol(name);
-      if (!result.IsNull()) return result;
+    bool publish = false;
+    {
+      absl::ReaderMutexLock lock(pool->mutex_);
+      if (known_bad_symbols_.empty() && known_bad_files_.empty()) {
+        result = FindSymbol(name);
+        publish = !result.IsNull() && ShouldPublishSnapshot();
+      }
     }
+    if (publish) {
+      absl::MutexLock lock(pool->mutex_);
+      MaybePublishSnapshot();
+    }
+    if (!result.IsNull()) return result;
   }
   DescriptorPool::DeferredValidation deferred_validation(pool);
   Symbol result;
@@ -1733,6 +1786,8 @@ Symbol DescriptorPool::Tables::FindByNameHelper(const DescriptorPool* pool,
         result = FindSymbol(name);
       }
     }
+
+    if (pool->mutex_ != nullptr) MaybePublishSnapshot();
   }
 
   if (!deferred_validation.Validate()) {
@@ -1748,6 +1803,47 @@ inline const FileDescriptor* DescriptorPool::Tables::FindFile(
   return *it;
 }
 
+inline Symbol DescriptorPool::Tables::FindSymbolInSnapshot(
+    absl::string_view key) const {
+  const Snapshot* snapshot = snapshot_.load(std::memory_order_acquire);
+  if (snapshot == nullptr) return Symbol();
+  auto it = snapshot->symbols_by_name.find(FullNameQuery{key});
+  return it == snapshot->symbols_by_name.end() ? Symbol() : *it;
+}
+
+inline const FileDescriptor* DescriptorPool::Tables::FindFileInSnapshot(
+    absl::string_view key) const {
+  const Snapshot* snapshot = snapshot_.load(std::memory_order_acquire);
+  if (snapshot == nullptr) return nullptr;
+  auto it = snapshot->files_by_name.find(key);
+  return it == snapshot->files_by_name.end() ? nullptr : *it;
+}
+
+bool DescriptorPool::Tables::ShouldPublishSnapshot() const {
+  // Anything past a checkpoint may still be rolled back.
+  if (!checkpoints_.empty()) return false;
+  size_t entries = symbols_by_name_.size() + files_by_name_.size();
+  const Snapshot* snapshot = snapshot_.load(std::memory_order_relaxed);
+  if (snapshot != nullptr &&
+      snapshot->symbols_by_name.size() + snapshot->files_by_name.size() ==
+          entries) {
+    return false;
+  }
+  // Keep all snapshots together within three times the size of the tables.
+  // This also makes the copying amortized linear in the number of entries.
+  return snapshot_entries_ <= 2 * entries;
+}
+
+void DescriptorPool::Tables::MaybePublishSnapshot() {
+  if (!ShouldPublishSnapshot()) return;
+  auto snapshot = std::make_unique<Snapshot>();
+  snapshot->symbols_by_name = symbols_by_name_;
+  snapshot->files_by_name = files_by_name_;
+  snapshot_entries_ += symbols_by_name_.size() + files_by_name_.size();
+  snapshot_.store(snapshot.get(), std::memory_order_release);
+  snapshots_.push_back(std::move(snapshot));
+}
+
 inline const FieldDescriptor* FileDescriptorTables::FindFieldByNumber(
     const Descriptor* parent, int number) const {
   // If `number` is within the sequential range, just index into the parent
@@ -1833,6 +1929,54 @@ inline const FieldDescriptor* FileDescriptorTables::FindFieldByCamelcaseName(
   return it->second;
 }
 
+void FileDescriptorTables::FieldsByJsonKeysLazyInitStatic(
+    const FileDescriptorTables* tables) {
+  tables->FieldsByJsonKeysLazyInitInternal();
+}
+
+void FileDescriptorTables::FieldsByJsonKeysLazyInitInternal() const {
+  // A key may name different fields in different ways.  The camelCase name
+  // takes precedence over the proto name, which takes precedence over a custom
+  // json_name; ties are broken like in FieldsByCamelcaseNamesLazyInitInternal.
+  auto* map = new FieldsByNameMap;
+  FieldsByNameMap custom_json_names;
+  for (Symbol symbol : symbols_by_parent_) {
+    const FieldDescriptor* field = symbol.field_descriptor();
+    if (!field || field->is_extension()) continue;
+    const FieldDescriptor*& found =
+        (*map)[{field->containing_type(), field->camelcase_name()}];
+    if (found == nullptr || found->number() > field->number()) {
+      found = field;
+    }
+    if (field->has_json_name()) {
+      const FieldDescriptor*& found_json =
+          custom_json_names[{field->containing_type(), field->json_name()}];
+      if (found_json == nullptr || found_json->index() > field->index()) {
+        found_json = field;
+      }
+    }
+  }
+  for (Symbol symbol : symbols_by_parent_) {
+    const FieldDescriptor* field = symbol.field_descriptor();
+    if (!field || field->is_extension()) continue;
+    map->try_emplace({field->containing_type(), field->name()}, field);
+  }
+  for (const auto& entry : custom_json_names) {
+    map->insert(entry);
+  }
+  fields_by_json_key_.store(map, std::memory_order_release);
+}
+
+inline const FieldDescriptor* FileDescriptorTables::FindFieldByJsonKey(
+    const Descriptor* parent, absl::string_view key) const {
+  absl::call_once(fields_by_json_key_once_,
+                  FileDescriptorTables::FieldsByJsonKeysLazyInitStatic, this);
+  auto* fields = fields_by_json_key_.load(std::memory_order_acquire);
+  auto it = fields->find({parent, key});
+  if (it == fields->end()) return nullptr;
+  return it->second;
+}
+
 inline const EnumValueDescriptor* FileDescriptorTables::FindEnumValueByNumber(
     const EnumDescriptor* parent, int number) const {
   // If `number` is within the sequential range, just index into the parent
@@ -2257,6 +2401,10 @@ void DescriptorPool::InternalAddGeneratedFile(
 
 const FileDescriptor* DescriptorPool::FindFileByName(
     absl::string_view name) const {
+  if (mutex_ != nullptr) {
+    const FileDescriptor* result = tables_->FindFileInSnapshot(name);
+    if (result != nullptr) return result;
+  }
   DeferredValidation deferred_validation(this);
   const FileDescriptor* result = nullptr;
   {
@@ -2265,6 +2413,7 @@ const FileDescriptor* DescriptorPool::FindFileByName(
       tables_->known_bad_symbols_.clear();
       tables_->known_bad_files_.clear();
     }
+    if (mutex_ != nullptr) tables_->MaybePublishSnapshot();
     result = tables_->FindFile(name);
     if (result != nullptr) return result;
     if (underlay_ != nullptr) {
@@ -2283,6 +2432,10 @@ const FileDescriptor* DescriptorPool::FindFileByName(
 
 const FileDescriptor* DescriptorPool::FindFileContainingSymbol(
     absl::string_view symbol_name) const {
+  if (mutex_ != nullptr) {
+    Symbol result = tables_->FindSymbolInSnapshot(symbol_name);
+    if (!result.IsNull()) return result.GetFile();
+  }
   const FileDescriptor* file_result = nullptr;
   DeferredValidation deferred_validation(this);
   {
@@ -2291,6 +2444,7 @@ const FileDescriptor* DescriptorPool::FindFileContainingSymbol(
       tables_->known_bad_symbols_.clear();
       tables_->known_bad_files_.clear();
     }
+    if (mutex_ != nullptr) tables_->MaybePublishSnapshot();
     Symbol result = tables_->FindSymbol(symbol_name);
     if (!result.IsNull()) return result.GetFile();
     if (underlay_ != nullptr) {
@@ -2517,6 +2671,11 @@ const FieldDescriptor* Descriptor::FindFieldByCamelcaseName(
   }
 }
 
+const FieldDescriptor* Descriptor::FindFieldByJsonKey(
+    absl::string_view key) const {
+  return file()->tables_->FindFieldByJsonKey(this, key);
+}
+
 const FieldDescriptor* Descriptor::FindFieldByName(
     absl::string_view name) const {
   const FieldDescriptor* field =
@@ -4735,6 +4894,72 @@ const FileDescriptor* DescriptorPool::BuildFileCollectingErrors(
   return nullptr;
 }
 
+namespace {
+
+// Returns the indexes of `files` ordered so that each file comes after the
+// files in `files` which it depends on.  Files in an import cycle are left in
+// some order, and the builder reports the cycle.
+std::vector<size_t> DependencyOrder(
+    absl::Span<const FileDescriptorProto* const> files) {
+  absl::flat_hash_map<absl::string_view, size_t> index_by_name;
+  for (size_t i = 0; i < files.size(); ++i) {
+    index_by_name.try_emplace(files[i]->name(), i);
+  }
+  enum State : uint8_t { kUnvisited, kVisiting, kVisited };
+  std::vector<State> state(files.size(), kUnvisited);
+  std::vector<size_t> order;
+  order.reserve(files.size());
+  // Depth-first search with an explicit stack of (file, next dependency), as
+  // import chains can be deep.
+  std::vector<std::pair<size_t, int>> stack;
+  for (size_t root = 0; root < files.size(); ++root) {
+    if (state[root] != kUnvisited) continue;
+    state[root] = kVisiting;
+    stack.emplace_back(root, 0);
+    while (!stack.empty()) {
+      size_t file = stack.back().first;
+      int dependency = stack.back().second++;
+      if (dependency == files[file]->dependency_size()) {
+        state[file] = kVisited;
+        order.push_back(file);
+        stack.pop_back();
+        continue;
+      }
+      auto it = index_by_name.find(files[file]->dependency(dependency));
+      if (it != index_by_name.end() && state[it->second] == kUnvisited) {
+        state[it->second] = kVisiting;
+        stack.emplace_back(it->second, 0);
+      }
+    }
+  }
+  return order;
+}
+
+}  // namespace
+
+std::vector<const FileDescriptor*> DescriptorPool::BuildFiles(
+    absl::Span<const FileDescriptorProto* const> files,
+    ErrorCollector* error_collector) {
+  ABSL_CHECK(fallback_database_ == nullptr)
+      << "Cannot call BuildFiles on a DescriptorPool that uses a "
+         "DescriptorDatabase.  You must instead find a way to get your files "
+         "into the underlying database.";
+  ABSL_CHECK(mutex_ == nullptr);  // Implied by the above ABSL_CHECK.
+  std::vector<const FileDescriptor*> result(files.size());
+  tables_->known_bad_symbols_.clear();
+  tables_->known_bad_files_.clear();
+  build_started_ = true;
+  for (size_t i : DependencyOrder(files)) {
+    DeferredValidation deferred_validation(this, error_collector);
+    const FileDescriptor* file =
+        DescriptorBuilder::New(this, tables_.get(), deferred_validation,
+                               error_collector)
+            ->BuildFile(*files[i]);
+    result[i] = deferred_validation.Validate() ? file : nullptr;
+  }
+  return result;
+}
+
 const FileDescriptor* DescriptorPool::BuildFileFromDatabase(
     const FileDescriptorProto& proto,
     DeferredValidation& deferred_validation) const {
@@ -52,6 +52,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "google/protobuf/descriptor_lite.h"
 #include "google/protobuf/extension_set.h"
 #include "google/protobuf/port.h"
@@ -134,6 +135,10 @@ class Formatter;
 }  // namespace cpp
 }  // namespace compiler
 
+namespace json_internal {
+struct Proto2Descriptor;
+}  // namespace json_internal
+
 namespace descriptor_unittest {
 class DescriptorTest;
 class ValidationErrorTest;
@@ -672,6 +677,12 @@ class PROTOBUF_EXPORT Descriptor : private internal::SymbolBase {
   // Fill the json_name field of FieldDescriptorProto.
   void CopyJsonNameTo(DescriptorProto* proto) const;
 
+  // Looks up a field by any key the JSON parser accepts for it: its
+  // camelcase_name(), its name(), or its custom json_name(), in that order of
+  // precedence.  Extensions are not included.
+  const FieldDescriptor* FindFieldByJsonKey(absl::string_view key) const;
+  friend struct json_internal::Proto2Descriptor;
+
   // Internal version of DebugString; controls the level of indenting for
   // correct depth. Takes |options| to control debug-string options, and
   // |include_opening_clause| to indicate whether the "message ... " part of the
@@ -2234,6 +2245,18 @@ class PROTOBUF_EXPORT DescriptorPool {
   const FileDescriptor* BuildFileCollectingErrors(
       const FileDescriptorProto& proto, ErrorCollector* error_collector);
 
+  // Builds all of `files` as BuildFileCollectingErrors() would, in an order
+  // where each file comes after those of its dependencies which are also in
+  // `files`, so they need not be sorted.  Returns the resulting
+  // FileDescriptors in the same order as `files`, with nullptr for each file
+  // that failed to build.  The pool ends up identical to one built by calling
+  // BuildFile() on the files in dependency order.  Errors are sent to
+  // `error_collector` if it is non-null, or written to ABSL_LOG(ERROR)
+  // otherwise.
+  std::vector<const FileDescriptor*> BuildFiles(
+      absl::Span<const FileDescriptorProto* const> files,
+      ErrorCollector* error_collector = nullptr);
+
   // By default, it is an error if a FileDescriptorProto contains references
   // to types or other files that are not found in the DescriptorPool (or its
   // backing DescriptorDatabase, if any).  If you call
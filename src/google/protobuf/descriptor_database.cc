@@ -13,16 +13,23 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "absl/container/btree_set.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/endian.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
 #include "google/protobuf/parse_context.h"
 
 
@@ -883,6 +890,351 @@ EncodedDescriptorDatabase::~EncodedDescriptorDatabase() {
 
 // ===================================================================
 
+// An image is laid out as follows, where every integer is a little-endian
+// uint32 and every string or file is an (offset, size) pair pointing into the
+// data at the end.  Offsets are from the start of the image.
+//
+//   header:      "PBDI", version, file_count, symbol_count, extension_count
+//   files:       file_count x {name, data}, sorted by name
+//   symbols:     symbol_count x {name, file_index}, sorted by name
+//   extensions:  extension_count x {extendee, number, file_index}, sorted by
+//                extendee and then by number
+//   data:        names and serialized FileDescriptorProtos
+//
+// Like SimpleDescriptorDatabase, the symbol table only holds top-level
+// symbols, and no symbol in it is a sub-symbol of another.
+namespace {
+
+constexpr char kImageMagic[4] = {'P', 'B', 'D', 'I'};
+constexpr uint32_t kImageVersion = 1;
+constexpr size_t kImageHeaderSize = 5 * sizeof(uint32_t);
+constexpr size_t kImageFileEntrySize = 4 * sizeof(uint32_t);
+constexpr size_t kImageSymbolEntrySize = 3 * sizeof(uint32_t);
+constexpr size_t kImageExtensionEntrySize = 4 * sizeof(uint32_t);
+
+void Append32(uint32_t value, std::string* output) {
+  value = internal::little_endian::FromHost(value);
+  output->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Returns the first index in [0, count) for which `pred` is false, given that
+// `pred` is true for a prefix of the range.
+template <typename Pred>
+uint32_t PartitionPoint(uint32_t count, Pred pred) {
+  uint32_t lo = 0;
+  uint32_t hi = count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (pred(mid)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+void CollectNestedExtensions(
+    const DescriptorProto& message_type, uint32_t file_index,
+    std::vector<std::tuple<std::string, int, uint32_t>>* extensions) {
+  for (const DescriptorProto& nested : message_type.nested_type()) {
+    CollectNestedExtensions(nested, file_index, extensions);
+  }
+  for (const FieldDescriptorProto& field : message_type.extension()) {
+    if (absl::StartsWith(field.extendee(), ".")) {
+      extensions->emplace_back(field.extendee().substr(1), field.number(),
+                               file_index);
+    }
+  }
+}
+
+}  // namespace
+
+bool DescriptorImageDatabase::Serialize(const FileDescriptorSet& files,
+                                        std::string* output) {
+  // SimpleDescriptorDatabase finds and reports any conflicts, which also
+  // guarantees the invariants of the symbol table.
+  SimpleDescriptorDatabase checker;
+  for (const FileDescriptorProto& file : files.file()) {
+    if (!checker.AddUnowned(&file)) return false;
+  }
+
+  std::vector<std::pair<absl::string_view, uint32_t>> by_name;
+  std::vector<std::pair<std::string, uint32_t>> by_symbol;
+  std::vector<std::tuple<std::string, int, uint32_t>> by_extension;
+  for (uint32_t i = 0; i < static_cast<uint32_t>(files.file_size()); ++i) {
+    const FileDescriptorProto& file = files.file(i);
+    by_name.emplace_back(file.name(), i);
+    std::string path = file.has_package() ? file.package() : std::string();
+    if (!path.empty()) path += '.';
+    for (const DescriptorProto& message_type : file.message_type()) {
+      by_symbol.emplace_back(path + message_type.name(), i);
+      CollectNestedExtensions(message_type, i, &by_extension);
+    }
+    for (const EnumDescriptorProto& enum_type : file.enum_type()) {
+      by_symbol.emplace_back(path + enum_type.name(), i);
+    }
+    for (const FieldDescriptorProto& extension : file.extension()) {
+      by_symbol.emplace_back(path + extension.name(), i);
+      if (absl::StartsWith(extension.extendee(), ".")) {
+        by_extension.emplace_back(extension.extendee().substr(1),
+                                  extension.number(), i);
+      }
+    }
+    for (const ServiceDescriptorProto& service : file.service()) {
+      by_symbol.emplace_back(path + service.name(), i);
+    }
+  }
+  std::sort(by_name.begin(), by_name.end());
+  std::sort(by_symbol.begin(), by_symbol.end());
+  std::sort(by_extension.begin(), by_extension.end());
+
+  std::string data;
+  size_t data_start = kImageHeaderSize +
+                      by_name.size() * kImageFileEntrySize +
+                      by_symbol.size() * kImageSymbolEntrySize +
+                      by_extension.size() * kImageExtensionEntrySize;
+  auto append_data = [&](absl::string_view bytes, std::string* table) {
+    Append32(static_cast<uint32_t>(data_start + data.size()), table);
+    Append32(static_cast<uint32_t>(bytes.size()), table);
+    data.append(bytes.data(), bytes.size());
+  };
+
+  output->clear();
+  output->append(kImageMagic, sizeof(kImageMagic));
+  Append32(kImageVersion, output);
+  Append32(static_cast<uint32_t>(by_name.size()), output);
+  Append32(static_cast<uint32_t>(by_symbol.size()), output);
+  Append32(static_cast<uint32_t>(by_extension.size()), output);
+  // Files keep their order in the data, so that the file table can refer to
+  // them by index.
+  std::vector<std::string> serialized(files.file_size());
+  for (int i = 0; i < files.file_size(); ++i) {
+    files.file(i).SerializeToString(&serialized[i]);
+  }
+  std::string file_table;
+  for (const auto& entry : by_name) {
+    append_data(entry.first, &file_table);
+    append_data(serialized[entry.second], &file_table);
+  }
+  // Symbols and extensions refer to files by their position in the file
+  // table.
+  std::vector<uint32_t> table_index(files.file_size());
+  for (uint32_t i = 0; i < by_name.size(); ++i) {
+    table_index[by_name[i].second] = i;
+  }
+  std::string symbol_table;
+  for (const auto& entry : by_symbol) {
+    append_data(entry.first, &symbol_table);
+    Append32(table_index[entry.second], &symbol_table);
+  }
+  std::string extension_table;
+  for (const auto& entry : by_extension) {
+    append_data(std::get<0>(entry), &extension_table);
+    Append32(static_cast<uint32_t>(std::get<1>(entry)), &extension_table);
+    Append32(table_index[std::get<2>(entry)], &extension_table);
+  }
+  absl::StrAppend(output, file_table, symbol_table, extension_table, data);
+  if (output->size() > std::numeric_limits<uint32_t>::max()) {
+    ABSL_LOG(ERROR) << "Descriptor image is too large: " << output->size()
+                    << " bytes.";
+    return false;
+  }
+  return true;
+}
+
+DescriptorImageDatabase::DescriptorImageDatabase() = default;
+DescriptorImageDatabase::~DescriptorImageDatabase() = default;
+
+bool DescriptorImageDatabase::Load(const void* image, size_t size) {
+  image_ = nullptr;
+  size_ = 0;
+  file_count_ = symbol_count_ = extension_count_ = 0;
+  const char* bytes = static_cast<const char*>(image);
+  if (size < kImageHeaderSize ||
+      memcmp(bytes, kImageMagic, sizeof(kImageMagic)) != 0) {
+    ABSL_LOG(ERROR) << "Not a descriptor image.";
+    return false;
+  }
+  image_ = bytes;
+  size_ = size;
+  if (Load32(4) != kImageVersion) {
+    ABSL_LOG(ERROR) << "Unsupported descriptor image version: " << Load32(4);
+    image_ = nullptr;
+    size_ = 0;
+    return false;
+  }
+  uint64_t file_count = Load32(8);
+  uint64_t symbol_count = Load32(12);
+  uint64_t extension_count = Load32(16);
+  if (kImageHeaderSize + file_count * kImageFileEntrySize +
+          symbol_count * kImageSymbolEntrySize +
+          extension_count * kImageExtensionEntrySize >
+      size) {
+    ABSL_LOG(ERROR) << "Descriptor image is truncated.";
+    image_ = nullptr;
+    size_ = 0;
+    return false;
+  }
+  file_count_ = static_cast<uint32_t>(file_count);
+  symbol_count_ = static_cast<uint32_t>(symbol_count);
+  extension_count_ = static_cast<uint32_t>(extension_count);
+  return true;
+}
+
+bool DescriptorImageDatabase::LoadFromFileDescriptor(int file_descriptor) {
+  auto mapping = std::make_unique<io::MmapInputStream>(file_descriptor);
+  const void* data = nullptr;
+  int size = 0;
+  if (mapping->GetErrno() != 0 || !mapping->Next(&data, &size)) {
+    ABSL_LOG(ERROR) << "Failed to map descriptor image, errno: "
+                    << mapping->GetErrno();
+    return false;
+  }
+  const void* rest;
+  int rest_size;
+  if (mapping->Next(&rest, &rest_size)) {
+    ABSL_LOG(ERROR) << "Descriptor image is too large to map.";
+    return false;
+  }
+  if (!Load(data, static_cast<size_t>(size))) return false;
+  mapping_ = std::move(mapping);
+  return true;
+}
+
+uint32_t DescriptorImageDatabase::Load32(size_t offset) const {
+  uint32_t value;
+  memcpy(&value, image_ + offset, sizeof(value));
+  return internal::little_endian::ToHost(value);
+}
+
+bool DescriptorImageDatabase::Slice(uint32_t offset, uint32_t size,
+                                    absl::string_view* out) const {
+  if (offset > size_ || size > size_ - offset) {
+    ABSL_LOG(ERROR) << "Descriptor image is corrupt.";
+    return false;
+  }
+  *out = absl::string_view(image_ + offset, size);
+  return true;
+}
+
+size_t DescriptorImageDatabase::FileEntry(uint32_t i) const {
+  return kImageHeaderSize + size_t{i} * kImageFileEntrySize;
+}
+
+size_t DescriptorImageDatabase::SymbolEntry(uint32_t i) const {
+  return FileEntry(file_count_) + size_t{i} * kImageSymbolEntrySize;
+}
+
+size_t DescriptorImageDatabase::ExtensionEntry(uint32_t i) const {
+  return SymbolEntry(symbol_count_) + size_t{i} * kImageExtensionEntrySize;
+}
+
+bool DescriptorImageDatabase::FileName(uint32_t i,
+                                       absl::string_view* name) const {
+  return Slice(Load32(FileEntry(i)), Load32(FileEntry(i) + 4), name);
+}
+
+bool DescriptorImageDatabase::SymbolName(uint32_t i,
+                                         absl::string_view* name) const {
+  return Slice(Load32(SymbolEntry(i)), Load32(SymbolEntry(i) + 4), name);
+}
+
+bool DescriptorImageDatabase::Extendee(uint32_t i,
+                                       absl::string_view* name) const {
+  return Slice(Load32(ExtensionEntry(i)), Load32(ExtensionEntry(i) + 4), name);
+}
+
+int DescriptorImageDatabase::ExtensionNumber(uint32_t i) const {
+  return static_cast<int>(Load32(ExtensionEntry(i) + 8));
+}
+
+uint32_t DescriptorImageDatabase::LowerBoundExtension(
+    absl::string_view extendee, int number) const {
+  return PartitionPoint(extension_count_, [&](uint32_t i) {
+    absl::string_view name;
+    if (!Extendee(i, &name)) return false;
+    return name < extendee || (name == extendee && ExtensionNumber(i) < number);
+  });
+}
+
+bool DescriptorImageDatabase::ParseFile(uint32_t file_index,
+                                        FileDescriptorProto* output) const {
+  if (file_index >= file_count_) return false;
+  size_t entry = FileEntry(file_index);
+  absl::string_view data;
+  if (!Slice(Load32(entry + 8), Load32(entry + 12), &data)) return false;
+  return internal::ParseNoReflection(data, *output);
+}
+
+bool DescriptorImageDatabase::FindFileByName(const std::string& filename,
+                                             FileDescriptorProto* output) {
+  uint32_t i = PartitionPoint(file_count_, [&](uint32_t i) {
+    absl::string_view name;
+    return FileName(i, &name) && name < filename;
+  });
+  absl::string_view name;
+  if (i == file_count_ || !FileName(i, &name) || name != filename) {
+    return false;
+  }
+  return ParseFile(i, output);
+}
+
+bool DescriptorImageDatabase::FindFileContainingSymbol(
+    const std::string& symbol_name, FileDescriptorProto* output) {
+  // Find the last symbol which is less than or equal to symbol_name; see
+  // SimpleDescriptorDatabase::DescriptorIndex for why that is the only one
+  // which can be a parent of it.
+  uint32_t i = PartitionPoint(symbol_count_, [&](uint32_t i) {
+    absl::string_view name;
+    return SymbolName(i, &name) && name <= symbol_name;
+  });
+  if (i == 0) return false;
+  --i;
+  absl::string_view name;
+  if (!SymbolName(i, &name) || !IsSubSymbol(name, symbol_name)) return false;
+  return ParseFile(Load32(SymbolEntry(i) + 8), output);
+}
+
+bool DescriptorImageDatabase::FindFileContainingExtension(
+    const std::string& containing_type, int field_number,
+    FileDescriptorProto* output) {
+  uint32_t i = LowerBoundExtension(containing_type, field_number);
+  absl::string_view name;
+  if (i == extension_count_ || !Extendee(i, &name) ||
+      name != containing_type || ExtensionNumber(i) != field_number) {
+    return false;
+  }
+  return ParseFile(Load32(ExtensionEntry(i) + 12), output);
+}
+
+bool DescriptorImageDatabase::FindAllExtensionNumbers(
+    const std::string& extendee_type, std::vector<int>* output) {
+  bool success = false;
+  absl::string_view name;
+  for (uint32_t i = LowerBoundExtension(extendee_type,
+                                        std::numeric_limits<int>::min());
+       i < extension_count_ && Extendee(i, &name) && name == extendee_type;
+       ++i) {
+    output->push_back(ExtensionNumber(i));
+    success = true;
+  }
+  return success;
+}
+
+bool DescriptorImageDatabase::FindAllFileNames(
+    std::vector<std::string>* output) {
+  output->reserve(output->size() + file_count_);
+  for (uint32_t i = 0; i < file_count_; ++i) {
+    absl::string_view name;
+    if (!FileName(i, &name)) return false;
+    output->emplace_back(name);
+  }
+  return true;
+}
+
+// ===================================================================
+
 DescriptorPoolDatabase::DescriptorPoolDatabase(
     const DescriptorPool& pool, DescriptorPoolDatabaseOptions options)
     : pool_(pool), options_(std::move(options)) {}
@@ -14,11 +14,15 @@
 #ifndef GOOGLE_PROTOBUF_DESCRIPTOR_DATABASE_H__
 #define GOOGLE_PROTOBUF_DESCRIPTOR_DATABASE_H__
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/container/btree_map.h"
+#include "absl/strings/string_view.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/port.h"
 
@@ -31,11 +35,16 @@
 
 namespace google {
 namespace protobuf {
+namespace io {
+class MmapInputStream;
+}  // namespace io
+class FileDescriptorSet;
 
 // Defined in this file.
 class DescriptorDatabase;
 class SimpleDescriptorDatabase;
 class EncodedDescriptorDatabase;
+class DescriptorImageDatabase;
 class DescriptorPoolDatabase;
 class MergedDescriptorDatabase;
 
@@ -311,6 +320,87 @@ class PROTOBUF_EXPORT EncodedDescriptorDatabase : public DescriptorDatabase {
                   FileDescriptorProto* output);
 };
 
+// A read-only database backed by a precompiled descriptor image: one blob
+// holding serialized FileDescriptorProtos together with sorted indexes of their
+// file names, symbols and extensions.  Loading an image reads only its header,
+// so a binary with thousands of .proto files starts up without indexing or
+// copying them, and a DescriptorPool on top of the database builds just the
+// files that are actually used.  All offsets in the image are relative to its
+// start, so it can be mapped from a file at any address.
+//
+// Images are made with Serialize(), typically at build time from the output of
+// `protoc --include_imports --descriptor_set_out`.
+//
+// The same caveats regarding FindFileContainingExtension() apply as with
+// SimpleDescriptorDatabase.
+class PROTOBUF_EXPORT DescriptorImageDatabase : public DescriptorDatabase {
+ public:
+  DescriptorImageDatabase();
+  DescriptorImageDatabase(const DescriptorImageDatabase&) = delete;
+  DescriptorImageDatabase& operator=(const DescriptorImageDatabase&) = delete;
+  ~DescriptorImageDatabase() override;
+
+  // Serializes `files` into an image in *output.  Returns false if the files
+  // conflict with each other in any way that SimpleDescriptorDatabase::Add()
+  // rejects, in which case an error will have been written to
+  // ABSL_LOG(ERROR).
+  static bool Serialize(const FileDescriptorSet& files, std::string* output);
+
+  // Uses the image in the given bytes, replacing any image loaded before.  The
+  // database does not make a copy of the bytes, nor does it take ownership;
+  // it's up to the caller to make sure the bytes remain valid for the life of
+  // the database.  Returns false and logs an error if the bytes do not start
+  // with a valid image header.
+  bool Load(const void* image, size_t size);
+
+  // Like Load(), but maps the image from the given file read-only.  The
+  // mapping is owned by the database, and the file descriptor can be closed
+  // once this returns.
+  bool LoadFromFileDescriptor(int file_descriptor);
+
+  // implements DescriptorDatabase -----------------------------------
+  bool FindFileByName(const std::string& filename,
+                      FileDescriptorProto* output) override;
+  bool FindFileContainingSymbol(const std::string& symbol_name,
+                                FileDescriptorProto* output) override;
+  bool FindFileContainingExtension(const std::string& containing_type,
+                                   int field_number,
+                                   FileDescriptorProto* output) override;
+  bool FindAllExtensionNumbers(const std::string& extendee_type,
+                               std::vector<int>* output) override;
+  bool FindAllFileNames(std::vector<std::string>* output) override;
+
+ private:
+  // Return the offsets of the entries of the image's tables.
+  size_t FileEntry(uint32_t i) const;
+  size_t SymbolEntry(uint32_t i) const;
+  size_t ExtensionEntry(uint32_t i) const;
+
+  // Accessors for the entries of the image's tables.  Return false if the
+  // entry refers to bytes outside the image.
+  bool FileName(uint32_t i, absl::string_view* name) const;
+  bool SymbolName(uint32_t i, absl::string_view* name) const;
+  bool Extendee(uint32_t i, absl::string_view* name) const;
+  int ExtensionNumber(uint32_t i) const;
+
+  // Returns the first extension entry at or after (extendee, number).
+  uint32_t LowerBoundExtension(absl::string_view extendee, int number) const;
+
+  // Parses the file at index `file_index` into *output.  Returns false if the
+  // index or the file is invalid.
+  bool ParseFile(uint32_t file_index, FileDescriptorProto* output) const;
+
+  uint32_t Load32(size_t offset) const;
+  bool Slice(uint32_t offset, uint32_t size, absl::string_view* out) const;
+
+  const char* image_ = nullptr;
+  size_t size_ = 0;
+  uint32_t file_count_ = 0;
+  uint32_t symbol_count_ = 0;
+  uint32_t extension_count_ = 0;
+  std::unique_ptr<io::MmapInputStream> mapping_;
+};
+
 struct PROTOBUF_EXPORT DescriptorPoolDatabaseOptions {
   // If true, the database will preserve source code info when returning
   // descriptors.
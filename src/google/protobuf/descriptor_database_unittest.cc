@@ -13,14 +13,24 @@
 
 #include "google/protobuf/descriptor_database.h"
 
+#include <fcntl.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 #include <algorithm>
 #include <memory>
+#include <string>
 
 #include "google/protobuf/descriptor.pb.h"
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/io/io_win32.h"
 #include "google/protobuf/test_textproto.h"
+#include "google/protobuf/testing/file.h"
 #include "google/protobuf/text_format.h"
 
 
@@ -28,6 +38,13 @@ namespace google {
 namespace protobuf {
 namespace {
 
+#ifdef _WIN32
+// DO NOT include <io.h>, instead create functions in io_win32.{h,cc} and import
+// them like we do below.
+using google::protobuf::io::win32::close;
+using google::protobuf::io::win32::open;
+#endif
+
 static void AddToDatabase(SimpleDescriptorDatabase* database,
                           const char* file_text) {
   FileDescriptorProto file_proto;
@@ -102,6 +119,32 @@ class EncodedDescriptorDatabaseTestCase : public DescriptorDatabaseTestCase {
   EncodedDescriptorDatabase database_;
 };
 
+// Specialization for DescriptorImageDatabase.  Each file added rebuilds the
+// image from scratch.
+class DescriptorImageDatabaseTestCase : public DescriptorDatabaseTestCase {
+ public:
+  static DescriptorDatabaseTestCase* New() {
+    return new DescriptorImageDatabaseTestCase;
+  }
+
+  ~DescriptorImageDatabaseTestCase() override {}
+
+  DescriptorDatabase* GetDatabase() override { return &database_; }
+  bool AddToDatabase(const FileDescriptorProto& file) override {
+    *files_.add_file() = file;
+    if (!DescriptorImageDatabase::Serialize(files_, &image_)) {
+      files_.mutable_file()->RemoveLast();
+      return false;
+    }
+    return database_.Load(image_.data(), image_.size());
+  }
+
+ private:
+  FileDescriptorSet files_;
+  std::string image_;
+  DescriptorImageDatabase database_;
+};
+
 // Specialization for DescriptorPoolDatabase.
 class DescriptorPoolDatabaseTestCase : public DescriptorDatabaseTestCase {
  public:
@@ -453,6 +496,86 @@ INSTANTIATE_TEST_SUITE_P(
     testing::Values(&EncodedDescriptorDatabaseTestCase::New));
 INSTANTIATE_TEST_SUITE_P(Pool, DescriptorDatabaseTest,
                          testing::Values(&DescriptorPoolDatabaseTestCase::New));
+INSTANTIATE_TEST_SUITE_P(
+    Image, DescriptorDatabaseTest,
+    testing::Values(&DescriptorImageDatabaseTestCase::New));
+
+TEST(DescriptorImageDatabaseExtraTest, BuildsPool) {
+  const FileDescriptor* original_file =
+      FileDescriptorProto::descriptor()->file();
+  FileDescriptorSet files;
+  original_file->CopyTo(files.add_file());
+  std::string image;
+  ASSERT_TRUE(DescriptorImageDatabase::Serialize(files, &image));
+
+  DescriptorImageDatabase database;
+  ASSERT_TRUE(database.Load(image.data(), image.size()));
+  std::vector<std::string> file_names;
+  EXPECT_TRUE(database.FindAllFileNames(&file_names));
+  EXPECT_THAT(file_names, testing::ElementsAre(original_file->name()));
+
+  DescriptorPool pool(&database);
+  const Descriptor* type =
+      pool.FindMessageTypeByName("google.protobuf.FileDescriptorProto");
+  ASSERT_TRUE(type != nullptr);
+  EXPECT_EQ(original_file->DebugString(), type->file()->DebugString());
+}
+
+TEST(DescriptorImageDatabaseExtraTest, RejectsBadImages) {
+  FileDescriptorSet files;
+  FileDescriptorProto* file = files.add_file();
+  file->set_name("foo.proto");
+  file->add_message_type()->set_name("Foo");
+  std::string image;
+  ASSERT_TRUE(DescriptorImageDatabase::Serialize(files, &image));
+
+  DescriptorImageDatabase database;
+  EXPECT_FALSE(database.Load("not an image", 12));
+  EXPECT_FALSE(database.Load(image.data(), 20));
+
+  // Entries which point outside the image are not followed.  The symbol names
+  // come last.
+  ASSERT_TRUE(database.Load(image.data(), image.size() - 1));
+  FileDescriptorProto output;
+  EXPECT_FALSE(database.FindFileContainingSymbol("Foo", &output));
+  EXPECT_TRUE(database.FindFileByName("foo.proto", &output));
+
+  ASSERT_TRUE(database.Load(image.data(), image.size()));
+  EXPECT_TRUE(database.FindFileContainingSymbol("Foo.Bar", &output));
+  EXPECT_EQ(output.name(), "foo.proto");
+}
+
+TEST(DescriptorImageDatabaseExtraTest, LoadsFromFile) {
+  FileDescriptorSet files;
+  FileDescriptorProto::descriptor()->file()->CopyTo(files.add_file());
+  std::string image;
+  ASSERT_TRUE(DescriptorImageDatabase::Serialize(files, &image));
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/descriptor_image_test_file");
+  ASSERT_TRUE(File::SetContents(filename, image, true).ok());
+
+  DescriptorImageDatabase database;
+  int file = open(filename.c_str(), O_RDONLY);
+  ASSERT_GE(file, 0);
+  bool loaded = database.LoadFromFileDescriptor(file);
+  // The database keeps its own mapping of the file.
+  close(file);
+  ASSERT_TRUE(loaded);
+
+  FileDescriptorProto output;
+  ASSERT_TRUE(database.FindFileContainingSymbol(
+      "google.protobuf.FileDescriptorProto", &output));
+  EXPECT_EQ(output.DebugString(), files.file(0).DebugString());
+  DescriptorPool pool(&database);
+  EXPECT_TRUE(pool.FindMessageTypeByName(
+                  "google.protobuf.FieldDescriptorProto") != nullptr);
+
+  ASSERT_TRUE(File::SetContents(filename, "not an image", true).ok());
+  file = open(filename.c_str(), O_RDONLY);
+  ASSERT_GE(file, 0);
+  EXPECT_FALSE(database.LoadFromFileDescriptor(file));
+  close(file);
+}
 
 TEST(EncodedDescriptorDatabaseExtraTest, FindNameOfFileContainingSymbol) {
   // Create two files, one of which is in two parts.
@@ -23,6 +23,7 @@
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -12082,6 +12083,89 @@ TEST_F(ValidationErrorTest, PackageTooLong) {
 }
 
 
+// ===================================================================
+// BuildFiles
+
+// Collects `file` and its transitive dependencies, dependencies first.
+void CollectFileAndDependencies(const FileDescriptor* file,
+                                absl::flat_hash_set<std::string>* seen,
+                                std::vector<FileDescriptorProto>* output) {
+  if (!seen->insert(file->name()).second) return;
+  for (int i = 0; i < file->dependency_count(); ++i) {
+    CollectFileAndDependencies(file->dependency(i), seen, output);
+  }
+  output->emplace_back();
+  file->CopyTo(&output->back());
+}
+
+TEST(BuildFilesTest, MatchesSerialBuild) {
+  const FileDescriptor* original_file =
+      protobuf_unittest::TestAllTypes::descriptor()->file();
+  absl::flat_hash_set<std::string> seen;
+  std::vector<FileDescriptorProto> protos;
+  CollectFileAndDependencies(original_file, &seen, &protos);
+  // Dependents first, so that BuildFiles() has to reorder them.
+  std::vector<const FileDescriptorProto*> files;
+  for (auto it = protos.rbegin(); it != protos.rend(); ++it) {
+    files.push_back(&*it);
+  }
+
+  DescriptorPool pool;
+  std::vector<const FileDescriptor*> result = pool.BuildFiles(files);
+
+  ASSERT_EQ(result.size(), files.size());
+  DescriptorPool serial_pool;
+  for (auto it = files.rbegin(); it != files.rend(); ++it) {
+    ASSERT_TRUE(serial_pool.BuildFile(**it) != nullptr);
+  }
+  for (size_t i = 0; i < files.size(); ++i) {
+    ASSERT_TRUE(result[i] != nullptr) << files[i]->name();
+    EXPECT_EQ(result[i], pool.FindFileByName(files[i]->name()));
+    EXPECT_EQ(result[i]->DebugString(),
+              serial_pool.FindFileByName(files[i]->name())->DebugString());
+  }
+}
+
+TEST(BuildFilesTest, Errors) {
+  FileDescriptorProto foo;
+  ASSERT_TRUE(TextFormat::ParseFromString(
+      R"pb(
+        name: "foo.proto"
+        message_type { name: "Foo" }
+        message_type { name: "Foo" }
+      )pb",
+      &foo));
+  FileDescriptorProto bar;
+  ASSERT_TRUE(TextFormat::ParseFromString(
+      R"pb(
+        name: "bar.proto"
+        dependency: "foo.proto"
+        message_type { name: "Bar" }
+      )pb",
+      &bar));
+  FileDescriptorProto baz;
+  ASSERT_TRUE(TextFormat::ParseFromString(
+      R"pb(
+        name: "baz.proto"
+        message_type { name: "Baz" }
+      )pb",
+      &baz));
+
+  DescriptorPool pool;
+  MockErrorCollector error_collector;
+  std::vector<const FileDescriptor*> result =
+      pool.BuildFiles({&bar, &foo, &baz}, &error_collector);
+  ASSERT_EQ(result.size(), 3);
+  EXPECT_EQ(result[0], nullptr);
+  EXPECT_EQ(result[1], nullptr);
+  ASSERT_NE(result[2], nullptr);
+  EXPECT_EQ(result[2]->name(), "baz.proto");
+  EXPECT_EQ(error_collector.text_,
+            "foo.proto: Foo: NAME: \"Foo\" is already defined.\n"
+            "bar.proto: foo.proto: IMPORT: Import \"foo.proto\" has not been "
+            "loaded.\n");
+}
+
 // ===================================================================
 // DescriptorDatabase
 
@@ -12407,6 +12491,47 @@ TEST_F(DatabaseBackedPoolTest, UnittestProto) {
   EXPECT_EQ(original_file->DebugString(), file_from_database->DebugString());
 }
 
+TEST_F(DatabaseBackedPoolTest, ConcurrentLookups) {
+  // Lookups race with the lazy building of files from the database, and with
+  // the publishing of the lock-free snapshot of the pool's tables.
+  const FileDescriptor* original_file =
+      protobuf_unittest::TestAllTypes::descriptor()->file();
+  DescriptorPoolDatabase database(*DescriptorPool::generated_pool());
+  DescriptorPool pool(&database);
+
+  std::vector<std::string> names;
+  for (int i = 0; i < original_file->message_type_count(); ++i) {
+    names.push_back(original_file->message_type(i)->full_name());
+  }
+  std::atomic<int> failures{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&, t] {
+      for (int round = 0; round < 10; ++round) {
+        for (size_t i = 0; i < names.size(); ++i) {
+          const std::string& name = names[(i + t) % names.size()];
+          const Descriptor* type = pool.FindMessageTypeByName(name);
+          if (type == nullptr || type->full_name() != name ||
+              pool.FindFileByName(original_file->name()) != type->file() ||
+              pool.FindFileContainingSymbol(name) != type->file()) {
+            ++failures;
+          }
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(failures.load(), 0);
+
+  const Descriptor* type =
+      pool.FindMessageTypeByName("protobuf_unittest.TestAllTypes");
+  ASSERT_TRUE(type != nullptr);
+  EXPECT_EQ(type->FindFieldByName("optional_int32"),
+            pool.FindFieldByName(
+                "protobuf_unittest.TestAllTypes.optional_int32"));
+  EXPECT_TRUE(pool.FindMessageTypeByName("NoSuchType") == nullptr);
+}
+
 TEST_F(DatabaseBackedPoolTest, FeatureResolution) {
   {
     FileDescriptorProto proto;
@@ -42,9 +42,11 @@
 #include "google/protobuf/dynamic_message.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <new>
 #include <string>
@@ -53,6 +55,9 @@
 #include "absl/base/attributes.h"
 #include "absl/hash/hash.h"
 #include "absl/log/absl_check.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "absl/utility/utility.h"
 #include "google/protobuf/arenastring.h"
@@ -1032,12 +1037,82 @@ DynamicMessageFactory::~DynamicMessageFactory() {
   for (auto iter = prototypes_.begin(); iter != prototypes_.end(); ++iter) {
     delete iter->second;
   }
+  delete[] published_.load(std::memory_order_relaxed);
+}
+
+DynamicMessageFactory::PublishedShard& DynamicMessageFactory::ShardFor(
+    PublishedShard* shards, const Descriptor* type) {
+  return shards[absl::Hash<const Descriptor*>()(type) % kPublishedShardCount];
+}
+
+const Message* DynamicMessageFactory::FindPublishedPrototype(
+    const Descriptor* type) {
+  PublishedShard* shards = published_.load(std::memory_order_acquire);
+  if (shards == nullptr) return nullptr;
+  PublishedShard& shard = ShardFor(shards, type);
+  absl::ReaderMutexLock lock(&shard.mutex);
+  auto it = shard.prototypes.find(type);
+  return it == shard.prototypes.end() ? nullptr : it->second;
 }
 
 const Message* DynamicMessageFactory::GetPrototype(const Descriptor* type) {
   ABSL_CHECK(type != nullptr);
-  absl::MutexLock lock(&prototypes_mutex_);
-  return GetPrototypeNoLock(type);
+  if (delegate_to_generated_factory_ &&
+      type->file()->pool() == DescriptorPool::generated_pool()) {
+    const Message* result = MessageFactory::TryGetGeneratedPrototype(type);
+    if (result != nullptr) return result;
+  }
+  const Message* result = FindPublishedPrototype(type);
+  if (result != nullptr) return result;
+
+  PublishedShard* shards;
+  {
+    absl::MutexLock lock(&prototypes_mutex_);
+    result = GetPrototypeNoLock(type);
+    shards = published_.load(std::memory_order_relaxed);
+    if (shards == nullptr) {
+      shards = new PublishedShard[kPublishedShardCount];
+      published_.store(shards, std::memory_order_release);
+    }
+  }
+  // GetPrototypeNoLock() hands out prototypes which are still being built to
+  // the types they cross-link with, but by the time the outermost call
+  // returns everything it started is complete and safe to share.
+  PublishedShard& shard = ShardFor(shards, type);
+  absl::MutexLock lock(&shard.mutex);
+  shard.prototypes.emplace(type, result);
+  return result;
+}
+
+namespace {
+
+void PrebuildMessageType(DynamicMessageFactory& factory,
+                         const Descriptor* type) {
+  factory.GetPrototype(type);
+  for (int i = 0; i < type->nested_type_count(); ++i) {
+    PrebuildMessageType(factory, type->nested_type(i));
+  }
+}
+
+}  // namespace
+
+void DynamicMessageFactory::PrebuildPrototypes(
+    absl::Span<const FileDescriptor* const> files,
+    absl::FunctionRef<void(std::function<void()> task)> executor) {
+  absl::BlockingCounter pending(static_cast<int>(files.size()));
+  for (const FileDescriptor* file : files) {
+    executor([this, file, &pending] {
+      for (int i = 0; i < file->message_type_count(); ++i) {
+        PrebuildMessageType(*this, file->message_type(i));
+      }
+      pending.DecrementCount();
+    });
+  }
+  pending.Wait();
+}
+
+void DynamicMessageFactory::PrebuildPrototypes(const FileDescriptor* file) {
+  PrebuildPrototypes({file}, [](std::function<void()> task) { task(); });
 }
 
 const Message* DynamicMessageFactory::GetPrototypeNoLock(
@@ -16,14 +16,19 @@
 #define GOOGLE_PROTOBUF_DYNAMIC_MESSAGE_H__
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
+#include "absl/base/optimization.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/absl_log.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/reflection.h"
@@ -111,9 +116,25 @@ class PROTOBUF_EXPORT DynamicMessageFactory : public MessageFactory {
   // The given descriptor must be non-null and outlive the returned message, and
   // hence must outlive the DynamicMessageFactory.
   //
-  // The method is thread-safe.
+  // The method is thread-safe.  Once a type's prototype has been built, later
+  // calls for it only take a reader lock on one of several shards, so callers
+  // asking for different types rarely contend.
   const Message* GetPrototype(const Descriptor* type) override;
 
+  // Builds the prototype of every message type defined in `files`, including
+  // nested types, so that later calls to GetPrototype() for them never have
+  // to build anything.  Each file is handed to `executor` as a separate task;
+  // the task must eventually run, and may run inline.  Returns once all of
+  // the tasks have finished.  Building a prototype is still serialized within
+  // the factory, so the executor mainly takes the warm-up off the caller's
+  // thread.
+  void PrebuildPrototypes(
+      absl::Span<const FileDescriptor* const> files,
+      absl::FunctionRef<void(std::function<void()> task)> executor);
+
+  // Same as above, building the types of `file` on the calling thread.
+  void PrebuildPrototypes(const FileDescriptor* file);
+
  private:
   const DescriptorPool* pool_;
   bool delegate_to_generated_factory_;
@@ -122,6 +143,22 @@ class PROTOBUF_EXPORT DynamicMessageFactory : public MessageFactory {
   absl::flat_hash_map<const Descriptor*, const TypeInfo*> prototypes_;
   mutable absl::Mutex prototypes_mutex_;
 
+  // Prototypes which are fully built, copied out of `prototypes_` so they can
+  // be found without taking `prototypes_mutex_`.  Entries are only ever added,
+  // after the prototype and everything it cross-links to are complete.  The
+  // shards are allocated with the first prototype, so a factory which is never
+  // used only pays for the pointer.
+  struct alignas(ABSL_CACHELINE_SIZE) PublishedShard {
+    absl::Mutex mutex;
+    absl::flat_hash_map<const Descriptor*, const Message*> prototypes;
+  };
+  static constexpr int kPublishedShardCount = 16;
+  std::atomic<PublishedShard*> published_{nullptr};
+
+  static PublishedShard& ShardFor(PublishedShard* shards,
+                                  const Descriptor* type);
+  const Message* FindPublishedPrototype(const Descriptor* type);
+
   friend class DynamicMessage;
   const Message* GetPrototypeNoLock(const Descriptor* type);
 };
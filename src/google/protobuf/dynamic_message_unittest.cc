@@ -20,8 +20,11 @@
 #include "google/protobuf/dynamic_message.h"
 
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "google/protobuf/descriptor.pb.h"
@@ -338,6 +341,85 @@ TEST_F(DynamicMessageTest, Proto3) {
 
 INSTANTIATE_TEST_SUITE_P(UseArena, DynamicMessageTest, ::testing::Bool());
 
+void AddMessageTypes(const Descriptor* type,
+                     std::vector<const Descriptor*>* types) {
+  types->push_back(type);
+  for (int i = 0; i < type->nested_type_count(); ++i) {
+    AddMessageTypes(type->nested_type(i), types);
+  }
+}
+
+std::vector<const Descriptor*> AllMessageTypes(
+    const std::vector<const FileDescriptor*>& files) {
+  std::vector<const Descriptor*> types;
+  for (const FileDescriptor* file : files) {
+    for (int i = 0; i < file->message_type_count(); ++i) {
+      AddMessageTypes(file->message_type(i), &types);
+    }
+  }
+  return types;
+}
+
+TEST(DynamicMessageFactoryTest, ConcurrentGetPrototype) {
+  DescriptorPool pool;
+  std::vector<const FileDescriptor*> files;
+  AddUnittestDescriptors(pool, &files);
+  std::vector<const Descriptor*> types = AllMessageTypes(files);
+  DynamicMessageFactory factory(&pool);
+
+  // Each thread walks the types from a different starting point, so some of
+  // them race to build the same prototype while others find it published.
+  constexpr int kThreads = 8;
+  std::vector<std::vector<const Message*>> results(kThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      results[t].resize(types.size());
+      for (size_t i = 0; i < types.size(); ++i) {
+        size_t index = (i + t * types.size() / kThreads) % types.size();
+        results[t][index] = factory.GetPrototype(types[index]);
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  for (size_t i = 0; i < types.size(); ++i) {
+    const Message* prototype = factory.GetPrototype(types[i]);
+    EXPECT_EQ(prototype->GetDescriptor(), types[i]);
+    for (int t = 0; t < kThreads; ++t) {
+      EXPECT_EQ(results[t][i], prototype) << types[i]->full_name();
+    }
+  }
+}
+
+TEST(DynamicMessageFactoryTest, PrebuildPrototypes) {
+  DescriptorPool pool;
+  std::vector<const FileDescriptor*> files;
+  AddUnittestDescriptors(pool, &files);
+  DynamicMessageFactory factory(&pool);
+
+  std::vector<std::thread> threads;
+  factory.PrebuildPrototypes(files, [&](std::function<void()> task) {
+    threads.emplace_back(std::move(task));
+  });
+  for (std::thread& thread : threads) thread.join();
+
+  for (const Descriptor* type : AllMessageTypes(files)) {
+    const Message* prototype = factory.GetPrototype(type);
+    EXPECT_EQ(prototype->GetDescriptor(), type);
+    EXPECT_EQ(prototype, factory.GetPrototype(type));
+  }
+
+  const Descriptor* descriptor =
+      pool.FindMessageTypeByName("protobuf_unittest.TestAllTypes");
+  std::unique_ptr<Message> message(factory.GetPrototype(descriptor)->New());
+  const FieldDescriptor* field =
+      descriptor->FindFieldByName("optional_nested_message");
+  EXPECT_EQ(message->GetReflection()->GetMessage(*message, field)
+                .GetDescriptor(),
+            field->message_type());
+}
+
 
 }  // namespace
 }  // namespace protobuf
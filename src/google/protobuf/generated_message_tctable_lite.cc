@@ -968,7 +968,7 @@ inline PROTOBUF_ALWAYS_INLINE const char* TcParser::PackedVarint(
   // pending hasbits now:
   SyncHasbits(msg, hasbits, table);
   auto* field = &RefAt<RepeatedField<FieldType>>(msg, data.offset());
-  return ctx->ReadPackedVarint(ptr, [field](uint64_t varint) {
+  return ctx->ReadPackedVarint(ptr, field, [](uint64_t varint) {
     FieldType val;
     if (zigzag) {
       if (sizeof(FieldType) == 8) {
@@ -979,7 +979,7 @@ inline PROTOBUF_ALWAYS_INLINE const char* TcParser::PackedVarint(
     } else {
       val = varint;
     }
-    field->Add(val);
+    return val;
   });
 }
 
@@ -2039,12 +2039,13 @@ const char* TcParser::MpPackedVarintT(PROTOBUF_TC_PARAM_DECL) {
       }
     });
   } else {
-    return ctx->ReadPackedVarint(ptr, [=](uint64_t value) {
-      field->Add(is_zigzag ? (sizeof(FieldType) == 8
-                                  ? WireFormatLite::ZigZagDecode64(value)
-                                  : WireFormatLite::ZigZagDecode32(
-                                        static_cast<uint32_t>(value)))
-                           : value);
+    return ctx->ReadPackedVarint(ptr, field, [=](uint64_t value) {
+      return static_cast<FieldType>(
+          is_zigzag ? (sizeof(FieldType) == 8
+                           ? WireFormatLite::ZigZagDecode64(value)
+                           : WireFormatLite::ZigZagDecode32(
+                                 static_cast<uint32_t>(value)))
+                    : value);
     });
   }
 }
@@ -8,6 +8,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -16,9 +18,11 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "google/protobuf/endian.h"
 #include "google/protobuf/generated_message_tctable_decl.h"
 #include "google/protobuf/generated_message_tctable_impl.h"
 #include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/parse_context.h"
 #include "google/protobuf/unittest.pb.h"
 #include "google/protobuf/wire_format_lite.h"
@@ -945,6 +949,122 @@ TEST(GeneratedMessageTctableLiteTest,
   EXPECT_LE(proto.vals().Capacity(), 2048);
 }
 
+TEST(GeneratedMessageTctableLiteTest, PackedVarintMixedLengths) {
+  // Interleave runs of single byte varints, which are decoded in bulk, with
+  // multi byte ones so that runs straddle the input stream's buffer chunks.
+  protobuf_unittest::TestPackedTypes proto;
+  for (int i = 0; i < 1000; i++) {
+    int32_t value = i % 50 < 37 ? i % 128 : -i * 4099;
+    proto.add_packed_int32(value);
+    proto.add_packed_int64(
+        static_cast<int64_t>(static_cast<uint64_t>(value) << (i % 40)));
+    proto.add_packed_uint32(static_cast<uint32_t>(value));
+    proto.add_packed_uint64(static_cast<uint64_t>(value) * (i % 3));
+    proto.add_packed_sint32(value);
+    proto.add_packed_sint64(int64_t{value} * i);
+    proto.add_packed_bool(i % 7 == 0);
+  }
+  const std::string serialized = proto.SerializeAsString();
+
+  for (int block_size : {1, 7, 16, 100, 8192}) {
+    SCOPED_TRACE(block_size);
+    io::ArrayInputStream input(serialized.data(),
+                               static_cast<int>(serialized.size()), block_size);
+    protobuf_unittest::TestPackedTypes parsed;
+    ASSERT_TRUE(parsed.ParseFromZeroCopyStream(&input));
+    EXPECT_THAT(parsed.packed_int32(), ElementsAreArray(proto.packed_int32()));
+    EXPECT_THAT(parsed.packed_int64(), ElementsAreArray(proto.packed_int64()));
+    EXPECT_THAT(parsed.packed_uint32(),
+                ElementsAreArray(proto.packed_uint32()));
+    EXPECT_THAT(parsed.packed_uint64(),
+                ElementsAreArray(proto.packed_uint64()));
+    EXPECT_THAT(parsed.packed_sint32(),
+                ElementsAreArray(proto.packed_sint32()));
+    EXPECT_THAT(parsed.packed_sint64(),
+                ElementsAreArray(proto.packed_sint64()));
+    EXPECT_THAT(parsed.packed_bool(), ElementsAreArray(proto.packed_bool()));
+  }
+}
+
+TEST(GeneratedMessageTctableLiteTest, PackedFixedAcrossChunks) {
+  protobuf_unittest::TestPackedTypes proto;
+  for (int i = 0; i < 10000; i++) {
+    proto.add_packed_fixed32(i * 2654435761u);
+    proto.add_packed_sfixed64(
+        static_cast<int64_t>(i * uint64_t{0x9E3779B97F4A7C15}));
+    proto.add_packed_float(i * 0.25f);
+    proto.add_packed_double(i / 3.0);
+  }
+  const std::string serialized = proto.SerializeAsString();
+
+  for (int block_size : {1, 13, 4096}) {
+    SCOPED_TRACE(block_size);
+    io::ArrayInputStream input(serialized.data(),
+                               static_cast<int>(serialized.size()), block_size);
+    protobuf_unittest::TestPackedTypes parsed;
+    ASSERT_TRUE(parsed.ParseFromZeroCopyStream(&input));
+    EXPECT_THAT(parsed.packed_fixed32(),
+                ElementsAreArray(proto.packed_fixed32()));
+    EXPECT_THAT(parsed.packed_sfixed64(),
+                ElementsAreArray(proto.packed_sfixed64()));
+    EXPECT_THAT(parsed.packed_float(), ElementsAreArray(proto.packed_float()));
+    EXPECT_THAT(parsed.packed_double(),
+                ElementsAreArray(proto.packed_double()));
+  }
+}
+
+// Big endian hosts read packed fixed fields with CopyPackedFixedSwapped.
+// Feeding it values in the opposite of host byte order exercises that path on
+// any host.
+template <typename T, typename Bits>
+void ExpectCopyPackedFixedSwapped(const std::vector<T>& values) {
+  std::string swapped;
+  for (T value : values) {
+    Bits bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if constexpr (sizeof(bits) == 4) {
+      bits = BSwap32(bits);
+    } else {
+      bits = BSwap64(bits);
+    }
+    swapped.append(reinterpret_cast<const char*>(&bits), sizeof(bits));
+  }
+  // Start at an odd offset to read from an unaligned source.
+  swapped.insert(0, 1, '\0');
+  std::vector<T> copied(values.size());
+  CopyPackedFixedSwapped(copied.data(), swapped.data() + 1,
+                         static_cast<int>(values.size()));
+  EXPECT_THAT(copied, ElementsAreArray(values));
+}
+
+TEST(GeneratedMessageTctableLiteTest, CopyPackedFixedSwapped) {
+  std::vector<uint32_t> u32;
+  std::vector<int64_t> s64;
+  std::vector<float> f;
+  std::vector<double> d;
+  for (int i = 0; i < 37; i++) {
+    u32.push_back(i * 2654435761u);
+    s64.push_back(static_cast<int64_t>(i * uint64_t{0x9E3779B97F4A7C15}));
+    f.push_back(i * -0.25f);
+    d.push_back(i / 3.0);
+  }
+  ExpectCopyPackedFixedSwapped<uint32_t, uint32_t>(u32);
+  ExpectCopyPackedFixedSwapped<int64_t, uint64_t>(s64);
+  ExpectCopyPackedFixedSwapped<float, uint32_t>(f);
+  ExpectCopyPackedFixedSwapped<double, uint64_t>(d);
+}
+
+TEST(GeneratedMessageTctableLiteTest, PackedVarintTruncated) {
+  protobuf_unittest::TestPackedTypes proto;
+  for (int i = 0; i < 64; i++) proto.add_packed_int32(i);
+  proto.add_packed_int32(-1);
+  std::string serialized = proto.SerializeAsString();
+  // Set the continuation bit on the last byte of the trailing 10 byte varint
+  // so that it is unterminated.
+  serialized.back() = static_cast<char>(0x81);
+  protobuf_unittest::TestPackedTypes parsed;
+  EXPECT_FALSE(parsed.ParseFromString(serialized));
+}
 
 }  // namespace internal
 }  // namespace protobuf
@@ -88,6 +88,7 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <atomic>
 #include <climits>
 #include <cstddef>
@@ -878,9 +879,29 @@ class PROTOBUF_EXPORT EpsCopyOutputStream {
     ptr = WriteLengthDelim(num, size, ptr);
     auto it = r.data();
     auto end = it + r.size();
+    constexpr int kMaxVarintSize = sizeof(encode(*it)) == 4 ? 5 : 10;
     do {
       ptr = EnsureSpace(ptr);
-      ptr = UnsafeVarint(encode(*it++), ptr);
+      // Write as many elements as are guaranteed to fit in the buffer before
+      // checking for space again.
+      auto batch_end =
+          it + (std::min)(end - it, GetSize(ptr) / kMaxVarintSize);
+      while (batch_end - it >= 16) {
+        // The OR and the narrowing copy vectorize, turning a run of 16
+        // single byte varints into a handful of SIMD instructions.
+        decltype(encode(*it)) bits = 0;
+        for (int i = 0; i < 16; ++i) bits |= encode(it[i]);
+        if (PROTOBUF_PREDICT_TRUE(bits < 0x80)) {
+          for (int i = 0; i < 16; ++i) {
+            ptr[i] = static_cast<uint8_t>(encode(it[i]));
+          }
+          ptr += 16;
+        } else {
+          for (int i = 0; i < 16; ++i) ptr = UnsafeVarint(encode(it[i]), ptr);
+        }
+        it += 16;
+      }
+      while (it < batch_end) ptr = UnsafeVarint(encode(*it++), ptr);
     } while (it < end);
     return ptr;
   }
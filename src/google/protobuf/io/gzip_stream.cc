@@ -14,9 +14,21 @@
 #if HAVE_ZLIB
 #include "google/protobuf/io/gzip_stream.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
 #include "google/protobuf/stubs/common.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/port.h"
 
 namespace google {
@@ -24,6 +36,9 @@ namespace protobuf {
 namespace io {
 
 static const int kDefaultBufferSize = 65536;
+static const int kDefaultBlockSize = 128 * 1024;
+// The largest distance a deflate stream can refer back to.
+static const size_t kWindowSize = 32 * 1024;
 
 GzipInputStream::GzipInputStream(ZeroCopyInputStream* sub_stream, Format format,
                                  int buffer_size)
@@ -175,11 +190,346 @@ int64_t GzipInputStream::ByteCount() const {
 
 // =========================================================================
 
+// Compresses the input in blocks on worker threads, like pigz.  Each block
+// is compressed into raw deflate data ending on a byte boundary, using the
+// 32kB of input preceding it as its dictionary, so the compressed blocks
+// concatenate into a single deflate stream.  The calling thread writes the
+// compressed blocks to the sub-stream in order, between the header and the
+// trailer of the chosen format, whose check value is combined from the
+// check values of the blocks.
+class GzipOutputStream::ParallelDeflater {
+ public:
+  ParallelDeflater(ZeroCopyOutputStream* sub_stream, const Options& options);
+  ParallelDeflater(const ParallelDeflater&) = delete;
+  ParallelDeflater& operator=(const ParallelDeflater&) = delete;
+  ~ParallelDeflater();
+
+  // Like the methods of GzipOutputStream, but returning a zlib error code.
+  int Next(void** data, int* size);
+  void BackUp(int count);
+  int64_t ByteCount() const { return byte_count_ + block_used_; }
+  int Flush();
+  int Close();
+
+ private:
+  struct Block {
+    std::string input;
+    // The input preceding this block, at most kWindowSize bytes.
+    std::string dictionary;
+    bool last = false;
+    // Set by the worker under mu_ once the fields below are filled in.
+    bool done = false;
+    int error = Z_OK;
+    std::string output;
+    uLong check = 0;
+  };
+
+  // The body of the worker threads.
+  void CompressBlocks();
+  int CompressBlock(z_stream* zcontext, Block* block) const;
+
+  // Hands the current block to the workers.
+  int Submit(bool last);
+  // Waits for the oldest block in flight and writes it to the sub-stream.
+  int WriteFront();
+  bool FrontDone();
+  bool Write(const void* data, size_t size);
+  bool WriteHeader();
+  bool WriteTrailer();
+
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return stop_ || !pending_.empty();
+  }
+
+  ZeroCopyOutputStream* const sub_stream_;
+  const Format format_;
+  const int compression_level_;
+  const int compression_strategy_;
+  const size_t block_size_;
+  const size_t max_in_flight_;
+
+  // State of the calling thread.
+  std::string block_;
+  size_t block_used_ = 0;
+  int64_t byte_count_ = 0;
+  std::string dictionary_;
+  std::vector<std::string> spare_inputs_;
+  std::deque<std::unique_ptr<Block>> in_flight_;
+  bool header_written_ = false;
+  uLong check_;
+  uint32_t length_ = 0;  // Modulo 2^32, as in the gzip trailer.
+
+  absl::Mutex mu_;
+  std::deque<Block*> pending_ ABSL_GUARDED_BY(mu_);
+  bool stop_ ABSL_GUARDED_BY(mu_) = false;
+  std::vector<std::thread> workers_;
+};
+
+GzipOutputStream::ParallelDeflater::ParallelDeflater(
+    ZeroCopyOutputStream* sub_stream, const Options& options)
+    : sub_stream_(sub_stream),
+      format_(options.format),
+      compression_level_(options.compression_level),
+      compression_strategy_(options.compression_strategy),
+      block_size_(options.block_size),
+      max_in_flight_(2 * static_cast<size_t>(options.num_threads)),
+      check_(format_ == GZIP ? crc32(0, Z_NULL, 0) : adler32(0, Z_NULL, 0)) {
+  ABSL_CHECK_GT(options.block_size, 0);
+  workers_.reserve(options.num_threads);
+  for (int i = 0; i < options.num_threads; ++i) {
+    workers_.emplace_back([this] { CompressBlocks(); });
+  }
+}
+
+GzipOutputStream::ParallelDeflater::~ParallelDeflater() {
+  {
+    absl::MutexLock lock(&mu_);
+    stop_ = true;
+  }
+  for (auto& worker : workers_) worker.join();
+}
+
+void GzipOutputStream::ParallelDeflater::CompressBlocks() {
+  z_stream zcontext;
+  memset(&zcontext, 0, sizeof(zcontext));
+  // Negative window bits produce raw deflate data without header or trailer.
+  const int init_error =
+      deflateInit2(&zcontext, compression_level_, Z_DEFLATED,
+                   /* windowBits */ -15,
+                   /* memLevel (default) */ 8, compression_strategy_);
+  while (true) {
+    Block* block;
+    {
+      absl::MutexLock lock(&mu_);
+      mu_.Await(absl::Condition(this, &ParallelDeflater::HasWork));
+      if (stop_) break;
+      block = pending_.front();
+      pending_.pop_front();
+    }
+    const int error =
+        init_error == Z_OK ? CompressBlock(&zcontext, block) : init_error;
+    absl::MutexLock lock(&mu_);
+    block->error = error;
+    block->done = true;
+  }
+  if (init_error == Z_OK) deflateEnd(&zcontext);
+}
+
+int GzipOutputStream::ParallelDeflater::CompressBlock(z_stream* zcontext,
+                                                      Block* block) const {
+  int error = deflateReset(zcontext);
+  if (error == Z_OK && !block->dictionary.empty()) {
+    error = deflateSetDictionary(
+        zcontext, reinterpret_cast<const Bytef*>(block->dictionary.data()),
+        block->dictionary.size());
+  }
+  if (error != Z_OK) return error;
+
+  zcontext->next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(block->input.data()));
+  zcontext->avail_in = block->input.size();
+  // deflateBound() does not count the marker ending a sync flush.
+  block->output.resize(deflateBound(zcontext, block->input.size()) + 16);
+  zcontext->next_out = reinterpret_cast<Bytef*>(&block->output[0]);
+  zcontext->avail_out = block->output.size();
+  // A sync flush ends the data on a byte boundary without ending the
+  // stream, so that the next block can be appended to it.
+  const int flush = block->last ? Z_FINISH : Z_SYNC_FLUSH;
+  do {
+    if (zcontext->avail_out == 0) {
+      const size_t used = block->output.size();
+      block->output.resize(2 * used);
+      zcontext->next_out = reinterpret_cast<Bytef*>(&block->output[used]);
+      zcontext->avail_out = block->output.size() - used;
+    }
+    error = deflate(zcontext, flush);
+  } while (error == Z_OK && zcontext->avail_out == 0);
+  if (error != (block->last ? Z_STREAM_END : Z_OK)) {
+    return error == Z_OK ? Z_BUF_ERROR : error;
+  }
+  block->output.resize(block->output.size() - zcontext->avail_out);
+
+  const Bytef* input = reinterpret_cast<const Bytef*>(block->input.data());
+  block->check = format_ == GZIP
+                     ? crc32(crc32(0, Z_NULL, 0), input, block->input.size())
+                     : adler32(adler32(0, Z_NULL, 0), input,
+                               block->input.size());
+  return Z_OK;
+}
+
+int GzipOutputStream::ParallelDeflater::Next(void** data, int* size) {
+  if (block_used_ == block_size_) {
+    int error = Submit(/* last */ false);
+    if (error != Z_OK) return error;
+  }
+  block_.resize(block_size_);
+  *data = &block_[block_used_];
+  *size = static_cast<int>(block_size_ - block_used_);
+  block_used_ = block_size_;
+  return Z_OK;
+}
+
+void GzipOutputStream::ParallelDeflater::BackUp(int count) {
+  ABSL_CHECK_GE(block_used_, static_cast<size_t>(count));
+  block_used_ -= count;
+}
+
+int GzipOutputStream::ParallelDeflater::Flush() {
+  if (block_used_ > 0) {
+    int error = Submit(/* last */ false);
+    if (error != Z_OK) return error;
+  }
+  while (!in_flight_.empty()) {
+    int error = WriteFront();
+    if (error != Z_OK) return error;
+  }
+  return Z_OK;
+}
+
+int GzipOutputStream::ParallelDeflater::Close() {
+  int error = Submit(/* last */ true);
+  while (error == Z_OK && !in_flight_.empty()) {
+    error = WriteFront();
+  }
+  return error;
+}
+
+int GzipOutputStream::ParallelDeflater::Submit(bool last) {
+  // Write out the blocks that are already compressed, and bound the memory
+  // in use by waiting for the oldest block when too many are in flight.
+  while (!in_flight_.empty() &&
+         (in_flight_.size() >= max_in_flight_ || FrontDone())) {
+    int error = WriteFront();
+    if (error != Z_OK) return error;
+  }
+
+  auto block = std::make_unique<Block>();
+  block_.resize(block_used_);
+  block->input.swap(block_);
+  block->dictionary = dictionary_;
+  block->last = last;
+  byte_count_ += block_used_;
+  block_used_ = 0;
+  if (!spare_inputs_.empty()) {
+    block_.swap(spare_inputs_.back());
+    spare_inputs_.pop_back();
+  }
+
+  const std::string& input = block->input;
+  if (input.size() >= kWindowSize) {
+    dictionary_.assign(input, input.size() - kWindowSize, kWindowSize);
+  } else {
+    dictionary_.append(input);
+    if (dictionary_.size() > kWindowSize) {
+      dictionary_.erase(0, dictionary_.size() - kWindowSize);
+    }
+  }
+
+  Block* pending = block.get();
+  in_flight_.push_back(std::move(block));
+  absl::MutexLock lock(&mu_);
+  pending_.push_back(pending);
+  return Z_OK;
+}
+
+bool GzipOutputStream::ParallelDeflater::FrontDone() {
+  absl::MutexLock lock(&mu_);
+  return in_flight_.front()->done;
+}
+
+int GzipOutputStream::ParallelDeflater::WriteFront() {
+  Block* block = in_flight_.front().get();
+  {
+    absl::MutexLock lock(&mu_);
+    mu_.Await(absl::Condition(&block->done));
+  }
+  if (block->error != Z_OK) return block->error;
+
+  if (!header_written_) {
+    if (!WriteHeader()) return Z_BUF_ERROR;
+    header_written_ = true;
+  }
+  if (!Write(block->output.data(), block->output.size())) return Z_BUF_ERROR;
+  const z_off_t input_size = static_cast<z_off_t>(block->input.size());
+  check_ = format_ == GZIP ? crc32_combine(check_, block->check, input_size)
+                           : adler32_combine(check_, block->check, input_size);
+  length_ += static_cast<uint32_t>(block->input.size());
+  if (block->last && !WriteTrailer()) return Z_BUF_ERROR;
+
+  spare_inputs_.push_back(std::move(block->input));
+  in_flight_.pop_front();
+  return Z_OK;
+}
+
+bool GzipOutputStream::ParallelDeflater::Write(const void* data,
+                                               size_t size) {
+  const char* input = static_cast<const char*>(data);
+  while (size > 0) {
+    void* buffer;
+    int buffer_size;
+    if (!sub_stream_->Next(&buffer, &buffer_size)) return false;
+    const size_t n = std::min(size, static_cast<size_t>(buffer_size));
+    memcpy(buffer, input, n);
+    sub_stream_->BackUp(buffer_size - static_cast<int>(n));
+    input += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool GzipOutputStream::ParallelDeflater::WriteHeader() {
+  if (format_ == GZIP) {
+    // No file name or modification time, compression method deflate and
+    // unknown operating system; see RFC 1952.
+    static const uint8_t kGzipHeader[] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 255};
+    return Write(kGzipHeader, sizeof(kGzipHeader));
+  }
+  // Compression method deflate with a 32kB window and the level flags zlib
+  // itself would write; see RFC 1950.
+  const int level =
+      compression_level_ == Z_DEFAULT_COMPRESSION ? 6 : compression_level_;
+  int level_flags = 3;
+  if (compression_strategy_ >= Z_HUFFMAN_ONLY || level < 2) {
+    level_flags = 0;
+  } else if (level < 6) {
+    level_flags = 1;
+  } else if (level == 6) {
+    level_flags = 2;
+  }
+  uint32_t header = (0x78 << 8) | (level_flags << 6);
+  header += 31 - header % 31;
+  const uint8_t zlib_header[] = {static_cast<uint8_t>(header >> 8),
+                                 static_cast<uint8_t>(header)};
+  return Write(zlib_header, sizeof(zlib_header));
+}
+
+bool GzipOutputStream::ParallelDeflater::WriteTrailer() {
+  const uint32_t check = static_cast<uint32_t>(check_);
+  if (format_ == GZIP) {
+    // CRC-32 and input size, little-endian.
+    uint8_t gzip_trailer[8];
+    for (int i = 0; i < 4; ++i) {
+      gzip_trailer[i] = static_cast<uint8_t>(check >> (8 * i));
+      gzip_trailer[4 + i] = static_cast<uint8_t>(length_ >> (8 * i));
+    }
+    return Write(gzip_trailer, sizeof(gzip_trailer));
+  }
+  // Adler-32, big-endian.
+  const uint8_t zlib_trailer[] = {
+      static_cast<uint8_t>(check >> 24), static_cast<uint8_t>(check >> 16),
+      static_cast<uint8_t>(check >> 8), static_cast<uint8_t>(check)};
+  return Write(zlib_trailer, sizeof(zlib_trailer));
+}
+
+// =========================================================================
+
 GzipOutputStream::Options::Options()
     : format(GZIP),
       buffer_size(kDefaultBufferSize),
       compression_level(Z_DEFAULT_COMPRESSION),
-      compression_strategy(Z_DEFAULT_STRATEGY) {}
+      compression_strategy(Z_DEFAULT_STRATEGY),
+      num_threads(1),
+      block_size(kDefaultBlockSize) {}
 
 GzipOutputStream::GzipOutputStream(ZeroCopyOutputStream* sub_stream) {
   Init(sub_stream, Options());
@@ -196,6 +546,16 @@ void GzipOutputStream::Init(ZeroCopyOutputStream* sub_stream,
   sub_data_ = NULL;
   sub_data_size_ = 0;
 
+  ABSL_CHECK_GE(options.num_threads, 1);
+  if (options.num_threads > 1) {
+    memset(&zcontext_, 0, sizeof(zcontext_));
+    zerror_ = Z_OK;
+    input_buffer_ = NULL;
+    input_buffer_length_ = 0;
+    parallel_ = std::make_unique<ParallelDeflater>(sub_stream, options);
+    return;
+  }
+
   input_buffer_length_ = options.buffer_size;
   input_buffer_ = operator new(input_buffer_length_);
   ABSL_CHECK(input_buffer_ != NULL);
@@ -223,7 +583,9 @@ void GzipOutputStream::Init(ZeroCopyOutputStream* sub_stream,
 
 GzipOutputStream::~GzipOutputStream() {
   Close();
-  internal::SizedDelete(input_buffer_, input_buffer_length_);
+  if (input_buffer_ != NULL) {
+    internal::SizedDelete(input_buffer_, input_buffer_length_);
+  }
 }
 
 // private
@@ -255,6 +617,11 @@ int GzipOutputStream::Deflate(int flush) {
 
 // implements ZeroCopyOutputStream ---------------------------------
 bool GzipOutputStream::Next(void** data, int* size) {
+  if (parallel_ != nullptr) {
+    if (zerror_ != Z_OK) return false;
+    zerror_ = parallel_->Next(data, size);
+    return zerror_ == Z_OK;
+  }
   if ((zerror_ != Z_OK) && (zerror_ != Z_BUF_ERROR)) {
     return false;
   }
@@ -277,14 +644,24 @@ bool GzipOutputStream::Next(void** data, int* size) {
   return true;
 }
 void GzipOutputStream::BackUp(int count) {
+  if (parallel_ != nullptr) {
+    parallel_->BackUp(count);
+    return;
+  }
   ABSL_CHECK_GE(zcontext_.avail_in, static_cast<uInt>(count));
   zcontext_.avail_in -= count;
 }
 int64_t GzipOutputStream::ByteCount() const {
+  if (parallel_ != nullptr) return parallel_->ByteCount();
   return zcontext_.total_in + zcontext_.avail_in;
 }
 
 bool GzipOutputStream::Flush() {
+  if (parallel_ != nullptr) {
+    if (zerror_ != Z_OK) return false;
+    zerror_ = parallel_->Flush();
+    return zerror_ == Z_OK;
+  }
   zerror_ = Deflate(Z_FULL_FLUSH);
   // Return true if the flush succeeded or if it was a no-op.
   return (zerror_ == Z_OK) ||
@@ -293,6 +670,13 @@ bool GzipOutputStream::Flush() {
 }
 
 bool GzipOutputStream::Close() {
+  if (parallel_ != nullptr) {
+    if (zerror_ != Z_OK) return false;
+    zerror_ = parallel_->Close();
+    bool ok = zerror_ == Z_OK;
+    zerror_ = Z_STREAM_END;
+    return ok;
+  }
   if ((zerror_ != Z_OK) && (zerror_ != Z_BUF_ERROR)) {
     return false;
   }
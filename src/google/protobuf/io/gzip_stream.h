@@ -20,6 +20,8 @@
 #ifndef GOOGLE_PROTOBUF_IO_GZIP_STREAM_H__
 #define GOOGLE_PROTOBUF_IO_GZIP_STREAM_H__
 
+#include <memory>
+
 #include "google/protobuf/stubs/common.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/port.h"
@@ -108,6 +110,19 @@ class PROTOBUF_EXPORT GzipOutputStream final : public ZeroCopyOutputStream {
     // zlib.h for definitions of these constants.
     int compression_strategy;
 
+    // The number of threads to compress with.  Defaults to 1, which
+    // compresses on the calling thread.  With more threads, the input is
+    // split into blocks of block_size bytes which are compressed
+    // concurrently, each using the 32kB of input preceding it as its
+    // dictionary.  The output is still a single stream in the chosen format,
+    // only slightly larger than with one thread.  At most 2 * num_threads
+    // blocks are buffered at any time.
+    int num_threads;
+
+    // The size of the blocks compressed by each thread when num_threads is
+    // greater than 1.  Defaults to 128kB.  buffer_size is then unused.
+    int block_size;
+
     Options();  // Initializes with default values.
   };
 
@@ -137,6 +152,9 @@ class PROTOBUF_EXPORT GzipOutputStream final : public ZeroCopyOutputStream {
   // In the case of a Z_FULL_FLUSH or Z_SYNC_FLUSH, make sure that avail_out
   // is greater than six to avoid repeated flush markers due to
   // avail_out == 0 on return.
+  //
+  // With more than one thread, this waits for all buffered blocks to be
+  // compressed and written.
   bool Flush();
 
   // Writes out all data and closes the gzip stream.
@@ -161,6 +179,11 @@ class PROTOBUF_EXPORT GzipOutputStream final : public ZeroCopyOutputStream {
   void* input_buffer_;
   size_t input_buffer_length_;
 
+  // Compresses on worker threads when Options::num_threads > 1, in which
+  // case zcontext_ and input_buffer_ are unused.
+  class ParallelDeflater;
+  std::unique_ptr<ParallelDeflater> parallel_;
+
   // Shared constructor code.
   void Init(ZeroCopyOutputStream* sub_stream, const Options& options);
 
@@ -27,14 +27,34 @@ namespace io {
 //    Description: converts a double or float to a string which, if
 //    passed to NoLocaleStrtod(), will produce the exact same original double
 //    (except in case of NaN; all NaNs are considered the same value).
-//    We try to keep the string short but it's not guaranteed to be as
-//    short as possible.
+//    The digits are the shortest that do so; if there are several such
+//    strings, the one closest to the value is used.  They are laid out like
+//    printf("%.15g") for doubles and "%.6g" for floats, or "%.17g" and
+//    "%.9g" respectively if more digits are needed.
+//
+//    Normal values that round-trip with 15 (double) or 6 (float) digits print
+//    exactly as printf("%.15g") or "%.6g" would.  Subnormal values have less
+//    precision, so their shortest digits can be fewer than printf's: for
+//    example, the smallest double prints as "5e-324", not
+//    "4.94065645841247e-324".
 //
 //    Return value: string
 // ----------------------------------------------------------------------
 PROTOBUF_EXPORT std::string SimpleDtoa(double value);
 PROTOBUF_EXPORT std::string SimpleFtoa(float value);
 
+// The buffer sizes needed by DoubleToBuffer() and FloatToBuffer(), including
+// the null terminator.
+static constexpr int kDoubleToBufferSize = 32;
+static constexpr int kFloatToBufferSize = 24;
+
+// Like SimpleDtoa() and SimpleFtoa(), but write the null-terminated string
+// into `buffer`, which must hold at least kDoubleToBufferSize or
+// kFloatToBufferSize bytes respectively, and return `buffer`.  This avoids
+// allocating when printing many values.
+PROTOBUF_EXPORT char* DoubleToBuffer(double value, char* buffer);
+PROTOBUF_EXPORT char* FloatToBuffer(float value, char* buffer);
+
 // A locale-independent version of the standard strtod(), which always
 // uses a dot as the decimal separator.
 PROTOBUF_EXPORT double NoLocaleStrtod(const char* str, char** endptr);
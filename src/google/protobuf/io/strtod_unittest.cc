@@ -0,0 +1,217 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/io/strtod.h"
+
+#include <stdlib.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "absl/base/casts.h"
+#include "absl/strings/str_format.h"
+
+namespace google {
+namespace protobuf {
+namespace io {
+namespace {
+
+// Returns the number of significant digits in `str`.
+int CountDigits(const std::string& str) {
+  int digits = 0;
+  bool leading = true;
+  int trailing_zeros = 0;
+  for (char c : str) {
+    if (c == 'e') break;
+    if (c < '0' || c > '9') continue;
+    if (leading && c == '0') continue;
+    leading = false;
+    ++digits;
+    trailing_zeros = c == '0' ? trailing_zeros + 1 : 0;
+  }
+  return digits - trailing_zeros;
+}
+
+// Returns the number of digits printf("%g") needs to round-trip `value`.
+int PrintfDigits(double value) {
+  for (int digits = 1; digits < 17; ++digits) {
+    std::string str = absl::StrFormat("%.*g", digits, value);
+    if (strtod(str.c_str(), nullptr) == value) return digits;
+  }
+  return 17;
+}
+
+int PrintfDigits(float value) {
+  for (int digits = 1; digits < 9; ++digits) {
+    std::string str = absl::StrFormat("%.*g", digits, value);
+    if (strtof(str.c_str(), nullptr) == value) return digits;
+  }
+  return 9;
+}
+
+void ExpectDoubleRoundTrips(double value) {
+  std::string str = SimpleDtoa(value);
+  EXPECT_EQ(NoLocaleStrtod(str.c_str(), nullptr), value) << str;
+  // The shortest decimal may not be the one printf rounds to.
+  EXPECT_LE(CountDigits(str), PrintfDigits(value)) << str;
+  if (std::fabs(value) >= std::numeric_limits<double>::min() &&
+      PrintfDigits(value) <= 15) {
+    EXPECT_EQ(str, absl::StrFormat("%.15g", value));
+  }
+}
+
+void ExpectFloatRoundTrips(float value) {
+  std::string str = SimpleFtoa(value);
+  EXPECT_EQ(strtof(str.c_str(), nullptr), value) << str;
+  EXPECT_LE(CountDigits(str), PrintfDigits(value)) << str;
+  if (std::fabs(value) >= std::numeric_limits<float>::min() &&
+      PrintfDigits(value) <= 6) {
+    EXPECT_EQ(str, absl::StrFormat("%.6g", value));
+  }
+}
+
+// Like ExpectFloatRoundTrips(), but only checks that printf() needs at least
+// as many digits as SimpleFtoa() printed, which is cheap enough to run on
+// every float.
+void ExpectFloatRoundTripsFast(float value) {
+  std::string str = SimpleFtoa(value);
+  ASSERT_EQ(strtof(str.c_str(), nullptr), value) << str;
+  int digits = CountDigits(str);
+  if (digits > 1) {
+    std::string shorter = absl::StrFormat("%.*g", digits - 1, value);
+    ASSERT_NE(strtof(shorter.c_str(), nullptr), value) << str;
+  }
+}
+
+TEST(StrtodTest, SimpleDtoa) {
+  EXPECT_EQ(SimpleDtoa(0.0), "0");
+  EXPECT_EQ(SimpleDtoa(-0.0), "-0");
+  EXPECT_EQ(SimpleDtoa(1.0), "1");
+  EXPECT_EQ(SimpleDtoa(-1.5), "-1.5");
+  EXPECT_EQ(SimpleDtoa(0.1), "0.1");
+  EXPECT_EQ(SimpleDtoa(0.3), "0.3");
+  EXPECT_EQ(SimpleDtoa(2.0 / 3), "0.6666666666666666");
+  EXPECT_EQ(SimpleDtoa(0.0001), "0.0001");
+  EXPECT_EQ(SimpleDtoa(0.00001), "1e-05");
+  EXPECT_EQ(SimpleDtoa(123456789012345.0), "123456789012345");
+  EXPECT_EQ(SimpleDtoa(1e15), "1e+15");
+  EXPECT_EQ(SimpleDtoa(1234567890123456.0), "1234567890123456");
+  EXPECT_EQ(SimpleDtoa(1e17), "1e+17");
+  EXPECT_EQ(SimpleDtoa(1.23e-18), "1.23e-18");
+  EXPECT_EQ(SimpleDtoa(1.2345678987654e100), "1.2345678987654e+100");
+  EXPECT_EQ(SimpleDtoa(0.9900000095367432), "0.9900000095367432");
+  EXPECT_EQ(SimpleDtoa(std::numeric_limits<double>::max()),
+            "1.7976931348623157e+308");
+  EXPECT_EQ(SimpleDtoa(std::numeric_limits<double>::min()),
+            "2.2250738585072014e-308");
+  EXPECT_EQ(SimpleDtoa(std::numeric_limits<double>::denorm_min()), "5e-324");
+  EXPECT_EQ(SimpleDtoa(std::numeric_limits<double>::infinity()), "inf");
+  EXPECT_EQ(SimpleDtoa(-std::numeric_limits<double>::infinity()), "-inf");
+  EXPECT_EQ(SimpleDtoa(std::numeric_limits<double>::quiet_NaN()), "nan");
+}
+
+TEST(StrtodTest, SimpleFtoa) {
+  EXPECT_EQ(SimpleFtoa(0.0f), "0");
+  EXPECT_EQ(SimpleFtoa(1.0f), "1");
+  EXPECT_EQ(SimpleFtoa(0.1f), "0.1");
+  EXPECT_EQ(SimpleFtoa(0.99f), "0.99");
+  EXPECT_EQ(SimpleFtoa(1.23456e10f), "1.23456e+10");
+  EXPECT_EQ(SimpleFtoa(16777216.0f), "16777216");
+  EXPECT_EQ(SimpleFtoa(1e6f), "1e+06");
+  EXPECT_EQ(SimpleFtoa(std::numeric_limits<float>::max()), "3.4028235e+38");
+  EXPECT_EQ(SimpleFtoa(std::numeric_limits<float>::denorm_min()), "1e-45");
+  EXPECT_EQ(SimpleFtoa(-std::numeric_limits<float>::infinity()), "-inf");
+  EXPECT_EQ(SimpleFtoa(std::numeric_limits<float>::quiet_NaN()), "nan");
+}
+
+TEST(StrtodTest, DoubleToBuffer) {
+  char buffer[kDoubleToBufferSize];
+  EXPECT_STREQ(DoubleToBuffer(-1.2345678901234568e-300, buffer),
+               "-1.2345678901234568e-300");
+  EXPECT_STREQ(DoubleToBuffer(-0.00012345678901234567, buffer),
+               "-0.00012345678901234567");
+  char float_buffer[kFloatToBufferSize];
+  EXPECT_STREQ(FloatToBuffer(-1.2345678e-38f, float_buffer),
+               "-1.2345678e-38");
+}
+
+TEST(StrtodTest, FloatsRoundTrip) {
+  for (uint64_t bits = 0; bits < (uint64_t{1} << 32); bits += 65537) {
+    float value = absl::bit_cast<float>(static_cast<uint32_t>(bits));
+    if (!std::isfinite(value)) continue;
+    ExpectFloatRoundTrips(value);
+    if (testing::Test::HasFailure()) return;
+  }
+}
+
+// Checks every float, split into shards so that they can run in parallel.
+// This takes minutes, so it only runs if PROTOBUF_TEST_ALL_FLOATS is set.
+class AllFloatsRoundTripTest : public testing::TestWithParam<int> {};
+
+constexpr int kFloatShards = 64;
+
+TEST_P(AllFloatsRoundTripTest, Shard) {
+  if (getenv("PROTOBUF_TEST_ALL_FLOATS") == nullptr) {
+    GTEST_SKIP() << "Set PROTOBUF_TEST_ALL_FLOATS to check every float.";
+  }
+  constexpr uint64_t kShardSize = (uint64_t{1} << 32) / kFloatShards;
+  const uint64_t begin = GetParam() * kShardSize;
+  for (uint64_t bits = begin; bits < begin + kShardSize; ++bits) {
+    float value = absl::bit_cast<float>(static_cast<uint32_t>(bits));
+    if (!std::isfinite(value)) continue;
+    ASSERT_NO_FATAL_FAILURE(ExpectFloatRoundTripsFast(value));
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(StrtodTest, AllFloatsRoundTripTest,
+                         testing::Range(0, kFloatShards));
+
+TEST(StrtodTest, SubnormalsUseShortestDigits) {
+  // Subnormals have fewer significant bits than normal values, so their
+  // shortest representation can be shorter than printf("%.15g") or "%.6g".
+  const double min_double = std::numeric_limits<double>::denorm_min();
+  EXPECT_EQ(absl::StrFormat("%.15g", min_double), "4.94065645841247e-324");
+  EXPECT_EQ(SimpleDtoa(min_double), "5e-324");
+  const float min_float = std::numeric_limits<float>::denorm_min();
+  EXPECT_EQ(absl::StrFormat("%.6g", min_float), "1.4013e-45");
+  EXPECT_EQ(SimpleFtoa(min_float), "1e-45");
+  // Near the normal range, subnormals still need up to 16 digits.
+  const double max_subnormal = std::numeric_limits<double>::min() - min_double;
+  EXPECT_EQ(SimpleDtoa(max_subnormal), "2.225073858507201e-308");
+}
+
+TEST(StrtodTest, DoublesRoundTrip) {
+  std::mt19937_64 random(12345);
+  for (int i = 0; i < 20000; ++i) {
+    uint64_t bits = random();
+    switch (i % 4) {
+      case 1:  // Subnormal.
+        bits &= 0x800fffffffffffff;
+        break;
+      case 2:  // Few significant bits.
+        bits &= 0xffffffffff000000;
+        break;
+      case 3:  // Close to a power of two.
+        bits = (bits & 0xfff0000000000000) | (random() % 4);
+        break;
+    }
+    double value = absl::bit_cast<double>(bits);
+    if (!std::isfinite(value)) continue;
+    ExpectDoubleRoundTrips(value);
+    if (testing::Test::HasFailure()) return;
+  }
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
@@ -15,15 +15,24 @@
 #include <sys/types.h>
 #include <unistd.h>
 #endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/uio.h>
+#endif
 #include <errno.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <istream>
+#include <limits>
+#include <memory>
 #include <ostream>
 
 #include "google/protobuf/stubs/common.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
 #include "google/protobuf/io/io_win32.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
 
@@ -148,6 +157,234 @@ int FileInputStream::CopyingFileInputStream::Skip(int count) {
 
 // ===================================================================
 
+MmapInputStream::MmapInputStream(int file_descriptor) {
+#ifdef _WIN32
+  (void)file_descriptor;
+  errno_ = ENOSYS;
+#else
+  struct stat info;
+  if (fstat(file_descriptor, &info) != 0) {
+    errno_ = errno;
+    return;
+  }
+  if (!S_ISREG(info.st_mode)) {
+    errno_ = ENODEV;
+    return;
+  }
+  size_ = static_cast<int64_t>(info.st_size);
+  // mmap() rejects empty mappings, and an empty file needs none.
+  if (size_ == 0) return;
+
+  const size_t length = static_cast<size_t>(size_);
+  void* data =
+      mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+  if (data == MAP_FAILED) {
+    errno_ = errno;
+    size_ = 0;
+    return;
+  }
+  // Advice only affects performance, so failures are ignored.
+  posix_madvise(data, length, POSIX_MADV_SEQUENTIAL);
+  posix_madvise(data, length, POSIX_MADV_WILLNEED);
+  mapping_ = std::shared_ptr<const char>(
+      static_cast<const char*>(data),
+      [length](const char* p) { munmap(const_cast<char*>(p), length); });
+#endif
+}
+
+bool MmapInputStream::Next(const void** data, int* size) {
+  if (position_ >= size_) {
+    last_returned_size_ = 0;  // Don't let caller back up.
+    return false;
+  }
+  last_returned_size_ = static_cast<int>(
+      std::min<int64_t>(size_ - position_, std::numeric_limits<int>::max()));
+  *data = mapping_.get() + position_;
+  *size = last_returned_size_;
+  position_ += last_returned_size_;
+  return true;
+}
+
+void MmapInputStream::BackUp(int count) {
+  ABSL_CHECK_GT(last_returned_size_, 0)
+      << "BackUp() can only be called after a successful Next().";
+  ABSL_CHECK_LE(count, last_returned_size_);
+  ABSL_CHECK_GE(count, 0);
+  position_ -= count;
+  last_returned_size_ = 0;  // Don't let caller back up further.
+}
+
+bool MmapInputStream::Skip(int count) {
+  ABSL_CHECK_GE(count, 0);
+  last_returned_size_ = 0;  // Don't let caller back up.
+  if (count > size_ - position_) {
+    position_ = size_;
+    return false;
+  }
+  position_ += count;
+  return true;
+}
+
+int64_t MmapInputStream::ByteCount() const { return position_; }
+
+bool MmapInputStream::ReadCord(absl::Cord* cord, int count) {
+  if (!alias_cords_) return ZeroCopyInputStream::ReadCord(cord, count);
+  ABSL_CHECK_GE(count, 0);
+  last_returned_size_ = 0;  // Don't let caller back up.
+  const int64_t available = std::min<int64_t>(count, size_ - position_);
+  if (available > 0) {
+    cord->Append(absl::MakeCordFromExternal(
+        absl::string_view(mapping_.get() + position_,
+                          static_cast<size_t>(available)),
+        [mapping = mapping_] {}));
+    position_ += available;
+  }
+  return available == count;
+}
+
+// ===================================================================
+
+namespace {
+
+// Big enough to amortize a read() and a wake-up per buffer.
+constexpr int kDefaultPrefetchBufferSize = 1 << 20;
+
+}  // namespace
+
+PrefetchingFileInputStream::PrefetchingFileInputStream(int file_descriptor,
+                                                       int buffer_size,
+                                                       int num_buffers)
+    : file_(file_descriptor),
+      buffer_size_(buffer_size > 0 ? buffer_size
+                                   : kDefaultPrefetchBufferSize) {
+  ABSL_CHECK_GE(num_buffers, 2);
+#ifndef _WIN32
+  int flags = fcntl(file_, F_GETFL);
+  flags &= ~O_NONBLOCK;
+  fcntl(file_, F_SETFL, flags);
+#endif
+  buffers_.resize(num_buffers);
+  for (Buffer& buffer : buffers_) {
+    buffer.data.reset(new char[buffer_size_]);
+  }
+  thread_ = std::thread(&PrefetchingFileInputStream::ReadAhead, this);
+}
+
+PrefetchingFileInputStream::~PrefetchingFileInputStream() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stop_ = true;
+  }
+  thread_.join();
+  if (close_on_delete_ && close_no_eintr(file_) != 0) {
+    ABSL_LOG(ERROR) << "close() failed: " << strerror(errno);
+  }
+}
+
+int PrefetchingFileInputStream::GetErrno() const {
+  absl::MutexLock lock(&mutex_);
+  return errno_;
+}
+
+bool PrefetchingFileInputStream::CanFill() const {
+  return stop_ || num_filled_ < static_cast<int>(buffers_.size());
+}
+
+bool PrefetchingFileInputStream::CanConsume() const {
+  return done_ || num_filled_ > 0;
+}
+
+void PrefetchingFileInputStream::ReadAhead() {
+  // Buffers are filled in ring order starting right after the ones that are
+  // filled, so the buffer at fill_index is never held by the consumer.
+  int fill_index = 0;
+  while (true) {
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(
+          absl::Condition(this, &PrefetchingFileInputStream::CanFill));
+      if (stop_) return;
+    }
+
+    Buffer& buffer = buffers_[fill_index];
+    int result;
+    do {
+      result = read(file_, buffer.data.get(), buffer_size_);
+    } while (result < 0 && errno == EINTR);
+    const int error = result < 0 ? errno : 0;
+
+    absl::MutexLock lock(&mutex_);
+    if (result <= 0) {
+      errno_ = error;
+      done_ = true;
+      return;
+    }
+    buffer.size = result;
+    ++num_filled_;
+    fill_index = (fill_index + 1) % static_cast<int>(buffers_.size());
+  }
+}
+
+bool PrefetchingFileInputStream::Next(const void** data, int* size) {
+  if (backup_bytes_ > 0) {
+    // We have some backup bytes.  Return them.
+    const Buffer& buffer = buffers_[consume_index_];
+    *data = buffer.data.get() + buffer.size - backup_bytes_;
+    *size = backup_bytes_;
+    position_ += backup_bytes_;
+    backup_bytes_ = 0;
+    return true;
+  }
+
+  absl::MutexLock lock(&mutex_);
+  if (consuming_) {
+    // Hand the buffer back to the background thread.
+    --num_filled_;
+    consuming_ = false;
+    consume_index_ = (consume_index_ + 1) % static_cast<int>(buffers_.size());
+  }
+  mutex_.Await(absl::Condition(this, &PrefetchingFileInputStream::CanConsume));
+  if (num_filled_ == 0) return false;
+
+  consuming_ = true;
+  const Buffer& buffer = buffers_[consume_index_];
+  *data = buffer.data.get();
+  *size = buffer.size;
+  position_ += buffer.size;
+  return true;
+}
+
+void PrefetchingFileInputStream::BackUp(int count) {
+  ABSL_CHECK(backup_bytes_ == 0 && consuming_)
+      << " BackUp() can only be called after Next().";
+  ABSL_CHECK_LE(count, buffers_[consume_index_].size)
+      << " Can't back up over more bytes than were returned by the last call"
+         " to Next().";
+  ABSL_CHECK_GE(count, 0) << " Parameter to BackUp() can't be negative.";
+
+  backup_bytes_ = count;
+  position_ -= count;
+}
+
+bool PrefetchingFileInputStream::Skip(int count) {
+  ABSL_CHECK_GE(count, 0);
+  const void* data;
+  int size;
+  while (count > 0) {
+    if (!Next(&data, &size)) return false;
+    if (size > count) {
+      BackUp(size - count);
+      return true;
+    }
+    count -= size;
+  }
+  return true;
+}
+
+int64_t PrefetchingFileInputStream::ByteCount() const { return position_; }
+
+// ===================================================================
+
 FileOutputStream::FileOutputStream(int file_descriptor, int block_size)
     : CopyingOutputStreamAdaptor(&copying_output_, block_size),
       copying_output_(file_descriptor) {}
@@ -157,6 +394,15 @@ bool FileOutputStream::Close() {
   return copying_output_.Close() && flush_succeeded;
 }
 
+bool FileOutputStream::WriteSegments(
+    absl::Span<const absl::string_view> segments) {
+  if (!Flush() || !copying_output_.WriteSegments(segments)) return false;
+  for (absl::string_view segment : segments) {
+    segment_bytes_ += segment.size();
+  }
+  return true;
+}
+
 FileOutputStream::CopyingFileOutputStream::CopyingFileOutputStream(
     int file_descriptor)
     : file_(file_descriptor),
@@ -224,6 +470,64 @@ bool FileOutputStream::CopyingFileOutputStream::Write(const void* buffer,
   return true;
 }
 
+bool FileOutputStream::CopyingFileOutputStream::WriteSegments(
+    absl::Span<const absl::string_view> segments) {
+  ABSL_CHECK(!is_closed_);
+#ifdef _WIN32
+  for (absl::string_view segment : segments) {
+    while (!segment.empty()) {
+      const size_t size = std::min<size_t>(
+          segment.size(), std::numeric_limits<int>::max());
+      if (!Write(segment.data(), static_cast<int>(size))) return false;
+      segment.remove_prefix(size);
+    }
+  }
+  return true;
+#else
+  static constexpr int kMaxIovecs = 64;
+  struct iovec iov[kMaxIovecs];
+  // The next byte to write is at `offset` in segments[next].
+  size_t next = 0;
+  size_t offset = 0;
+  while (true) {
+    int count = 0;
+    for (size_t i = next; i < segments.size() && count < kMaxIovecs; ++i) {
+      absl::string_view segment = segments[i];
+      if (i == next) segment.remove_prefix(offset);
+      if (segment.empty()) continue;
+      iov[count].iov_base = const_cast<char*>(segment.data());
+      iov[count].iov_len = segment.size();
+      ++count;
+    }
+    if (count == 0) return true;
+
+    ssize_t bytes;
+    do {
+      bytes = writev(file_, iov, count);
+    } while (bytes < 0 && errno == EINTR);
+    if (bytes <= 0) {
+      // As in Write(), treat writing nothing as an error.
+      if (bytes < 0) {
+        errno_ = errno;
+      }
+      return false;
+    }
+
+    size_t written = static_cast<size_t>(bytes);
+    while (written > 0) {
+      const size_t left = segments[next].size() - offset;
+      if (written < left) {
+        offset += written;
+        break;
+      }
+      written -= left;
+      ++next;
+      offset = 0;
+    }
+  }
+#endif  // _WIN32
+}
+
 // ===================================================================
 
 IstreamInputStream::IstreamInputStream(std::istream* input, int block_size)
@@ -17,10 +17,19 @@
 #ifndef GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_H__
 #define GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_H__
 
+#include <cstdint>
 #include <iosfwd>
+#include <memory>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "google/protobuf/stubs/common.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 
@@ -110,6 +119,130 @@ class PROTOBUF_EXPORT FileInputStream final : public ZeroCopyInputStream {
 
 // ===================================================================
 
+// A ZeroCopyInputStream which maps a file into memory and returns the mapped
+// bytes directly from Next(), so the parser reads the page cache without the
+// copy FileInputStream makes into its buffer.  The whole file is returned by
+// a single call to Next() (or a few, for files over 2GB), and the kernel is
+// advised that the mapping will be read soon and sequentially.
+//
+// The entire file is mapped, regardless of the file offset, which is left
+// unchanged.  Files that cannot be mapped, such as pipes, sockets, and all
+// files on Windows, produce an empty stream with a nonzero GetErrno(); use
+// FileInputStream for those.  The file must not be truncated while mapped.
+class PROTOBUF_EXPORT MmapInputStream final : public ZeroCopyInputStream {
+ public:
+  explicit MmapInputStream(int file_descriptor);
+  MmapInputStream(const MmapInputStream&) = delete;
+  MmapInputStream& operator=(const MmapInputStream&) = delete;
+  ~MmapInputStream() override = default;
+
+  // If mapping the file failed, this is the errno from that error.
+  // Otherwise, this is zero.
+  int GetErrno() const { return errno_; }
+
+  // By default, ReadCord() copies the bytes out of the mapping like any
+  // other stream does.  Call EnableCordAliasing(true) to make it share the
+  // mapped bytes instead, so that large Cord fields are parsed without being
+  // copied.  Such Cords keep the mapping alive after the stream is destroyed,
+  // so only enable this if the file will not be modified or truncated while
+  // they exist.
+  void EnableCordAliasing(bool enabled) { alias_cords_ = enabled; }
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+  bool ReadCord(absl::Cord* cord, int count) override;
+
+ private:
+  // The mapped file, unmapped when the last reference goes away.
+  std::shared_ptr<const char> mapping_;
+  int64_t size_ = 0;
+  int64_t position_ = 0;
+  int last_returned_size_ = 0;  // How many bytes we returned last time Next()
+                                // was called (used for error checking only).
+  int errno_ = 0;
+  bool alias_cords_ = false;
+};
+
+// ===================================================================
+
+// A ZeroCopyInputStream which reads from a file descriptor on a background
+// thread, keeping several buffers filled ahead of the consumer so that
+// waiting for I/O overlaps with parsing.  Use it instead of FileInputStream
+// for long sequential reads, such as streams of delimited records, where
+// FileInputStream would block on read() each time its buffer drains.
+//
+// The stream owns `num_buffers` buffers of `buffer_size` bytes, of which one
+// is being consumed while the others are filled.  The file descriptor must
+// not be used by anyone else while the stream exists, and the destructor
+// waits for an outstanding read() to return.
+class PROTOBUF_EXPORT PrefetchingFileInputStream final
+    : public ZeroCopyInputStream {
+ public:
+  // Creates a stream that reads from the given Unix file descriptor.  If a
+  // buffer_size is given, it specifies the number of bytes read into each
+  // buffer.  Otherwise, a reasonable default is used.  num_buffers must be
+  // at least 2.
+  explicit PrefetchingFileInputStream(int file_descriptor,
+                                      int buffer_size = -1,
+                                      int num_buffers = 3);
+  PrefetchingFileInputStream(const PrefetchingFileInputStream&) = delete;
+  PrefetchingFileInputStream& operator=(const PrefetchingFileInputStream&) =
+      delete;
+  ~PrefetchingFileInputStream() override;
+
+  // By default, the file descriptor is not closed when the stream is
+  // destroyed.  Call SetCloseOnDelete(true) to change that.
+  void SetCloseOnDelete(bool value) { close_on_delete_ = value; }
+
+  // If an I/O error has occurred on this file descriptor, this is the
+  // errno from that error.  Otherwise, this is zero.
+  int GetErrno() const;
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  struct Buffer {
+    std::unique_ptr<char[]> data;
+    int size = 0;
+  };
+
+  // Body of the background thread.
+  void ReadAhead();
+  // Conditions for absl::Mutex::Await().
+  bool CanFill() const ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  bool CanConsume() const ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  const int file_;
+  const int buffer_size_;
+  bool close_on_delete_ = false;
+  std::vector<Buffer> buffers_;
+
+  mutable absl::Mutex mutex_;
+  // Number of buffers filled and not yet released by the consumer, counting
+  // the one being consumed.
+  int num_filled_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool done_ ABSL_GUARDED_BY(mutex_) = false;  // EOF or error reached.
+  bool stop_ ABSL_GUARDED_BY(mutex_) = false;
+  int errno_ ABSL_GUARDED_BY(mutex_) = 0;
+
+  // Consumer state.
+  int consume_index_ = 0;
+  bool consuming_ = false;  // Whether buffers_[consume_index_] is held.
+  int backup_bytes_ = 0;
+  int64_t position_ = 0;
+
+  std::thread thread_;
+};
+
+// ===================================================================
+
 // A ZeroCopyOutputStream which writes to a file descriptor.
 //
 // FileOutputStream is preferred over using an ofstream with
@@ -148,6 +281,17 @@ class PROTOBUF_EXPORT FileOutputStream final
   // fail.
   int GetErrno() const { return copying_output_.GetErrno(); }
 
+  // Writes any data buffered by Next() followed by `segments`, such as those
+  // of a SegmentedOutputStream, gathering the segments into as few writev()
+  // calls as possible instead of copying them into the buffer.  Returns false
+  // if an error occurs; use GetErrno() to examine the error.
+  bool WriteSegments(absl::Span<const absl::string_view> segments);
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  int64_t ByteCount() const override {
+    return CopyingOutputStreamAdaptor::ByteCount() + segment_bytes_;
+  }
+
  private:
   class PROTOBUF_EXPORT CopyingFileOutputStream final
       : public CopyingOutputStream {
@@ -160,6 +304,7 @@ class PROTOBUF_EXPORT FileOutputStream final
     bool Close();
     void SetCloseOnDelete(bool value) { close_on_delete_ = value; }
     int GetErrno() const { return errno_; }
+    bool WriteSegments(absl::Span<const absl::string_view> segments);
 
     // implements CopyingOutputStream --------------------------------
     bool Write(const void* buffer, int size) override;
@@ -175,6 +320,8 @@ class PROTOBUF_EXPORT FileOutputStream final
   };
 
   CopyingFileOutputStream copying_output_;
+  // Bytes written by WriteSegments(), which bypasses the buffer.
+  int64_t segment_bytes_ = 0;
 };
 
 // ===================================================================
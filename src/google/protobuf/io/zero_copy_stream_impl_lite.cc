@@ -12,6 +12,7 @@
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 
 #include <algorithm>
+#include <cstring>
 #include <limits>
 #include <utility>
 
@@ -33,6 +34,9 @@ namespace {
 // Default block size for Copying{In,Out}putStreamAdaptor.
 static const int kDefaultBlockSize = 8192;
 
+// Default size from which SegmentedOutputStream references data.
+static const int kDefaultMinAliasedSize = 4096;
+
 }  // namespace
 
 // ===================================================================
@@ -679,6 +683,92 @@ absl::Cord CordOutputStream::Consume() {
   return std::move(cord_);
 }
 
+// ===================================================================
+
+SegmentedOutputStream::SegmentedOutputStream(int min_aliased_size,
+                                             int block_size)
+    : min_aliased_size_(min_aliased_size > 0 ? min_aliased_size
+                                             : kDefaultMinAliasedSize),
+      block_size_(block_size > 0 ? block_size : kDefaultBlockSize) {}
+
+SegmentedOutputStream::~SegmentedOutputStream() = default;
+
+bool SegmentedOutputStream::Next(void** data, int* size) {
+  if (block_position_ == block_end_) {
+    blocks_.emplace_back(new char[block_size_]);
+    block_position_ = blocks_.back().get();
+    block_end_ = block_position_ + block_size_;
+    last_segment_in_block_ = false;
+  }
+  *data = block_position_;
+  *size = static_cast<int>(block_end_ - block_position_);
+  if (last_segment_in_block_) {
+    absl::string_view& last = segments_.back();
+    last = absl::string_view(last.data(), last.size() + *size);
+  } else {
+    segments_.emplace_back(block_position_, *size);
+    last_segment_in_block_ = true;
+  }
+  block_position_ = block_end_;
+  byte_count_ += *size;
+  return true;
+}
+
+void SegmentedOutputStream::BackUp(int count) {
+  if (count == 0) return;
+  ABSL_CHECK_GE(count, 0);
+  ABSL_CHECK(last_segment_in_block_)
+      << "BackUp() can only be called after Next().";
+  absl::string_view& last = segments_.back();
+  ABSL_CHECK_LE(static_cast<size_t>(count), last.size());
+  last.remove_suffix(count);
+  block_position_ -= count;
+  byte_count_ -= count;
+  if (last.empty()) {
+    segments_.pop_back();
+    last_segment_in_block_ = false;
+  }
+}
+
+bool SegmentedOutputStream::Copy(const void* data, int size) {
+  const char* input = static_cast<const char*>(data);
+  while (size > 0) {
+    void* out;
+    int out_size;
+    Next(&out, &out_size);
+    const int n = std::min(size, out_size);
+    std::memcpy(out, input, n);
+    BackUp(out_size - n);
+    input += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool SegmentedOutputStream::WriteAliasedRaw(const void* data, int size) {
+  if (size < min_aliased_size_) return Copy(data, size);
+  segments_.emplace_back(static_cast<const char*>(data), size);
+  last_segment_in_block_ = false;
+  byte_count_ += size;
+  return true;
+}
+
+bool SegmentedOutputStream::WriteCord(const absl::Cord& cord) {
+  if (cord.size() < static_cast<size_t>(min_aliased_size_)) {
+    for (absl::string_view chunk : cord.Chunks()) {
+      Copy(chunk.data(), static_cast<int>(chunk.size()));
+    }
+    return true;
+  }
+  cords_.push_back(cord);
+  for (absl::string_view chunk : cords_.back().Chunks()) {
+    segments_.push_back(chunk);
+  }
+  last_segment_in_block_ = false;
+  byte_count_ += cord.size();
+  return true;
+}
+
 
 }  // namespace io
 }  // namespace protobuf
@@ -21,10 +21,12 @@
 #ifndef GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_LITE_H__
 #define GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_LITE_H__
 
+#include <deque>
 #include <iosfwd>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "google/protobuf/stubs/callback.h"
 #include "google/protobuf/stubs/common.h"
@@ -32,6 +34,7 @@
 #include "absl/base/macros.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/cord_buffer.h"
+#include "absl/strings/string_view.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/port.h"
 
@@ -490,6 +493,61 @@ class PROTOBUF_EXPORT CordOutputStream final : public ZeroCopyOutputStream {
   absl::CordBuffer buffer_;
 };
 
+// ===================================================================
+
+// A ZeroCopyOutputStream that collects its output as a list of segments
+// rather than in one contiguous buffer, for a gathering write such as
+// FileOutputStream::WriteSegments() or writev().
+//
+// Data written through Next() is kept in blocks owned by the stream.  Data of
+// at least `min_aliased_size` bytes passed to WriteAliasedRaw() becomes a
+// segment of its own that refers to the caller's memory, which must stay
+// alive and unchanged for as long as the segments are used.  Cords of that
+// size passed to WriteCord() are shared rather than copied.  Together with
+// MessageLite::SerializeAliasedToZeroCopyStream(), this serializes large
+// string, bytes and Cord fields without copying them.
+class PROTOBUF_EXPORT SegmentedOutputStream final
+    : public ZeroCopyOutputStream {
+ public:
+  // If given, `min_aliased_size` is the size from which data is referenced
+  // rather than copied, and `block_size` the size of the blocks returned by
+  // Next().  Otherwise, reasonable defaults are used.
+  explicit SegmentedOutputStream(int min_aliased_size = -1,
+                                 int block_size = -1);
+  SegmentedOutputStream(const SegmentedOutputStream&) = delete;
+  SegmentedOutputStream& operator=(const SegmentedOutputStream&) = delete;
+  ~SegmentedOutputStream() override;
+
+  // The data written so far, in order.  Invalidated by further writes.
+  const std::vector<absl::string_view>& segments() const { return segments_; }
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override { return byte_count_; }
+  bool WriteAliasedRaw(const void* data, int size) override;
+  bool AllowsAliasing() const override { return true; }
+  bool WriteCord(const absl::Cord& cord) override;
+
+ private:
+  // Copies `data` into the blocks.
+  bool Copy(const void* data, int size);
+
+  const int min_aliased_size_;
+  const int block_size_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  // The unused part of the last block.
+  char* block_position_ = nullptr;
+  char* block_end_ = nullptr;
+  // Whether the last segment lies in the last block, ending at
+  // block_position_.
+  bool last_segment_in_block_ = false;
+  std::vector<absl::string_view> segments_;
+  // Deque elements never move, so the chunks of these Cords stay put.
+  std::deque<absl::Cord> cords_;
+  int64_t byte_count_ = 0;
+};
+
 
 // ===================================================================
 
@@ -464,6 +464,60 @@ TEST_F(IoTest, GzipIoReadAfterFlush) {
   delete[] buffer;
 }
 
+TEST_F(IoTest, GzipIoParallel) {
+  // Small blocks cost a flush marker each, so leave room for them.
+  const int kBufferSize = 16 * 1024;
+  uint8* buffer = new uint8[kBufferSize];
+  for (auto format : {GzipOutputStream::GZIP, GzipOutputStream::ZLIB}) {
+    for (int num_threads : {2, 4}) {
+      for (int block_size : {1, 7, 64, 128 * 1024}) {
+        for (int i = 0; i < kBlockSizeCount; i++) {
+          int size;
+          {
+            ArrayOutputStream output(buffer, kBufferSize, kBlockSizes[i]);
+            GzipOutputStream::Options options;
+            options.format = format;
+            options.num_threads = num_threads;
+            options.block_size = block_size;
+            GzipOutputStream gzout(&output, options);
+            WriteStuff(&gzout);
+            EXPECT_TRUE(gzout.Flush());
+            EXPECT_TRUE(gzout.Close());
+            size = output.ByteCount();
+          }
+          {
+            ArrayInputStream input(buffer, size);
+            GzipInputStream gzin(&input, GzipInputStream::AUTO);
+            ReadStuff(&gzin);
+          }
+        }
+      }
+    }
+  }
+  delete[] buffer;
+}
+
+TEST_F(IoTest, GzipIoParallelLarge) {
+  std::string golden;
+  for (int i = 0; golden.size() < 4 * 1024 * 1024; i++) {
+    absl::StrAppend(&golden, "record ", i % 1000, " of ", i, "\n");
+  }
+
+  GzipOutputStream::Options options;
+  const std::string serial = Compress(golden, options);
+  options.num_threads = 4;
+  options.block_size = 64 * 1024;
+  const std::string parallel = Compress(golden, options);
+  options.format = GzipOutputStream::ZLIB;
+  const std::string parallel_zlib = Compress(golden, options);
+
+  EXPECT_EQ(Uncompress(parallel), golden);
+  EXPECT_EQ(Uncompress(parallel_zlib), golden);
+  // Priming each block with the preceding input keeps the ratio close to
+  // that of a single stream.
+  EXPECT_LT(parallel.size(), serial.size() * 21 / 20);
+}
+
 TEST_F(IoTest, ZlibIo) {
   const int kBufferSize = 2 * 1024;
   uint8* buffer = new uint8[kBufferSize];
@@ -1398,6 +1452,86 @@ TEST_F(IoTest, CordOutputBufferEndsAtSizeHint) {
   output.Consume();
 }
 
+std::string JoinSegments(const std::vector<absl::string_view>& segments) {
+  std::string result;
+  for (absl::string_view segment : segments) absl::StrAppend(&result, segment);
+  return result;
+}
+
+TEST_F(IoTest, SegmentedIo) {
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    SegmentedOutputStream output(-1, kBlockSizes[i]);
+    int size = WriteStuff(&output);
+    const std::string data = JoinSegments(output.segments());
+    EXPECT_EQ(static_cast<int>(data.size()), size);
+
+    for (int j = 0; j < kBlockSizeCount; j++) {
+      ArrayInputStream input(data.data(), size, kBlockSizes[j]);
+      ReadStuff(&input);
+    }
+  }
+}
+
+TEST(SegmentedOutputStreamTest, AliasesLargeWrites) {
+  const std::string large(100, 'x');
+  SegmentedOutputStream output(/*min_aliased_size=*/100);
+  EXPECT_TRUE(output.AllowsAliasing());
+  EXPECT_TRUE(output.WriteAliasedRaw("head", 4));
+  EXPECT_TRUE(output.WriteAliasedRaw(large.data(), 100));
+  EXPECT_TRUE(output.WriteAliasedRaw(large.data(), 99));
+  EXPECT_TRUE(output.WriteAliasedRaw("tail", 4));
+  EXPECT_EQ(output.ByteCount(), 207);
+
+  // Small writes are copied, large ones referenced.
+  const auto& segments = output.segments();
+  ASSERT_EQ(segments.size(), 3u);
+  EXPECT_EQ(segments[0], "head");
+  EXPECT_EQ(segments[1].data(), large.data());
+  EXPECT_EQ(segments[1].size(), 100u);
+  EXPECT_EQ(segments[2], absl::StrCat(std::string(99, 'x'), "tail"));
+}
+
+TEST(SegmentedOutputStreamTest, SharesLargeCords) {
+  absl::Cord large;
+  for (int i = 0; i < 10; ++i) large.Append(std::string(1000, 'a' + i));
+  SegmentedOutputStream output(/*min_aliased_size=*/1000);
+  EXPECT_TRUE(output.WriteCord(absl::Cord("small")));
+  EXPECT_TRUE(output.WriteCord(large));
+  EXPECT_TRUE(output.WriteAliasedRaw("!", 1));
+  EXPECT_EQ(output.ByteCount(), 10006);
+  EXPECT_EQ(JoinSegments(output.segments()),
+            absl::StrCat("small", std::string(large), "!"));
+
+  // The segments stay valid after the original Cord is changed.
+  const std::string expected = std::string(large);
+  large.Clear();
+  EXPECT_EQ(JoinSegments(output.segments()),
+            absl::StrCat("small", expected, "!"));
+}
+
+TEST(SegmentedOutputStreamTest, BackUp) {
+  SegmentedOutputStream output(-1, 16);
+  void* data;
+  int size;
+  ASSERT_TRUE(output.Next(&data, &size));
+  EXPECT_EQ(size, 16);
+  memcpy(data, "abcdefghijklmnop", 16);
+  output.BackUp(13);
+  ASSERT_TRUE(output.Next(&data, &size));
+  EXPECT_EQ(size, 13);
+  output.BackUp(13);
+  EXPECT_EQ(output.ByteCount(), 3);
+  ASSERT_EQ(output.segments().size(), 1u);
+  EXPECT_EQ(output.segments()[0], "abc");
+
+  // Backing up a whole block leaves no empty segment behind.
+  ASSERT_TRUE(output.Next(&data, &size));
+  ASSERT_TRUE(output.Next(&data, &size));
+  output.BackUp(size);
+  EXPECT_EQ(output.ByteCount(), 16);
+  EXPECT_EQ(output.segments().size(), 1u);
+}
+
 
 // To test files, we create a temporary file, write, read, truncate, repeat.
 TEST_F(IoTest, FileIo) {
@@ -1431,7 +1565,196 @@ TEST_F(IoTest, FileIo) {
   }
 }
 
+TEST_F(IoTest, PrefetchingFileIo) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    for (int j = 0; j < kBlockSizeCount; j++) {
+      for (int num_buffers : {2, 3, 8}) {
+        // Make a temporary file.
+        int file =
+            open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+        ASSERT_GE(file, 0);
+
+        {
+          FileOutputStream output(file, kBlockSizes[i]);
+          WriteStuff(&output);
+          EXPECT_EQ(0, output.GetErrno());
+        }
+
+        // Rewind.
+        ASSERT_NE(lseek(file, 0, SEEK_SET), (off_t)-1);
+
+        {
+          PrefetchingFileInputStream input(file, kBlockSizes[j], num_buffers);
+          ReadStuff(&input);
+          EXPECT_EQ(0, input.GetErrno());
+        }
+
+        close(file);
+      }
+    }
+  }
+}
+
+TEST_F(IoTest, PrefetchingFileIoLarge) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+  int file =
+      open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+
+  {
+    FileOutputStream output(file);
+    WriteStuffLarge(&output);
+    EXPECT_EQ(0, output.GetErrno());
+  }
+  ASSERT_NE(lseek(file, 0, SEEK_SET), (off_t)-1);
+
+  {
+    PrefetchingFileInputStream input(file, 4096, 3);
+    ReadStuffLarge(&input);
+    EXPECT_EQ(0, input.GetErrno());
+  }
+
+  close(file);
+}
+
+TEST_F(IoTest, FileWriteSegments) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+  int file =
+      open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+
+  // More segments than fit in a single writev() call.
+  std::vector<std::string> strings;
+  std::vector<absl::string_view> segments;
+  std::string expected = "buffered";
+  for (int i = 0; i < 1000; ++i) {
+    strings.push_back(std::string(i % 3 == 0 ? 0 : i, 'a' + i % 26));
+  }
+  for (const std::string& str : strings) {
+    segments.push_back(str);
+    expected += str;
+  }
+
+  {
+    FileOutputStream output(file, 16);
+    WriteString(&output, "buffered");
+    EXPECT_TRUE(output.WriteSegments(segments));
+    EXPECT_EQ(output.ByteCount(), static_cast<int64_t>(expected.size()));
+    WriteString(&output, "more");
+    expected += "more";
+    EXPECT_EQ(output.ByteCount(), static_cast<int64_t>(expected.size()));
+    EXPECT_EQ(0, output.GetErrno());
+  }
+  ASSERT_NE(lseek(file, 0, SEEK_SET), (off_t)-1);
+
+  {
+    FileInputStream input(file);
+    std::string actual;
+    const void* data;
+    int size;
+    while (input.Next(&data, &size)) {
+      actual.append(static_cast<const char*>(data), size);
+    }
+    EXPECT_EQ(actual, expected);
+  }
+
+  close(file);
+}
+
 #ifndef _WIN32
+TEST_F(IoTest, MmapIo) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    int file =
+        open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+    ASSERT_GE(file, 0);
+
+    {
+      FileOutputStream output(file, kBlockSizes[i]);
+      WriteStuff(&output);
+      EXPECT_EQ(0, output.GetErrno());
+    }
+
+    // The file offset is not rewound: the whole file is always mapped.
+    {
+      MmapInputStream input(file);
+      EXPECT_EQ(0, input.GetErrno());
+      ReadStuff(&input);
+    }
+
+    close(file);
+  }
+}
+
+TEST_F(IoTest, MmapEmptyFile) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+  int file =
+      open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+
+  MmapInputStream input(file);
+  EXPECT_EQ(0, input.GetErrno());
+  const void* buffer;
+  int size;
+  EXPECT_FALSE(input.Next(&buffer, &size));
+  EXPECT_EQ(input.ByteCount(), 0);
+
+  close(file);
+}
+
+TEST_F(IoTest, MmapReadCordAliasesMapping) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+  const std::string contents(10000, 'x');
+  int file =
+      open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+  ASSERT_EQ(write(file, contents.data(), contents.size()),
+            static_cast<ssize_t>(contents.size()));
+
+  absl::Cord cord;
+  {
+    MmapInputStream input(file);
+    input.EnableCordAliasing(true);
+    const void* buffer;
+    int size;
+    ASSERT_TRUE(input.Next(&buffer, &size));
+    ASSERT_EQ(size, static_cast<int>(contents.size()));
+    input.BackUp(size - 100);
+    EXPECT_TRUE(input.ReadCord(&cord, 5000));
+    ASSERT_TRUE(cord.TryFlat().has_value());
+    EXPECT_EQ(cord.TryFlat()->data(), static_cast<const char*>(buffer) + 100);
+    EXPECT_FALSE(input.ReadCord(&cord, 5000));
+    EXPECT_EQ(input.ByteCount(), static_cast<int64_t>(contents.size()));
+  }
+  close(file);
+
+  // The Cord keeps the mapping alive.
+  EXPECT_EQ(cord, contents.substr(100));
+}
+
+TEST_F(IoTest, MmapPipeError) {
+  int files[2];
+  ASSERT_EQ(pipe(files), 0);
+
+  MmapInputStream input(files[0]);
+  EXPECT_NE(0, input.GetErrno());
+  const void* buffer;
+  int size;
+  EXPECT_FALSE(input.Next(&buffer, &size));
+
+  close(files[0]);
+  close(files[1]);
+}
+
 // This tests the FileInputStream with a non blocking file. It opens a pipe in
 // non blocking mode, then starts reading it. The writing thread starts writing
 // 100ms after that.
@@ -1577,6 +1900,19 @@ TEST_F(IoTest, FileReadError) {
   EXPECT_EQ(EBADF, input.GetErrno());
 }
 
+// Test that PrefetchingFileInputStreams report errors correctly.
+TEST_F(IoTest, PrefetchingFileReadError) {
+  MsvcDebugDisabler debug_disabler;
+
+  // -1 = invalid file descriptor.
+  PrefetchingFileInputStream input(-1);
+
+  const void* buffer;
+  int size;
+  EXPECT_FALSE(input.Next(&buffer, &size));
+  EXPECT_EQ(EBADF, input.GetErrno());
+}
+
 // Test that FileOutputStreams report errors correctly.
 TEST_F(IoTest, FileWriteError) {
   MsvcDebugDisabler debug_disabler;
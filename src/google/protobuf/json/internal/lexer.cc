@@ -9,9 +9,16 @@
 
 #include <sys/types.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include <atomic>
 #include <cfloat>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <limits>
@@ -76,6 +83,119 @@ void HardenAgainstHyrumsLaw(absl::string_view to_obfuscate, std::string& out) {
     }
   }
 }
+
+// The scanners below find the end of a run of bytes that the lexer would
+// otherwise consume one at a time, sixteen bytes at a time where SSE2 or NEON
+// is available. Both are part of the baseline of x86-64 and AArch64, so no
+// runtime dispatch is needed.
+
+bool IsWhitespace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Whether `c` can be consumed as is inside a string quoted by `quote`: that
+// is, it neither ends the string, nor starts an escape, nor is a control
+// character or part of a multibyte UTF-8 sequence.
+bool IsPlainStringChar(char c, char quote) {
+  uint8_t uc = static_cast<uint8_t>(c);
+  return uc >= 0x20 && uc < 0x80 && c != quote && c != '\\';
+}
+
+#if defined(__SSE2__)
+constexpr size_t kBlockSize = 16;
+
+// Returns a mask with bit i set if byte i of the block at `p` is whitespace.
+uint32_t WhitespaceMask(const char* p) {
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  __m128i ws = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                   _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+      _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+                   _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))));
+  return static_cast<uint32_t>(_mm_movemask_epi8(ws));
+}
+
+// Returns a mask with bit i set if byte i of the block at `p` is plain, in
+// the sense of IsPlainStringChar().
+uint32_t PlainStringCharMask(const char* p, char quote) {
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  // As signed bytes, both control characters and bytes with the high bit set
+  // are less than 0x20.
+  __m128i special = _mm_or_si128(
+      _mm_cmplt_epi8(v, _mm_set1_epi8(0x20)),
+      _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(quote)),
+                   _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+  return ~static_cast<uint32_t>(_mm_movemask_epi8(special)) & 0xffff;
+}
+#elif defined(__ARM_NEON)
+constexpr size_t kBlockSize = 16;
+
+// NEON has no movemask; narrowing each 16-bit lane by four bits leaves one
+// nibble per byte, so this returns a mask with bits [4i, 4i + 4) set for each
+// byte i that is set in `v`.
+uint64_t NibbleMask(uint8x16_t v) {
+  uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(v), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+uint64_t WhitespaceMask(const char* p) {
+  uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+  uint8x16_t ws = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')),
+                                    vceqq_u8(v, vdupq_n_u8('\n'))),
+                           vorrq_u8(vceqq_u8(v, vdupq_n_u8('\r')),
+                                    vceqq_u8(v, vdupq_n_u8('\t'))));
+  return NibbleMask(ws);
+}
+
+uint64_t PlainStringCharMask(const char* p, char quote) {
+  uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+  uint8x16_t special = vorrq_u8(
+      vorrq_u8(vcltq_u8(v, vdupq_n_u8(0x20)), vcgeq_u8(v, vdupq_n_u8(0x80))),
+      vorrq_u8(vceqq_u8(v, vdupq_n_u8(static_cast<uint8_t>(quote))),
+               vceqq_u8(v, vdupq_n_u8('\\'))));
+  return ~NibbleMask(special);
+}
+#endif
+
+// Returns the number of leading bytes of `data` that are JSON whitespace.
+size_t ScanWhitespace(absl::string_view data) {
+  // Most whitespace runs in JSON are short, if there are any at all.
+  size_t i = 0;
+  while (i < data.size() && i < 4 && IsWhitespace(data[i])) ++i;
+  if (i < 4) return i;
+#if defined(__SSE2__)
+  for (; i + kBlockSize <= data.size(); i += kBlockSize) {
+    uint32_t other = ~WhitespaceMask(data.data() + i) & 0xffff;
+    if (other != 0) return i + absl::countr_zero(other);
+  }
+#elif defined(__ARM_NEON)
+  for (; i + kBlockSize <= data.size(); i += kBlockSize) {
+    uint64_t other = ~WhitespaceMask(data.data() + i);
+    if (other != 0) return i + absl::countr_zero(other) / 4;
+  }
+#endif
+  while (i < data.size() && IsWhitespace(data[i])) ++i;
+  return i;
+}
+
+// Returns the number of leading bytes of `data` that are plain characters
+// of a string quoted by `quote`; see IsPlainStringChar().
+size_t ScanPlainStringChars(absl::string_view data, char quote) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + kBlockSize <= data.size(); i += kBlockSize) {
+    uint32_t special = ~PlainStringCharMask(data.data() + i, quote) & 0xffff;
+    if (special != 0) return i + absl::countr_zero(special);
+  }
+#elif defined(__ARM_NEON)
+  for (; i + kBlockSize <= data.size(); i += kBlockSize) {
+    uint64_t special = ~PlainStringCharMask(data.data() + i, quote);
+    if (special != 0) return i + absl::countr_zero(special) / 4;
+  }
+#endif
+  while (i < data.size() && IsPlainStringChar(data[i], quote)) ++i;
+  return i;
+}
 }  // namespace
 
 constexpr size_t ParseOptions::kDefaultDepth;
@@ -191,24 +311,29 @@ absl::StatusOr<uint16_t> JsonLexer::ParseU16HexCodepoint() {
 absl::Status JsonLexer::SkipToToken() {
   while (true) {
     RETURN_IF_ERROR(stream_.BufferAtLeast(1).status());
-    switch (stream_.PeekChar()) {
-      case '\n':
-        RETURN_IF_ERROR(Advance(1));
-        ++json_loc_.line;
-        json_loc_.col = 0;
-        break;
-      case '\r':
-      case '\t':
-      case ' ':
-        RETURN_IF_ERROR(Advance(1));
-        break;
-      default:
-        return absl::OkStatus();
+    absl::string_view whitespace =
+        stream_.Unread().substr(0, ScanWhitespace(stream_.Unread()));
+    if (whitespace.empty()) {
+      return absl::OkStatus();
     }
+
+    size_t last_newline = whitespace.rfind('\n');
+    RETURN_IF_ERROR(Advance(whitespace.size()));
+    if (last_newline != absl::string_view::npos) {
+      json_loc_.line += absl::c_count(whitespace, '\n');
+      json_loc_.col = whitespace.size() - last_newline - 1;
+    }
+    // If the whole buffer was whitespace, look for more in the next chunk.
   }
 }
 
 absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseRawNumber() {
+  double value;
+  return ParseRawNumber(&value);
+}
+
+absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseRawNumber(
+    double* value) {
   RETURN_IF_ERROR(SkipToToken());
 
   enum { kInt, kFraction, kExponent } state = kInt;
@@ -261,8 +386,7 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseRawNumber() {
     return number->loc.Invalid("number cannot have trailing period");
   }
 
-  double d;
-  if (!absl::SimpleAtod(number_text, &d) || !std::isfinite(d)) {
+  if (!absl::SimpleAtod(number_text, value) || !std::isfinite(*value)) {
     return number->loc.Invalid(
         absl::StrFormat("invalid number: '%s'", number_text));
   }
@@ -286,15 +410,10 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseRawNumber() {
 }
 
 absl::StatusOr<LocationWith<double>> JsonLexer::ParseNumber() {
-  auto number = ParseRawNumber();
-  RETURN_IF_ERROR(number.status());
-
+  // ParseRawNumber() has to convert the number to validate it anyway.
   double d;
-  if (!absl::SimpleAtod(number->value.AsView(), &d) || !std::isfinite(d)) {
-    return number->loc.Invalid(
-        absl::StrFormat("invalid number: '%s'", number->value.AsView()));
-  }
-
+  auto number = ParseRawNumber(&d);
+  RETURN_IF_ERROR(number.status());
   return LocationWith<double>{d, number->loc};
 }
 
@@ -384,6 +503,8 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseUtf8() {
     return Invalid("expected '\"'");
   }
 
+  const char quote = is_single_quote ? '\'' : '"';
+
   JsonLocation loc = json_loc_;
   RETURN_IF_ERROR(Expect(is_single_quote ? "'" : "\""));
 
@@ -393,12 +514,23 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseUtf8() {
   while (true) {
     RETURN_IF_ERROR(stream_.BufferAtLeast(1).status());
 
+    // Consume runs of characters that need no further processing in bulk.
+    absl::string_view plain = stream_.Unread().substr(
+        0, ScanPlainStringChars(stream_.Unread(), quote));
+    if (!plain.empty()) {
+      if (!on_heap.empty()) {
+        on_heap.append(plain.data(), plain.size());
+      }
+      RETURN_IF_ERROR(Advance(plain.size()));
+      continue;
+    }
+
     char c = stream_.PeekChar();
     RETURN_IF_ERROR(Advance(1));
     switch (c) {
       case '"':
       case '\'': {
-        if (c != (is_single_quote ? '\'' : '"')) {
+        if (c != quote) {
           goto normal_character;
         }
 
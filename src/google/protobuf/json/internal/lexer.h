@@ -106,6 +106,9 @@ class JsonLexer {
 
   const ParseOptions& options() const { return options_; }
 
+  // Returns the location of the next unconsumed character.
+  const JsonLocation& location() const { return json_loc_; }
+
   const MessagePath& path() const { return *path_; }
   MessagePath& path() { return *path_; }
 
@@ -241,6 +244,9 @@ class JsonLexer {
   // `out_utf8`; returns the number of bytes written.
   absl::StatusOr<size_t> ParseUnicodeEscape(char out_utf8[4]);
 
+  // Like ParseRawNumber(), but also stores the number's value in `value`.
+  absl::StatusOr<LocationWith<MaybeOwnedString>> ParseRawNumber(double* value);
+
   // Parses an alphanumeric "identifier", for use with the non-standard
   // "unquoted keys" extension.
   absl::StatusOr<LocationWith<MaybeOwnedString>> ParseBareWord();
@@ -326,6 +326,30 @@ TEST(LexerTest, Cjk) {
   });
 }
 
+// Long enough to span several vector blocks in the lexer's scanners.
+TEST(LexerTest, LongString) {
+  Do(R"json("The quick brown fox \"jumps\" over a lazy dog, then 'naps'.")json",
+     [](io::ZeroCopyInputStream* stream) {
+       EXPECT_THAT(Value::Parse(stream),
+                   IsOkAndHolds(ValueIs<std::string>(
+                       "The quick brown fox \"jumps\" over a lazy dog, then "
+                       "'naps'.")));
+     });
+}
+
+TEST(LexerTest, LongStringWithMultibyteCharacters) {
+  Do(R"json("0123456789abcdef施氏食獅史0123456789abcdef\n")json",
+     [](io::ZeroCopyInputStream* stream) {
+       EXPECT_THAT(Value::Parse(stream),
+                   IsOkAndHolds(ValueIs<std::string>(
+                       "0123456789abcdef施氏食獅史0123456789abcdef\n")));
+     });
+}
+
+TEST(LexerTest, ControlCharAfterLongPrefix) {
+  BadInner("\"0123456789abcdef0123456789abcdef\1\"");
+}
+
 TEST(LexerTest, BrokenString) {
   Bad(R"json("broken)json");
   Bad(R"json("broken')json");
@@ -580,6 +604,26 @@ TEST(LexerTest, NestedObject) {
   });
 }
 
+TEST(LexerTest, LongWhitespace) {
+  Do("  \t\r\n                                  \n\n\t  [\n  1  ,\t\t\t\t\t\t"
+     "                    2 ]                                 ",
+     [](io::ZeroCopyInputStream* stream) {
+       EXPECT_THAT(Value::Parse(stream),
+                   IsOkAndHolds(ValueIs<Value::Array>(ElementsAre(
+                       ValueIs<double>(1), ValueIs<double>(2)))));
+     });
+}
+
+TEST(LexerTest, LocationAfterWhitespace) {
+  absl::string_view json =
+      "\n\n                \n    \r                    \n   x";
+  io::ArrayInputStream stream(json.data(), static_cast<int>(json.size()), 7);
+  JsonLexer lex(&stream, {});
+  absl::Status status = lex.PeekKind().status();
+  EXPECT_THAT(absl::StrReplaceAll(status.message(), {{" ", ""}}),
+              HasSubstr("near5:4(offset48)"));
+}
+
 TEST(LexerTest, RejectNonUtf8) {
   absl::string_view json = R"json(
     { "address": x"施氏食獅史" }
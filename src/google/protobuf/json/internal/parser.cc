@@ -1293,6 +1293,61 @@ absl::Status JsonStreamToMessage(io::ZeroCopyInputStream* input,
   return s;
 }
 
+JsonRecordParser::JsonRecordParser(io::ZeroCopyInputStream* input,
+                                   bool is_array,
+                                   json_internal::ParseOptions options)
+    : path_(""), lex_(input, options, &path_), is_array_(is_array) {}
+
+absl::StatusOr<bool> JsonRecordParser::Next(Message* message) {
+  ABSL_CHECK(!done_) << "Next() called after the last record or an error";
+  absl::StatusOr<bool> has_record = ReadRecord(message);
+  if (!has_record.ok() || !*has_record) {
+    done_ = true;
+  }
+  return has_record;
+}
+
+absl::StatusOr<bool> JsonRecordParser::ReadRecord(Message* message) {
+  // Records may have different types; the lexer keeps a pointer to `path_`,
+  // so it is reset in place.
+  path_ = MessagePath(message->GetDescriptor()->full_name());
+
+  bool is_first = !started_;
+  started_ = true;
+  if (is_array_) {
+    if (is_first) {
+      RETURN_IF_ERROR(lex_.Expect("["));
+      if (lex_.Peek("]")) return AtEnd();
+    } else {
+      if (lex_.Peek("]")) return AtEnd();
+      RETURN_IF_ERROR(lex_.Expect(","));
+      // The legacy syntax allows a trailing comma, as in VisitArray().
+      if (lex_.options().allow_legacy_syntax && lex_.Peek("]")) {
+        return AtEnd();
+      }
+    }
+  } else {
+    if (lex_.AtEof()) return false;
+    if (!is_first && lex_.location().line == last_line_) {
+      return lex_.Invalid("expected a newline between JSON records");
+    }
+  }
+
+  ParseProto2Descriptor::Msg msg(message);
+  RETURN_IF_ERROR(ParseMessage<ParseProto2Descriptor>(
+      lex_, *message->GetDescriptor(), msg, /*any_reparse=*/false));
+  last_line_ = lex_.location().line;
+  return true;
+}
+
+absl::StatusOr<bool> JsonRecordParser::AtEnd() {
+  if (!lex_.AtEof()) {
+    return absl::InvalidArgumentError(
+        "extraneous characters after end of JSON array");
+  }
+  return false;
+}
+
 absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
                                 const std::string& type_url,
                                 io::ZeroCopyInputStream* json_input,
@@ -10,7 +10,11 @@
 
 #include <string>
 
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/json/internal/lexer.h"
+#include "google/protobuf/json/internal/message_path.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/util/type_resolver.h"
 
@@ -29,6 +33,40 @@ absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
                                 io::ZeroCopyInputStream* json_input,
                                 io::ZeroCopyOutputStream* binary_output,
                                 json_internal::ParseOptions options);
+
+// Parses a stream of JSON objects, one message per call to Next(). The lexer,
+// and with it the stream's buffer, is shared by all records, so no record is
+// copied out of the input before it is parsed.
+//
+// Records are either separated by newlines (NDJSON), or are the elements of a
+// single top-level JSON array.
+class JsonRecordParser {
+ public:
+  JsonRecordParser(io::ZeroCopyInputStream* input, bool is_array,
+                   json_internal::ParseOptions options);
+
+  JsonRecordParser(const JsonRecordParser&) = delete;
+  JsonRecordParser& operator=(const JsonRecordParser&) = delete;
+
+  // Merges the next record into `message`. Returns false once all records
+  // have been read; it is an error to call Next() again after that, or after
+  // an error.
+  absl::StatusOr<bool> Next(Message* message);
+
+ private:
+  absl::StatusOr<bool> ReadRecord(Message* message);
+
+  // Checks that nothing follows the closing bracket of the array.
+  absl::StatusOr<bool> AtEnd();
+
+  MessagePath path_;
+  JsonLexer lex_;
+  bool is_array_;
+  bool started_ = false;
+  bool done_ = false;
+  // The line on which the last record ended, for NDJSON.
+  size_t last_line_ = 0;
+};
 }  // namespace json_internal
 }  // namespace protobuf
 }  // namespace google
@@ -845,6 +845,59 @@ absl::Status MessageToJsonString(const Message& message, std::string* output,
   return absl::OkStatus();
 }
 
+JsonRecordUnparser::JsonRecordUnparser(io::ZeroCopyOutputStream* output,
+                                       bool is_array,
+                                       json_internal::WriterOptions options)
+    : is_array_(is_array) {
+  if (!is_array) options.add_whitespace = false;
+  writer_.emplace(output, options);
+}
+
+absl::Status JsonRecordUnparser::Write(const Message& message) {
+  ABSL_CHECK(writer_.has_value()) << "Write() called after Close()";
+  if (is_array_) {
+    if (is_first_) {
+      writer_->Write("[");
+      writer_->Push();
+    }
+    writer_->WriteComma(is_first_);
+    writer_->NewLine();
+  }
+  is_first_ = false;
+
+  RETURN_IF_ERROR(WriteMessage<UnparseProto2Descriptor>(
+      *writer_, message, *message.GetDescriptor(), /*is_top_level=*/true));
+  if (!is_array_) {
+    writer_->Write("\n");
+  }
+  return absl::OkStatus();
+}
+
+void JsonRecordUnparser::Close() {
+  if (!writer_.has_value()) return;
+  if (is_array_) {
+    if (is_first_) {
+      writer_->Write("[");
+    } else {
+      writer_->Pop();
+      writer_->NewLine();
+    }
+    writer_->Write("]");
+    writer_->NewLine();
+  }
+  writer_.reset();
+}
+
+absl::Status MessageToJsonStream(const Message& message,
+                                 io::ZeroCopyOutputStream* output,
+                                 json_internal::WriterOptions options) {
+  JsonWriter writer(output, options);
+  RETURN_IF_ERROR(WriteMessage<UnparseProto2Descriptor>(
+      writer, message, *message.GetDescriptor(), /*is_top_level=*/true));
+  writer.NewLine();
+  return absl::OkStatus();
+}
+
 absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
                                 const std::string& type_url,
                                 io::ZeroCopyInputStream* binary_input,
@@ -10,7 +10,10 @@
 
 #include <string>
 
+#include "absl/status/status.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/json/internal/writer.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/util/type_resolver.h"
@@ -22,6 +25,10 @@ namespace json_internal {
 // details.
 absl::Status MessageToJsonString(const Message& message, std::string* output,
                                  json_internal::WriterOptions options);
+// Like MessageToJsonString(), but writes to a stream.
+absl::Status MessageToJsonStream(const Message& message,
+                                 io::ZeroCopyOutputStream* output,
+                                 json_internal::WriterOptions options);
 // Internal version of google::protobuf::util::BinaryToJsonStream; see json_util.h for
 // details.
 absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
@@ -29,6 +36,34 @@ absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
                                 io::ZeroCopyInputStream* binary_input,
                                 io::ZeroCopyOutputStream* json_output,
                                 json_internal::WriterOptions options);
+
+// Writes a stream of messages as JSON records, the inverse of JsonRecordParser.
+// A single JsonWriter, and with it the output buffer, is shared by all
+// records.
+//
+// NDJSON records are always printed without whitespace, since each record
+// must fit on one line.
+class JsonRecordUnparser {
+ public:
+  JsonRecordUnparser(io::ZeroCopyOutputStream* output, bool is_array,
+                     json_internal::WriterOptions options);
+
+  JsonRecordUnparser(const JsonRecordUnparser&) = delete;
+  JsonRecordUnparser& operator=(const JsonRecordUnparser&) = delete;
+
+  // Writes `message` as the next record.
+  absl::Status Write(const Message& message);
+
+  // Ends the stream, closing the array if there is one, and returns any
+  // buffered space to the output stream. Write() may not be called after
+  // this.
+  void Close();
+
+ private:
+  absl::optional<JsonWriter> writer_;
+  bool is_array_;
+  bool is_first_ = true;
+};
 }  // namespace json_internal
 }  // namespace protobuf
 }  // namespace google
@@ -291,10 +291,17 @@ absl::StatusOr<MaybeOwnedString> ZeroCopyBufferedStream::TakeWhile(Pred p) {
       // We treat EOF as ending the take, rather than being an error.
       break;
     }
-    if (!p(cursor_ - start, PeekChar())) {
+    // Test everything that is already buffered before advancing over it in
+    // one step.
+    absl::string_view unread = Unread();
+    size_t taken = 0;
+    while (taken < unread.size() && p(cursor_ + taken - start, unread[taken])) {
+      ++taken;
+    }
+    RETURN_IF_ERROR(Advance(taken));
+    if (taken < unread.size()) {
       break;
     }
-    RETURN_IF_ERROR(Advance(1));
   }
 
   return MaybeOwnedString(this, start, cursor_ - start, guard);
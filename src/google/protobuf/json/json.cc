@@ -7,10 +7,15 @@
 
 #include "google/protobuf/json/json.h"
 
+#include <memory>
 #include <string>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/json/internal/parser.h"
 #include "google/protobuf/json/internal/unparser.h"
@@ -23,12 +28,9 @@
 namespace google {
 namespace protobuf {
 namespace json {
-
-absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
-                                const std::string& type_url,
-                                io::ZeroCopyInputStream* binary_input,
-                                io::ZeroCopyOutputStream* json_output,
-                                const PrintOptions& options) {
+namespace {
+google::protobuf::json_internal::WriterOptions ToWriterOptions(
+    const PrintOptions& options) {
   google::protobuf::json_internal::WriterOptions opts;
   opts.add_whitespace = options.add_whitespace;
   opts.preserve_proto_field_names = options.preserve_proto_field_names;
@@ -39,9 +41,28 @@ absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
 
   // TODO: Drop this setting.
   opts.allow_legacy_syntax = true;
+  return opts;
+}
+
+google::protobuf::json_internal::ParseOptions ToParseOptions(
+    const ParseOptions& options) {
+  google::protobuf::json_internal::ParseOptions opts;
+  opts.ignore_unknown_fields = options.ignore_unknown_fields;
+  opts.case_insensitive_enum_parsing = options.case_insensitive_enum_parsing;
+
+  // TODO: Drop this setting.
+  opts.allow_legacy_syntax = true;
+  return opts;
+}
+}  // namespace
 
+absl::Status BinaryToJsonStream(google::protobuf::util::TypeResolver* resolver,
+                                const std::string& type_url,
+                                io::ZeroCopyInputStream* binary_input,
+                                io::ZeroCopyOutputStream* json_output,
+                                const PrintOptions& options) {
   return google::protobuf::json_internal::BinaryToJsonStream(
-      resolver, type_url, binary_input, json_output, opts);
+      resolver, type_url, binary_input, json_output, ToWriterOptions(options));
 }
 
 absl::Status BinaryToJsonString(google::protobuf::util::TypeResolver* resolver,
@@ -60,15 +81,8 @@ absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
                                 io::ZeroCopyInputStream* json_input,
                                 io::ZeroCopyOutputStream* binary_output,
                                 const ParseOptions& options) {
-  google::protobuf::json_internal::ParseOptions opts;
-  opts.ignore_unknown_fields = options.ignore_unknown_fields;
-  opts.case_insensitive_enum_parsing = options.case_insensitive_enum_parsing;
-
-  // TODO: Drop this setting.
-  opts.allow_legacy_syntax = true;
-
   return google::protobuf::json_internal::JsonToBinaryStream(
-      resolver, type_url, json_input, binary_output, opts);
+      resolver, type_url, json_input, binary_output, ToParseOptions(options));
 }
 
 absl::Status JsonToBinaryString(google::protobuf::util::TypeResolver* resolver,
@@ -82,20 +96,72 @@ absl::Status JsonToBinaryString(google::protobuf::util::TypeResolver* resolver,
                             options);
 }
 
-absl::Status MessageToJsonString(const Message& message, std::string* output,
-                                 const PrintOptions& options) {
-  google::protobuf::json_internal::WriterOptions opts;
-  opts.add_whitespace = options.add_whitespace;
-  opts.preserve_proto_field_names = options.preserve_proto_field_names;
-  opts.always_print_enums_as_ints = options.always_print_enums_as_ints;
-  opts.always_print_fields_with_no_presence =
-      options.always_print_fields_with_no_presence;
-  opts.unquote_int64_if_possible = options.unquote_int64_if_possible;
+namespace {
+// Returns the prototype that `factory` creates for the type that `type_url`
+// names in `pool`.
+absl::StatusOr<const Message*> FindPrototype(const DescriptorPool* pool,
+                                             MessageFactory* factory,
+                                             absl::string_view type_url) {
+  absl::string_view type_name = type_url;
+  size_t slash = type_name.rfind('/');
+  if (slash != absl::string_view::npos) {
+    type_name = type_name.substr(slash + 1);
+  }
+  const Descriptor* descriptor = pool->FindMessageTypeByName(type_name);
+  if (descriptor == nullptr) {
+    return absl::NotFoundError(
+        absl::StrCat("unknown type in type url: ", type_url));
+  }
+  const Message* prototype = factory->GetPrototype(descriptor);
+  if (prototype == nullptr) {
+    return absl::InternalError(
+        absl::StrCat("no prototype for message type: ", type_name));
+  }
+  return prototype;
+}
+}  // namespace
 
-  // TODO: Drop this setting.
-  opts.allow_legacy_syntax = true;
+absl::Status BinaryToJsonStream(const DescriptorPool* pool,
+                                MessageFactory* factory,
+                                absl::string_view type_url,
+                                io::ZeroCopyInputStream* binary_input,
+                                io::ZeroCopyOutputStream* json_output,
+                                const PrintOptions& options) {
+  absl::StatusOr<const Message*> prototype =
+      FindPrototype(pool, factory, type_url);
+  RETURN_IF_ERROR(prototype.status());
+  Arena arena;
+  Message* message = (*prototype)->New(&arena);
+  if (!message->ParsePartialFromZeroCopyStream(binary_input)) {
+    return absl::InvalidArgumentError("invalid binary input");
+  }
+  return json_internal::MessageToJsonStream(*message, json_output,
+                                            ToWriterOptions(options));
+}
 
-  return google::protobuf::json_internal::MessageToJsonString(message, output, opts);
+absl::Status JsonToBinaryStream(const DescriptorPool* pool,
+                                MessageFactory* factory,
+                                absl::string_view type_url,
+                                io::ZeroCopyInputStream* json_input,
+                                io::ZeroCopyOutputStream* binary_output,
+                                const ParseOptions& options) {
+  absl::StatusOr<const Message*> prototype =
+      FindPrototype(pool, factory, type_url);
+  RETURN_IF_ERROR(prototype.status());
+  Arena arena;
+  Message* message = (*prototype)->New(&arena);
+  RETURN_IF_ERROR(json_internal::JsonStreamToMessage(
+      json_input, message, ToParseOptions(options)));
+  if (!message->SerializePartialToZeroCopyStream(binary_output)) {
+    return absl::InternalError("failed to write binary output");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status MessageToJsonString(const Message& message, std::string* output,
+                                 const PrintOptions& options) {
+  return google::protobuf::json_internal::MessageToJsonString(message, output,
+                                                   ToWriterOptions(options));
 }
 
 absl::Status JsonStringToMessage(absl::string_view input, Message* message,
@@ -107,15 +173,55 @@ absl::Status JsonStringToMessage(absl::string_view input, Message* message,
 absl::Status JsonStreamToMessage(io::ZeroCopyInputStream* input,
                                  Message* message,
                                  const ParseOptions& options) {
-  google::protobuf::json_internal::ParseOptions opts;
-  opts.ignore_unknown_fields = options.ignore_unknown_fields;
-  opts.case_insensitive_enum_parsing = options.case_insensitive_enum_parsing;
+  return google::protobuf::json_internal::JsonStreamToMessage(input, message,
+                                                   ToParseOptions(options));
+}
 
-  // TODO: Drop this setting.
-  opts.allow_legacy_syntax = true;
+JsonRecordReader::JsonRecordReader(io::ZeroCopyInputStream* input,
+                                   RecordFormat format,
+                                   const ParseOptions& options)
+    : parser_(std::make_unique<json_internal::JsonRecordParser>(
+          input, format == RecordFormat::kArray, ToParseOptions(options))) {}
+
+JsonRecordReader::~JsonRecordReader() = default;
+
+bool JsonRecordReader::Next(Message* message) {
+  if (done_) return false;
+  message->Clear();
+  absl::StatusOr<bool> has_record = parser_->Next(message);
+  if (!has_record.ok()) {
+    status_ = has_record.status();
+  }
+  done_ = !has_record.ok() || !*has_record;
+  return !done_;
+}
 
-  return google::protobuf::json_internal::JsonStreamToMessage(input, message, opts);
+Message* JsonRecordReader::NextOnArena(const Message& prototype) {
+  if (arena_message_ != nullptr &&
+      (arena_message_->GetDescriptor() != prototype.GetDescriptor() ||
+       arena_.SpaceUsed() > kMaxArenaBytes)) {
+    arena_message_ = nullptr;
+    arena_.Reset();
+  }
+  if (arena_message_ == nullptr) {
+    arena_message_ = prototype.New(&arena_);
+  }
+  return Next(arena_message_) ? arena_message_ : nullptr;
 }
+
+JsonRecordWriter::JsonRecordWriter(io::ZeroCopyOutputStream* output,
+                                   RecordFormat format,
+                                   const PrintOptions& options)
+    : unparser_(std::make_unique<json_internal::JsonRecordUnparser>(
+          output, format == RecordFormat::kArray, ToWriterOptions(options))) {}
+
+JsonRecordWriter::~JsonRecordWriter() { Close(); }
+
+absl::Status JsonRecordWriter::Write(const Message& message) {
+  return unparser_->Write(message);
+}
+
+void JsonRecordWriter::Close() { unparser_->Close(); }
 }  // namespace json
 }  // namespace protobuf
 }  // namespace google
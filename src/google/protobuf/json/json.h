@@ -10,10 +10,14 @@
 #ifndef GOOGLE_PROTOBUF_JSON_JSON_H__
 #define GOOGLE_PROTOBUF_JSON_JSON_H__
 
+#include <memory>
 #include <string>
 
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/util/type_resolver.h"
 
@@ -22,6 +26,11 @@
 
 namespace google {
 namespace protobuf {
+namespace json_internal {
+class JsonRecordParser;
+class JsonRecordUnparser;
+}  // namespace json_internal
+
 namespace json {
 struct ParseOptions {
   // Whether to ignore unknown JSON fields during parsing
@@ -133,6 +142,28 @@ inline absl::Status BinaryToJsonString(google::protobuf::util::TypeResolver* res
                             PrintOptions());
 }
 
+// Converts protobuf binary data to JSON, like the TypeResolver overload, but
+// looks `type_url` up in `pool` and goes through a message created by
+// `factory`. `factory` is usually a DynamicMessageFactory for `pool`, which
+// should be kept across calls so that each type's prototype is built only
+// once. This avoids building an intermediate untyped message from
+// google.protobuf.Type, and is much faster.
+//
+// `type_url` may be a type URL or a fully-qualified message name.
+PROTOBUF_EXPORT absl::Status BinaryToJsonStream(
+    const DescriptorPool* pool, MessageFactory* factory,
+    absl::string_view type_url, io::ZeroCopyInputStream* binary_input,
+    io::ZeroCopyOutputStream* json_output, const PrintOptions& options);
+
+inline absl::Status BinaryToJsonStream(const DescriptorPool* pool,
+                                       MessageFactory* factory,
+                                       absl::string_view type_url,
+                                       io::ZeroCopyInputStream* binary_input,
+                                       io::ZeroCopyOutputStream* json_output) {
+  return BinaryToJsonStream(pool, factory, type_url, binary_input, json_output,
+                            PrintOptions());
+}
+
 // Converts JSON data to protobuf binary format.
 // The conversion will fail if:
 //   1. TypeResolver fails to resolve a type.
@@ -166,6 +197,106 @@ inline absl::Status JsonToBinaryString(google::protobuf::util::TypeResolver* res
   return JsonToBinaryString(resolver, type_url, json_input, binary_output,
                             ParseOptions());
 }
+
+// Converts JSON data to protobuf binary format, like the TypeResolver
+// overload, but parses into a message created by `factory` for the type that
+// `type_url` names in `pool`; see the DescriptorPool overload of
+// BinaryToJsonStream().
+PROTOBUF_EXPORT absl::Status JsonToBinaryStream(
+    const DescriptorPool* pool, MessageFactory* factory,
+    absl::string_view type_url, io::ZeroCopyInputStream* json_input,
+    io::ZeroCopyOutputStream* binary_output, const ParseOptions& options);
+
+inline absl::Status JsonToBinaryStream(
+    const DescriptorPool* pool, MessageFactory* factory,
+    absl::string_view type_url, io::ZeroCopyInputStream* json_input,
+    io::ZeroCopyOutputStream* binary_output) {
+  return JsonToBinaryStream(pool, factory, type_url, json_input, binary_output,
+                            ParseOptions());
+}
+
+// How a stream of JSON records is laid out.
+enum class RecordFormat {
+  // One JSON object per line, also known as NDJSON or JSON Lines.
+  kNewlineDelimited,
+  // The elements of a single top-level JSON array.
+  kArray,
+};
+
+// Reads a stream of JSON records one message at a time. This is much cheaper
+// than splitting the input and calling JsonStringToMessage() per record: the
+// input is never copied, and the lexer is reused across records.
+//
+// Example:
+//   JsonRecordReader reader(&input, RecordFormat::kNewlineDelimited);
+//   const MyRecord& prototype = MyRecord::default_instance();
+//   while (const Message* record = reader.NextOnArena(prototype)) {
+//     ...
+//   }
+//   if (!reader.status().ok()) ...
+//
+// Please note that non-OK statuses are not a stable output of this API and
+// subject to change without notice.
+class PROTOBUF_EXPORT JsonRecordReader {
+ public:
+  JsonRecordReader(io::ZeroCopyInputStream* input, RecordFormat format,
+                   const ParseOptions& options = ParseOptions());
+  JsonRecordReader(const JsonRecordReader&) = delete;
+  JsonRecordReader& operator=(const JsonRecordReader&) = delete;
+  ~JsonRecordReader();
+
+  // Clears `message` and parses the next record into it. Returns false once
+  // the input is exhausted, or on error; status() tells the two apart.
+  bool Next(Message* message);
+
+  // Like Next(), but parses into a message of the same type as `prototype`
+  // that is owned by the reader and allocated on its arena. The message is
+  // cleared and reused for every record, so its memory is recycled; the arena
+  // is reset once it has grown past kMaxArenaBytes.
+  //
+  // The returned message stays valid until the next call. Returns nullptr
+  // once the input is exhausted, or on error.
+  Message* NextOnArena(const Message& prototype);
+
+  // OK unless a record could not be parsed.
+  const absl::Status& status() const { return status_; }
+
+  static constexpr size_t kMaxArenaBytes = 1 << 20;
+
+ private:
+  std::unique_ptr<json_internal::JsonRecordParser> parser_;
+  absl::Status status_;
+  bool done_ = false;
+
+  Arena arena_;
+  Message* arena_message_ = nullptr;
+};
+
+// Writes messages as a stream of JSON records, in the format read by
+// JsonRecordReader. Newline-delimited records are always printed on a single
+// line, regardless of PrintOptions::add_whitespace.
+//
+// The output is complete only after Close(), or after the writer is
+// destroyed.
+class PROTOBUF_EXPORT JsonRecordWriter {
+ public:
+  JsonRecordWriter(io::ZeroCopyOutputStream* output, RecordFormat format,
+                   const PrintOptions& options = PrintOptions());
+  JsonRecordWriter(const JsonRecordWriter&) = delete;
+  JsonRecordWriter& operator=(const JsonRecordWriter&) = delete;
+  ~JsonRecordWriter();
+
+  // Writes `message` as the next record. On error, a partial record may have
+  // been written.
+  absl::Status Write(const Message& message);
+
+  // Terminates the stream and flushes the writer's buffer back to `output`.
+  // Write() may not be called after this.
+  void Close();
+
+ private:
+  std::unique_ptr<json_internal::JsonRecordUnparser> unparser_;
+};
 }  // namespace json
 }  // namespace protobuf
 }  // namespace google
@@ -84,6 +84,7 @@ MATCHER_P(StatusIs, status,
 enum class Codec {
   kReflective,
   kResolver,
+  kDescriptorPool,
 };
 
 class JsonTest : public testing::TestWithParam<Codec> {
@@ -101,10 +102,16 @@ class JsonTest : public testing::TestWithParam<Codec> {
     std::string result;
     io::StringOutputStream out(&result);
 
-    RETURN_IF_ERROR(BinaryToJsonStream(
-        resolver_.get(),
-        absl::StrCat("type.googleapis.com/", proto.GetTypeName()), &in, &out,
-        options));
+    std::string type_url =
+        absl::StrCat("type.googleapis.com/", proto.GetTypeName());
+    if (GetParam() == Codec::kDescriptorPool) {
+      RETURN_IF_ERROR(BinaryToJsonStream(DescriptorPool::generated_pool(),
+                                         &factory_, type_url, &in, &out,
+                                         options));
+    } else {
+      RETURN_IF_ERROR(
+          BinaryToJsonStream(resolver_.get(), type_url, &in, &out, options));
+    }
     return result;
   }
 
@@ -120,10 +127,16 @@ class JsonTest : public testing::TestWithParam<Codec> {
     std::string result;
     io::StringOutputStream out(&result);
 
-    RETURN_IF_ERROR(JsonToBinaryStream(
-        resolver_.get(),
-        absl::StrCat("type.googleapis.com/", proto.GetTypeName()), &in, &out,
-        options));
+    std::string type_url =
+        absl::StrCat("type.googleapis.com/", proto.GetTypeName());
+    if (GetParam() == Codec::kDescriptorPool) {
+      RETURN_IF_ERROR(JsonToBinaryStream(DescriptorPool::generated_pool(),
+                                         &factory_, type_url, &in, &out,
+                                         options));
+    } else {
+      RETURN_IF_ERROR(
+          JsonToBinaryStream(resolver_.get(), type_url, &in, &out, options));
+    }
 
     if (!proto.ParseFromString(result)) {
       return absl::InternalError("wire format parse failed");
@@ -142,10 +155,12 @@ class JsonTest : public testing::TestWithParam<Codec> {
   std::unique_ptr<TypeResolver> resolver_{
       google::protobuf::util::NewTypeResolverForDescriptorPool(
           "type.googleapis.com", DescriptorPool::generated_pool())};
+  DynamicMessageFactory factory_{DescriptorPool::generated_pool()};
 };
 
 INSTANTIATE_TEST_SUITE_P(JsonTestSuite, JsonTest,
-                         testing::Values(Codec::kReflective, Codec::kResolver));
+                         testing::Values(Codec::kReflective, Codec::kResolver,
+                                         Codec::kDescriptorPool));
 
 TEST_P(JsonTest, TestWhitespaces) {
   TestMessage m;
@@ -444,7 +459,7 @@ TEST_P(JsonTest, FloatPrecision) {
   v.mutable_list_value()->add_values()->set_number_value(0.8799999952316284);
 
   EXPECT_THAT(ToJson(v),
-              IsOkAndHolds("[0.99000000953674316,0.87999999523162842]"));
+              IsOkAndHolds("[0.9900000095367432,0.8799999952316284]"));
 }
 
 TEST_P(JsonTest, FloatMinMaxValue) {
@@ -1263,6 +1278,32 @@ TEST_P(JsonTest, HtmlEscape) {
 
 }
 
+TEST_P(JsonTest, ParseCustomJsonName) {
+  auto m = ToProto<proto3::TestCustomJsonName>(R"({"@value": 1})");
+  ASSERT_OK(m);
+  EXPECT_EQ(m->value(), 1);
+
+  // The proto name is accepted alongside a custom json_name.
+  m = ToProto<proto3::TestCustomJsonName>(R"({"value": 2})");
+  ASSERT_OK(m);
+  EXPECT_EQ(m->value(), 2);
+
+  auto evil = ToProto<proto3::TestEvilJson>(R"json({
+    "regular_name": 1,
+    "</script>": 2,
+    "unbalanced\"quotes": 3,
+    "script_and_quotes": 4
+  })json");
+  ASSERT_OK(evil);
+  EXPECT_EQ(evil->regular_value(), 1);
+  EXPECT_EQ(evil->script(), 2);
+  EXPECT_EQ(evil->quotes(), 3);
+  EXPECT_EQ(evil->script_and_quotes(), 4);
+
+  EXPECT_THAT(ToProto<proto3::TestEvilJson>(R"({"regularName": 1})"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST_P(JsonTest, FieldOrder) {
   // $ protoscope -s <<< "3: 3 22: 2 1: 1 22: 2"
   std::string out;
@@ -1316,6 +1357,181 @@ TEST(JsonErrorTest, FieldNameAndSyntaxErrorInSeparateChunks) {
                     "*@ *bool_value"));
 }
 
+TEST(JsonRecordTest, ReadNewlineDelimited) {
+  // Records straddle the chunk boundaries.
+  io::internal::TestZeroCopyInputStream input(
+      {"{\"int32_value\": 1}\n{\"string_", "value\": \"two\"}\n\n",
+       "  {\"repeated_int32_value\": [3, 4]}"});
+  JsonRecordReader reader(&input, RecordFormat::kNewlineDelimited);
+
+  TestMessage m;
+  m.set_bool_value(true);
+  ASSERT_TRUE(reader.Next(&m));
+  EXPECT_EQ(m.int32_value(), 1);
+  EXPECT_FALSE(m.bool_value());
+  ASSERT_TRUE(reader.Next(&m));
+  EXPECT_EQ(m.int32_value(), 0);
+  EXPECT_EQ(m.string_value(), "two");
+  ASSERT_TRUE(reader.Next(&m));
+  EXPECT_THAT(m.repeated_int32_value(), ElementsAre(3, 4));
+  EXPECT_FALSE(reader.Next(&m));
+  EXPECT_OK(reader.status());
+  EXPECT_FALSE(reader.Next(&m));
+}
+
+TEST(JsonRecordTest, ReadArray) {
+  std::string json = R"([{"int32_value": 1}, {"int32_value": 2},
+                         {"int32_value": 3}] )";
+  io::ArrayInputStream input(json.data(), json.size(), 7);
+  JsonRecordReader reader(&input, RecordFormat::kArray);
+
+  std::vector<int32_t> values;
+  while (const Message* record =
+             reader.NextOnArena(TestMessage::default_instance())) {
+    values.push_back(DownCastMessage<TestMessage>(record)->int32_value());
+  }
+  EXPECT_OK(reader.status());
+  EXPECT_THAT(values, ElementsAre(1, 2, 3));
+}
+
+// Reads all records from `json`, returning the status at the end.
+absl::Status ReadAllRecords(absl::string_view json, RecordFormat format,
+                            int* count) {
+  io::ArrayInputStream input(json.data(), json.size());
+  JsonRecordReader reader(&input, format);
+  TestMessage m;
+  *count = 0;
+  while (reader.Next(&m)) ++*count;
+  // The reader stops at the end, or at the first error.
+  EXPECT_FALSE(reader.Next(&m));
+  return reader.status();
+}
+
+TEST(JsonRecordTest, ReadEmpty) {
+  int count;
+  EXPECT_OK(ReadAllRecords("\n \n", RecordFormat::kNewlineDelimited, &count));
+  EXPECT_EQ(count, 0);
+  EXPECT_OK(ReadAllRecords(" [ ] ", RecordFormat::kArray, &count));
+  EXPECT_EQ(count, 0);
+}
+
+TEST(JsonRecordTest, ReadErrors) {
+  int count;
+  EXPECT_THAT(ReadAllRecords("{} {}", RecordFormat::kNewlineDelimited, &count),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_EQ(count, 1);
+  EXPECT_THAT(ReadAllRecords(R"({"int32_value": "x"})"
+                             "\n{}",
+                             RecordFormat::kNewlineDelimited, &count),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_EQ(count, 0);
+  EXPECT_THAT(ReadAllRecords("[{}] {}", RecordFormat::kArray, &count),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_EQ(count, 1);
+  EXPECT_THAT(ReadAllRecords("[{}", RecordFormat::kArray, &count),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_EQ(count, 1);
+  EXPECT_THAT(ReadAllRecords("{}", RecordFormat::kArray, &count),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_EQ(count, 0);
+}
+
+TEST(JsonRecordTest, WriteNewlineDelimited) {
+  TestMessage m;
+  std::string json;
+  {
+    io::StringOutputStream output(&json);
+    PrintOptions options;
+    options.add_whitespace = true;
+    JsonRecordWriter writer(&output, RecordFormat::kNewlineDelimited, options);
+    m.set_int32_value(1);
+    ASSERT_OK(writer.Write(m));
+    m.add_repeated_int32_value(2);
+    ASSERT_OK(writer.Write(m));
+  }
+  EXPECT_EQ(json,
+            "{\"int32Value\":1}\n"
+            "{\"int32Value\":1,\"repeatedInt32Value\":[2]}\n");
+}
+
+TEST(JsonRecordTest, WriteArray) {
+  TestMessage m;
+  std::string json;
+  io::StringOutputStream output(&json);
+  JsonRecordWriter writer(&output, RecordFormat::kArray);
+  m.set_int32_value(1);
+  ASSERT_OK(writer.Write(m));
+  m.set_int32_value(2);
+  ASSERT_OK(writer.Write(m));
+  writer.Close();
+  EXPECT_EQ(json, R"([{"int32Value":1},{"int32Value":2}])");
+
+  std::string empty;
+  {
+    io::StringOutputStream empty_output(&empty);
+    JsonRecordWriter empty_writer(&empty_output, RecordFormat::kArray);
+  }
+  EXPECT_EQ(empty, "[]");
+}
+
+TEST(JsonRecordTest, RoundTrip) {
+  for (RecordFormat format :
+       {RecordFormat::kNewlineDelimited, RecordFormat::kArray}) {
+    for (bool add_whitespace : {false, true}) {
+      std::string json;
+      {
+        io::StringOutputStream output(&json);
+        PrintOptions options;
+        options.add_whitespace = add_whitespace;
+        JsonRecordWriter writer(&output, format, options);
+        TestMessage m;
+        for (int i = 0; i < 100; ++i) {
+          m.set_int32_value(i);
+          m.add_repeated_string_value(absl::StrCat("value ", i));
+          ASSERT_OK(writer.Write(m));
+        }
+      }
+
+      io::ArrayInputStream input(json.data(), json.size(), 13);
+      JsonRecordReader reader(&input, format);
+      TestMessage m;
+      int count = 0;
+      while (reader.Next(&m)) {
+        EXPECT_EQ(m.int32_value(), count);
+        EXPECT_THAT(m.repeated_string_value(), SizeIs(count + 1));
+        ++count;
+      }
+      EXPECT_OK(reader.status());
+      EXPECT_EQ(count, 100) << json;
+    }
+  }
+}
+
+TEST(JsonDescriptorPoolTest, UnknownType) {
+  DynamicMessageFactory factory;
+  std::string json = "{}";
+  io::ArrayInputStream in(json.data(), json.size());
+  std::string binary;
+  io::StringOutputStream out(&binary);
+  EXPECT_THAT(JsonToBinaryStream(DescriptorPool::generated_pool(), &factory,
+                                 "type.googleapis.com/proto3.NoSuchMessage",
+                                 &in, &out),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST(JsonDescriptorPoolTest, AcceptsBareTypeName) {
+  DynamicMessageFactory factory;
+  TestMessage m;
+  m.set_int32_value(42);
+  std::string binary = m.SerializeAsString();
+  io::ArrayInputStream in(binary.data(), binary.size());
+  std::string json;
+  io::StringOutputStream out(&json);
+  ASSERT_OK(BinaryToJsonStream(DescriptorPool::generated_pool(), &factory,
+                               "proto3.TestMessage", &in, &out));
+  EXPECT_EQ(json, R"({"int32Value":42})");
+}
+
 }  // namespace
 }  // namespace json
 }  // namespace protobuf
@@ -77,13 +77,15 @@ void UntypedMapBase::TransferTree(Tree* tree, GetKey get_key) {
   do {
     NodeBase* next = node->next;
 
-    map_index_t b = VariantBucketNumber(get_key(node));
+    const size_t hash = VariantHash(get_key(node));
+    const map_index_t b = BucketFromHash(hash);
+    const uint8_t filter_bit = FilterBitFromHash(hash);
     // This is similar to InsertUnique, but with erasure.
     if (TableEntryIsEmpty(b)) {
-      InsertUniqueInList(b, node);
+      InsertUniqueInList(b, filter_bit, node);
       index_of_first_non_null_ = (std::min)(index_of_first_non_null_, b);
     } else if (TableEntryIsNonEmptyList(b) && !TableEntryIsTooLong(b)) {
-      InsertUniqueInList(b, node);
+      InsertUniqueInList(b, filter_bit, node);
     } else {
       InsertUniqueInTree(b, get_key, node);
     }
@@ -180,6 +182,7 @@ void UntypedMapBase::ClearTable(const ClearInput input) {
     index_of_first_non_null_ = num_buckets_;
   } else {
     DeleteTable(table_, num_buckets_);
+    DeleteFilters(filters_, num_buckets_);
   }
 }
 
@@ -196,8 +199,8 @@ auto UntypedMapBase::FindFromTree(map_index_t b, VariantKey key,
 
 size_t UntypedMapBase::SpaceUsedInTable(size_t sizeof_node) const {
   size_t size = 0;
-  // The size of the table.
-  size += sizeof(void*) * num_buckets_;
+  // The size of the table and of its bucket filters.
+  size += sizeof(void*) * num_buckets_ + FiltersAllocSize(num_buckets_);
   // All the nodes.
   size += sizeof_node * num_elements_;
   // For each tree, count the overhead of those nodes.
@@ -566,6 +566,7 @@ class PROTOBUF_EXPORT UntypedMapBase {
         seed_(0),
         index_of_first_non_null_(internal::kGlobalEmptyTableSize),
         table_(const_cast<TableEntryPtr*>(internal::kGlobalEmptyTable)),
+        filters_(nullptr),
         alloc_(arena) {}
 
   UntypedMapBase(const UntypedMapBase&) = delete;
@@ -584,6 +585,7 @@ class PROTOBUF_EXPORT UntypedMapBase {
     std::swap(seed_, other->seed_);
     std::swap(index_of_first_non_null_, other->index_of_first_non_null_);
     std::swap(table_, other->table_);
+    std::swap(filters_, other->filters_);
     std::swap(alloc_, other->alloc_);
   }
 
@@ -608,6 +610,8 @@ class PROTOBUF_EXPORT UntypedMapBase {
   struct NodeAndBucket {
     NodeBase* node;
     map_index_t bucket;
+    // The key's bit in the bucket filter; see `filters_`.
+    uint8_t filter_bit = 0;
   };
 
   // Returns whether we should insert after the head of the list. For
@@ -626,7 +630,9 @@ class PROTOBUF_EXPORT UntypedMapBase {
 
   // Helper for InsertUnique.  Handles the case where bucket b is a
   // not-too-long linked list.
-  void InsertUniqueInList(map_index_t b, NodeBase* node) {
+  void InsertUniqueInList(map_index_t b, uint8_t filter_bit, NodeBase* node) {
+    // The filter of an empty bucket is stale, so start it over.
+    filters_[b] = TableEntryIsEmpty(b) ? filter_bit : filters_[b] | filter_bit;
     if (!TableEntryIsEmpty(b) && ShouldInsertAfterHead(node)) {
       auto* first = TableEntryToNode(table_[b]);
       node->next = first->next;
@@ -692,6 +698,14 @@ class PROTOBUF_EXPORT UntypedMapBase {
     }
   }
 
+  void DeleteFilters(uint8_t* filters, map_index_t n) {
+    if (auto* a = arena()) {
+      a->ReturnArrayMemory(filters, FiltersAllocSize(n));
+    } else {
+      internal::SizedDelete(filters, FiltersAllocSize(n));
+    }
+  }
+
   NodeBase* DestroyTree(Tree* tree);
   using GetKey = VariantKey (*)(NodeBase*);
   void InsertUniqueInTree(map_index_t b, GetKey get_key, NodeBase* node);
@@ -699,21 +713,28 @@ class PROTOBUF_EXPORT UntypedMapBase {
   TableEntryPtr ConvertToTree(NodeBase* node, GetKey get_key);
   void EraseFromTree(map_index_t b, typename Tree::iterator tree_it);
 
-  map_index_t VariantBucketNumber(VariantKey key) const {
+  // The low bits of a key's hash select its bucket and the top bits select
+  // its bit in the bucket filter.
+  size_t VariantHash(VariantKey key) const {
     return key.data == nullptr
-               ? VariantBucketNumber(key.integral)
-               : VariantBucketNumber(absl::string_view(
+               ? VariantHash(key.integral)
+               : VariantHash(absl::string_view(
                      key.data, static_cast<size_t>(key.integral)));
   }
 
-  map_index_t VariantBucketNumber(absl::string_view key) const {
-    return static_cast<map_index_t>(absl::HashOf(seed_, key) &
-                                    (num_buckets_ - 1));
+  size_t VariantHash(absl::string_view key) const {
+    return absl::HashOf(seed_, key);
   }
 
-  map_index_t VariantBucketNumber(uint64_t key) const {
-    return static_cast<map_index_t>(absl::HashOf(key ^ seed_) &
-                                    (num_buckets_ - 1));
+  size_t VariantHash(uint64_t key) const { return absl::HashOf(key ^ seed_); }
+
+  map_index_t BucketFromHash(size_t hash) const {
+    return static_cast<map_index_t>(hash & (num_buckets_ - 1));
+  }
+
+  static uint8_t FilterBitFromHash(size_t hash) {
+    return static_cast<uint8_t>(
+        1u << (hash >> (std::numeric_limits<size_t>::digits - 3)));
   }
 
   TableEntryPtr* CreateEmptyTable(map_index_t n) {
@@ -724,6 +745,18 @@ class PROTOBUF_EXPORT UntypedMapBase {
     return result;
   }
 
+  // The filters of small tables are padded to 16 bytes, the smallest array
+  // that the arena can reuse, so they can be returned to it like the table.
+  static size_t FiltersAllocSize(map_index_t n) {
+    return std::max<size_t>(n, 16);
+  }
+
+  uint8_t* CreateFilters(map_index_t n) {
+    uint8_t* result = AllocFor<uint8_t>(alloc_).allocate(FiltersAllocSize(n));
+    memset(result, 0, n);
+    return result;
+  }
+
   // Return a randomish value.
   map_index_t Seed() const {
     uint64_t s = 0;
@@ -813,6 +846,12 @@ class PROTOBUF_EXPORT UntypedMapBase {
   map_index_t seed_;
   map_index_t index_of_first_non_null_;
   TableEntryPtr* table_;  // an array with num_buckets_ entries
+  // An array with num_buckets_ entries, allocated by CreateFilters(). For a
+  // bucket holding a list, each key in the list sets one of the 8 bits of the
+  // bucket's filter, chosen by its hash, so most lookups of absent keys
+  // return without touching any node. Filters of empty buckets and of trees
+  // are stale and never read.
+  uint8_t* filters_;
   Allocator alloc_;
 };
 
@@ -973,20 +1012,27 @@ class KeyMapBase : public UntypedMapBase {
 
   NodeAndBucket FindHelper(typename TS::ViewType k,
                            TreeIterator* it = nullptr) const {
-    map_index_t b = BucketNumber(k);
+    const size_t hash = Hash(k);
+    const map_index_t b = BucketFromHash(hash);
+    const uint8_t filter_bit = FilterBitFromHash(hash);
     if (TableEntryIsNonEmptyList(b)) {
-      auto* node = internal::TableEntryToNode(table_[b]);
-      do {
-        if (TS::Equals(static_cast<KeyNode*>(node)->key(), k)) {
-          return {node, b};
-        } else {
-          node = node->next;
-        }
-      } while (node != nullptr);
+      if (filters_[b] & filter_bit) {
+        auto* node = internal::TableEntryToNode(table_[b]);
+        do {
+          if (TS::Equals(static_cast<KeyNode*>(node)->key(), k)) {
+            return {node, b, filter_bit};
+          } else {
+            node = node->next;
+          }
+        } while (node != nullptr);
+      }
     } else if (TableEntryIsTree(b)) {
-      return FindFromTree(b, internal::RealKeyToVariantKey<Key>{}(k), it);
+      NodeAndBucket res =
+          FindFromTree(b, internal::RealKeyToVariantKey<Key>{}(k), it);
+      res.filter_bit = filter_bit;
+      return res;
     }
-    return {nullptr, b};
+    return {nullptr, b, filter_bit};
   }
 
   // Insert the given node.
@@ -997,22 +1043,26 @@ class KeyMapBase : public UntypedMapBase {
     KeyNode* to_erase = nullptr;
     auto p = this->FindHelper(node->key());
     map_index_t b = p.bucket;
+    uint8_t filter_bit = p.filter_bit;
     if (p.node != nullptr) {
       erase_no_destroy(p.bucket, static_cast<KeyNode*>(p.node));
       to_erase = static_cast<KeyNode*>(p.node);
     } else if (ResizeIfLoadIsOutOfRange(num_elements_ + 1)) {
-      b = BucketNumber(node->key());  // bucket_number
+      // Resizing may also reseed, so both come from a fresh hash.
+      const size_t hash = Hash(node->key());
+      b = BucketFromHash(hash);
+      filter_bit = FilterBitFromHash(hash);
     }
-    InsertUnique(b, node);
+    InsertUnique(b, filter_bit, node);
     ++num_elements_;
     return to_erase;
   }
 
   // Insert the given Node in bucket b.  If that would make bucket b too big,
   // and bucket b is not a tree, create a tree for buckets b.
-  // Requires count(*KeyPtrFromNodePtr(node)) == 0 and that b is the correct
-  // bucket.  num_elements_ is not modified.
-  void InsertUnique(map_index_t b, KeyNode* node) {
+  // Requires count(*KeyPtrFromNodePtr(node)) == 0 and that b and filter_bit
+  // are the correct bucket and filter bit.  num_elements_ is not modified.
+  void InsertUnique(map_index_t b, uint8_t filter_bit, KeyNode* node) {
     ABSL_DCHECK(index_of_first_non_null_ == num_buckets_ ||
                 !TableEntryIsEmpty(index_of_first_non_null_));
     // In practice, the code that led to this point may have already
@@ -1021,10 +1071,10 @@ class KeyMapBase : public UntypedMapBase {
     // it's likely that we're inserting into an empty or short list.
     ABSL_DCHECK(FindHelper(TS::ToView(node->key())).node == nullptr);
     if (TableEntryIsEmpty(b)) {
-      InsertUniqueInList(b, node);
+      InsertUniqueInList(b, filter_bit, node);
       index_of_first_non_null_ = (std::min)(index_of_first_non_null_, b);
     } else if (TableEntryIsNonEmptyList(b) && !TableEntryIsTooLong(b)) {
-      InsertUniqueInList(b, node);
+      InsertUniqueInList(b, filter_bit, node);
     } else {
       InsertUniqueInTree(b, NodeToVariantKey, node);
     }
@@ -1093,15 +1143,18 @@ class KeyMapBase : public UntypedMapBase {
       // Just overwrite with a new one. No need to transfer or free anything.
       num_buckets_ = index_of_first_non_null_ = kMinTableSize;
       table_ = CreateEmptyTable(num_buckets_);
+      filters_ = CreateFilters(num_buckets_);
       seed_ = Seed();
       return;
     }
 
     ABSL_DCHECK_GE(new_num_buckets, kMinTableSize);
     const auto old_table = table_;
+    const auto old_filters = filters_;
     const map_index_t old_table_size = num_buckets_;
     num_buckets_ = new_num_buckets;
     table_ = CreateEmptyTable(num_buckets_);
+    filters_ = CreateFilters(num_buckets_);
     const map_index_t start = index_of_first_non_null_;
     index_of_first_non_null_ = num_buckets_;
     for (map_index_t i = start; i < old_table_size; ++i) {
@@ -1112,22 +1165,27 @@ class KeyMapBase : public UntypedMapBase {
       }
     }
     DeleteTable(old_table, old_table_size);
+    DeleteFilters(old_filters, old_table_size);
   }
 
   // Transfer all nodes in the list `node` into `this`.
   void TransferList(KeyNode* node) {
     do {
       auto* next = static_cast<KeyNode*>(node->next);
-      InsertUnique(BucketNumber(TS::ToView(node->key())), node);
+      const size_t hash = Hash(TS::ToView(node->key()));
+      InsertUnique(BucketFromHash(hash), FilterBitFromHash(hash), node);
       node = next;
     } while (node != nullptr);
   }
 
+  size_t Hash(typename TS::ViewType k) const {
+    ABSL_DCHECK_EQ(VariantHash(RealKeyToVariantKeyAlternative<Key>{}(k)),
+                   VariantHash(RealKeyToVariantKey<Key>{}(k)));
+    return VariantHash(RealKeyToVariantKeyAlternative<Key>{}(k));
+  }
+
   map_index_t BucketNumber(typename TS::ViewType k) const {
-    ABSL_DCHECK_EQ(
-        VariantBucketNumber(RealKeyToVariantKeyAlternative<Key>{}(k)),
-        VariantBucketNumber(RealKeyToVariantKey<Key>{}(k)));
-    return VariantBucketNumber(RealKeyToVariantKeyAlternative<Key>{}(k));
+    return BucketFromHash(Hash(k));
   }
 
   // Assumes node_ and m_ are correct and non-null, but other fields may be
@@ -1728,6 +1786,7 @@ class Map : private internal::KeyMapBase<internal::KeyForBase<Key>> {
   std::pair<iterator, bool> TryEmplaceInternal(K&& k, Args&&... args) {
     auto p = this->FindHelper(TS::ToView(k));
     internal::map_index_t b = p.bucket;
+    uint8_t filter_bit = p.filter_bit;
     // Case 1: key was already present.
     if (p.node != nullptr)
       return std::make_pair(iterator(internal::UntypedMapIterator{
@@ -1735,7 +1794,10 @@ class Map : private internal::KeyMapBase<internal::KeyForBase<Key>> {
                             false);
     // Case 2: insert.
     if (this->ResizeIfLoadIsOutOfRange(this->num_elements_ + 1)) {
-      b = this->BucketNumber(TS::ToView(k));
+      // Resizing may also reseed, so both come from a fresh hash.
+      const size_t hash = this->Hash(TS::ToView(k));
+      b = this->BucketFromHash(hash);
+      filter_bit = this->FilterBitFromHash(hash);
     }
     // If K is not key_type, make the conversion to key_type explicit.
     using TypeToInit = typename std::conditional<
@@ -1757,7 +1819,7 @@ class Map : private internal::KeyMapBase<internal::KeyForBase<Key>> {
     Arena::CreateInArenaStorage(&node->kv.second, this->alloc_.arena(),
                                 std::forward<Args>(args)...);
 
-    this->InsertUnique(b, node);
+    this->InsertUnique(b, filter_bit, node);
     ++this->num_elements_;
     return std::make_pair(iterator(internal::UntypedMapIterator{node, this, b}),
                           true);
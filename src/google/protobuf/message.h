@@ -185,6 +185,7 @@ PROTOBUF_EXPORT std::string ShortFormat(
 PROTOBUF_EXPORT std::string Utf8Format(
     const Message& message);  // text_format.cc
 namespace util {
+class FieldAccessPlan;
 class MessageDifferencer;
 }
 
@@ -1103,6 +1104,7 @@ class PROTOBUF_EXPORT Reflection final {
   friend class GeneratedMessageReflectionTestHelper;
   friend class python::MapReflectionFriend;
   friend class python::MessageReflectionFriend;
+  friend class util::FieldAccessPlan;
   friend class util::MessageDifferencer;
 #define GOOGLE_PROTOBUF_HAS_CEL_MAP_REFLECTION_FRIEND
   friend class expr::CelMapReflectionFriend;
@@ -367,6 +367,20 @@ bool MessageLite::ParsePartialFromFileDescriptor(int file_descriptor) {
   return ParsePartialFromZeroCopyStream(&input) && input.GetErrno() == 0;
 }
 
+bool MessageLite::ParseFromMappedFile(int file_descriptor) {
+  io::MmapInputStream input(file_descriptor);
+  if (input.GetErrno() != 0) return ParseFromFileDescriptor(file_descriptor);
+  return ParseFromZeroCopyStream(&input);
+}
+
+bool MessageLite::ParsePartialFromMappedFile(int file_descriptor) {
+  io::MmapInputStream input(file_descriptor);
+  if (input.GetErrno() != 0) {
+    return ParsePartialFromFileDescriptor(file_descriptor);
+  }
+  return ParsePartialFromZeroCopyStream(&input);
+}
+
 bool MessageLite::ParseFromIstream(std::istream* input) {
   io::IstreamInputStream zero_copy_input(input);
   return ParseFromZeroCopyStream(&zero_copy_input) && input->eof();
@@ -529,6 +543,23 @@ bool MessageLite::SerializeToZeroCopyStream(
 
 bool MessageLite::SerializePartialToZeroCopyStream(
     io::ZeroCopyOutputStream* output) const {
+  return SerializePartialToZeroCopyStreamImpl(output, /*aliasing=*/false);
+}
+
+bool MessageLite::SerializeAliasedToZeroCopyStream(
+    io::ZeroCopyOutputStream* output) const {
+  ABSL_DCHECK(IsInitialized())
+      << InitializationErrorMessage("serialize", *this);
+  return SerializePartialAliasedToZeroCopyStream(output);
+}
+
+bool MessageLite::SerializePartialAliasedToZeroCopyStream(
+    io::ZeroCopyOutputStream* output) const {
+  return SerializePartialToZeroCopyStreamImpl(output, /*aliasing=*/true);
+}
+
+bool MessageLite::SerializePartialToZeroCopyStreamImpl(
+    io::ZeroCopyOutputStream* output, bool aliasing) const {
   const size_t size = ByteSizeLong();  // Force size to be cached.
   if (size > INT_MAX) {
     ABSL_LOG(ERROR) << GetTypeName()
@@ -540,20 +571,23 @@ bool MessageLite::SerializePartialToZeroCopyStream(
   io::EpsCopyOutputStream stream(
       output, io::CodedOutputStream::IsDefaultSerializationDeterministic(),
       &target);
+  stream.EnableAliasing(aliasing);
   target = _InternalSerialize(target, &stream);
   stream.Trim(target);
   if (stream.HadError()) return false;
   return true;
 }
 
+// FileOutputStream writes aliased data out before returning, so large fields
+// can be written straight from the message.
 bool MessageLite::SerializeToFileDescriptor(int file_descriptor) const {
   io::FileOutputStream output(file_descriptor);
-  return SerializeToZeroCopyStream(&output) && output.Flush();
+  return SerializeAliasedToZeroCopyStream(&output) && output.Flush();
 }
 
 bool MessageLite::SerializePartialToFileDescriptor(int file_descriptor) const {
   io::FileOutputStream output(file_descriptor);
-  return SerializePartialToZeroCopyStream(&output) && output.Flush();
+  return SerializePartialAliasedToZeroCopyStream(&output) && output.Flush();
 }
 
 bool MessageLite::SerializeToOstream(std::ostream* output) const {
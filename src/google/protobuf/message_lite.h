@@ -629,6 +629,16 @@ class PROTOBUF_EXPORT MessageLite {
   // required fields.
   ABSL_ATTRIBUTE_REINITIALIZES bool ParsePartialFromFileDescriptor(
       int file_descriptor);
+  // Parse a protocol buffer from the whole file, which is mapped into memory
+  // rather than read, so the parser reads the page cache directly.  The file
+  // offset is ignored and left unchanged.  Files that cannot be mapped, such
+  // as pipes, are read like ParseFromFileDescriptor() instead.  See
+  // io::MmapInputStream to also alias large Cord fields into the mapping.
+  ABSL_ATTRIBUTE_REINITIALIZES bool ParseFromMappedFile(int file_descriptor);
+  // Like ParseFromMappedFile(), but accepts messages that are missing
+  // required fields.
+  ABSL_ATTRIBUTE_REINITIALIZES bool ParsePartialFromMappedFile(
+      int file_descriptor);
   // Parse a protocol buffer from a C++ istream.  If successful, the entire
   // input will be consumed.
   ABSL_ATTRIBUTE_REINITIALIZES bool ParseFromIstream(std::istream* input);
@@ -707,6 +717,17 @@ class PROTOBUF_EXPORT MessageLite {
   bool SerializeToZeroCopyStream(io::ZeroCopyOutputStream* output) const;
   // Like SerializeToZeroCopyStream(), but allows missing required fields.
   bool SerializePartialToZeroCopyStream(io::ZeroCopyOutputStream* output) const;
+  // Like SerializeToZeroCopyStream(), but if `output` AllowsAliasing(), the
+  // contents of large string, bytes and Cord fields are handed to it through
+  // WriteAliasedRaw() and WriteCord() instead of being copied into its
+  // buffers.  With a stream that keeps references to them, such as
+  // io::SegmentedOutputStream, the message must then not be modified or
+  // destroyed while the output is in use.
+  bool SerializeAliasedToZeroCopyStream(io::ZeroCopyOutputStream* output) const;
+  // Like SerializeAliasedToZeroCopyStream(), but allows missing required
+  // fields.
+  bool SerializePartialAliasedToZeroCopyStream(
+      io::ZeroCopyOutputStream* output) const;
   // Serialize the message and store it in the given string.  All required
   // fields must be set.
   bool SerializeToString(std::string* output) const;
@@ -1018,6 +1039,9 @@ class PROTOBUF_EXPORT MessageLite {
 
   bool MergeFromImpl(io::CodedInputStream* input, ParseFlags parse_flags);
 
+  bool SerializePartialToZeroCopyStreamImpl(io::ZeroCopyOutputStream* output,
+                                            bool aliasing) const;
+
   // Runs the destructor for this instance.
   void DestroyInstance();
   // Runs the destructor for this instance and deletes the memory via
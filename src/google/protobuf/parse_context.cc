@@ -8,8 +8,16 @@
 #include "google/protobuf/parse_context.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <cstring>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "absl/numeric/bits.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/message_lite.h"
@@ -332,6 +340,28 @@ void WriteLengthDelimited(uint32_t num, absl::string_view val, std::string* s) {
   s->append(val.data(), val.size());
 }
 
+int CountVarintTerminators(const char* ptr, const char* end) {
+  int count = 0;
+#if defined(__SSE2__)
+  for (; end - ptr >= 16; ptr += 16) {
+    uint32_t continuation = static_cast<uint32_t>(_mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr))));
+    count += 16 - absl::popcount(continuation);
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (; end - ptr >= 16; ptr += 16) {
+    uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(ptr));
+    count += 16 - vaddvq_u8(vshrq_n_u8(bytes, 7));
+  }
+#endif
+  for (; end - ptr >= 8; ptr += 8) {
+    uint64_t continuation = UnalignedLoad<uint64_t>(ptr) & 0x8080808080808080;
+    count += 8 - absl::popcount(continuation);
+  }
+  for (; ptr < end; ++ptr) count += static_cast<uint8_t>(*ptr) < 0x80;
+  return count;
+}
+
 std::pair<const char*, uint32_t> VarintParseSlow32(const char* p,
                                                    uint32_t res) {
   for (std::uint32_t i = 1; i < 5; i++) {
@@ -425,19 +455,20 @@ const char* InlineGreedyStringParser(std::string* s, const char* ptr,
 
 template <typename T, bool sign>
 const char* VarintParser(void* object, const char* ptr, ParseContext* ctx) {
-  return ctx->ReadPackedVarint(ptr, [object](uint64_t varint) {
-    T val;
-    if (sign) {
-      if (sizeof(T) == 8) {
-        val = WireFormatLite::ZigZagDecode64(varint);
-      } else {
-        val = WireFormatLite::ZigZagDecode32(varint);
-      }
-    } else {
-      val = varint;
-    }
-    static_cast<RepeatedField<T>*>(object)->Add(val);
-  });
+  return ctx->ReadPackedVarint(
+      ptr, static_cast<RepeatedField<T>*>(object), [](uint64_t varint) {
+        T val;
+        if (sign) {
+          if (sizeof(T) == 8) {
+            val = WireFormatLite::ZigZagDecode64(varint);
+          } else {
+            val = WireFormatLite::ZigZagDecode32(varint);
+          }
+        } else {
+          val = varint;
+        }
+        return val;
+      });
 }
 
 const char* PackedInt32Parser(void* object, const char* ptr,
@@ -234,6 +234,13 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   template <typename Add, typename SizeCb>
   PROTOBUF_NODISCARD const char* ReadPackedVarint(const char* ptr, Add add,
                                                   SizeCb size_callback);
+  // Parses a packed varint field directly into `out`. Unlike the callback
+  // version, the field is grown once per buffer chunk and runs of single byte
+  // varints are decoded 16 at a time. `convert` maps the raw varint to T.
+  template <typename T, typename Convert>
+  PROTOBUF_NODISCARD const char* ReadPackedVarint(const char* ptr,
+                                                  RepeatedField<T>* out,
+                                                  Convert convert);
 
   uint32_t LastTag() const { return last_tag_minus_1_ + 1; }
   bool ConsumeEndGroup(uint32_t start_tag) {
@@ -351,6 +358,12 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   // systems. TODO do we need to set this as build flag?
   enum { kSafeStringSize = 50000000 };
 
+  // Runs `parse_array(begin, end)` over the `size` bytes of a packed varint
+  // field at `ptr`, flipping buffers as needed.
+  template <typename ParseArray>
+  const char* ReadPackedVarintChunks(const char* ptr, int size,
+                                     ParseArray parse_array);
+
   int BytesAvailable(const char* ptr) const {
     ABSL_DCHECK_NE(ptr, nullptr);
     ptrdiff_t available = buffer_end_ + kSlopBytes - ptr;
@@ -1173,6 +1186,36 @@ const char* EpsCopyInputStream::ReadRepeatedFixed(const char* ptr,
 #define GOOGLE_PROTOBUF_PARSER_ASSERT(predicate) \
   GOOGLE_PROTOBUF_ASSERT_RETURN(predicate, nullptr)
 
+// Copies `num` values of type T from `src` into `dst`, reversing the byte
+// order of each.  The values are copied in bulk and then byte swapped in
+// place, which, unlike loading each unaligned element, vectorizes.
+template <typename T>
+inline void CopyPackedFixedSwapped(T* dst, const char* src, int num) {
+  static_assert(sizeof(T) == 4 || sizeof(T) == 8, "");
+  using Bits = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+  std::memcpy(dst, src, num * sizeof(T));
+  for (int i = 0; i < num; i++) {
+    Bits bits;
+    std::memcpy(&bits, dst + i, sizeof(bits));
+    if constexpr (sizeof(T) == 4) {
+      bits = BSwap32(bits);
+    } else {
+      bits = BSwap64(bits);
+    }
+    std::memcpy(dst + i, &bits, sizeof(bits));
+  }
+}
+
+// Copies `num` little endian values of type T from `src` into `dst`.
+template <typename T>
+inline void CopyPackedFixed(T* dst, const char* src, int num) {
+#ifdef ABSL_IS_LITTLE_ENDIAN
+  std::memcpy(dst, src, num * sizeof(T));
+#else
+  CopyPackedFixedSwapped(dst, src, num);
+#endif
+}
+
 template <typename T>
 const char* EpsCopyInputStream::ReadPackedFixed(const char* ptr, int size,
                                                 RepeatedField<T>* out) {
@@ -1184,12 +1227,7 @@ const char* EpsCopyInputStream::ReadPackedFixed(const char* ptr, int size,
     out->Reserve(old_entries + num);
     int block_size = num * sizeof(T);
     auto dst = out->AddNAlreadyReserved(num);
-#ifdef ABSL_IS_LITTLE_ENDIAN
-    std::memcpy(dst, ptr, block_size);
-#else
-    for (int i = 0; i < num; i++)
-      dst[i] = UnalignedLoad<T>(ptr + i * sizeof(T));
-#endif
+    CopyPackedFixed(dst, ptr, num);
     size -= block_size;
     if (limit_ <= kSlopBytes) return nullptr;
     ptr = Next();
@@ -1203,12 +1241,8 @@ const char* EpsCopyInputStream::ReadPackedFixed(const char* ptr, int size,
   int old_entries = out->size();
   out->Reserve(old_entries + num);
   auto dst = out->AddNAlreadyReserved(num);
-#ifdef ABSL_IS_LITTLE_ENDIAN
   ABSL_CHECK(dst != nullptr) << out << "," << num;
-  std::memcpy(dst, ptr, block_size);
-#else
-  for (int i = 0; i < num; i++) dst[i] = UnalignedLoad<T>(ptr + i * sizeof(T));
-#endif
+  CopyPackedFixed(dst, ptr, num);
   ptr += block_size;
   if (size != block_size) return nullptr;
   return ptr;
@@ -1225,16 +1259,54 @@ const char* ReadPackedVarintArray(const char* ptr, const char* end, Add add) {
   return ptr;
 }
 
-template <typename Add, typename SizeCb>
-const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
-                                                 SizeCb size_callback) {
-  int size = ReadSize(&ptr);
-  size_callback(size);
+// Returns true if none of the 16 bytes at `ptr` has its continuation bit set,
+// i.e. they encode 16 single byte varints.
+inline bool AreSingleByteVarints16(const char* ptr) {
+  return ((UnalignedLoad<uint64_t>(ptr) | UnalignedLoad<uint64_t>(ptr + 8)) &
+          0x8080808080808080) == 0;
+}
+
+// Returns the number of bytes in [ptr, end) with a clear continuation bit.
+// Each of them terminates a varint, so for a packed run this is the number of
+// elements that end before `end`.
+PROTOBUF_EXPORT int CountVarintTerminators(const char* ptr, const char* end);
+
+template <typename T, typename Convert>
+const char* ReadPackedVarintArray(const char* ptr, const char* end,
+                                  RepeatedField<T>* out, Convert convert) {
+  if (ptr >= end) return ptr;
+  // Every varint starting before `end` either terminates before it or is the
+  // last one parsed, which bounds the number of elements added below.
+  const int max_elements = CountVarintTerminators(ptr, end) + 1;
+  const int old_size = out->size();
+  out->Reserve(old_size + max_elements);
+  T* const begin = out->AddNAlreadyReserved(max_elements);
+  T* dst = begin;
+  while (ptr < end) {
+    if (end - ptr >= 16 && AreSingleByteVarints16(ptr)) {
+      for (int i = 0; i < 16; ++i) {
+        dst[i] = convert(static_cast<uint8_t>(ptr[i]));
+      }
+      dst += 16;
+      ptr += 16;
+      continue;
+    }
+    uint64_t varint;
+    ptr = VarintParse(ptr, &varint);
+    if (ptr == nullptr) break;
+    *dst++ = convert(varint);
+  }
+  out->Truncate(old_size + static_cast<int>(dst - begin));
+  return ptr;
+}
+
+template <typename ParseArray>
+const char* EpsCopyInputStream::ReadPackedVarintChunks(
+    const char* ptr, int size, ParseArray parse_array) {
 
-  GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
   int chunk_size = static_cast<int>(buffer_end_ - ptr);
   while (size > chunk_size) {
-    ptr = ReadPackedVarintArray(ptr, buffer_end_, add);
+    ptr = parse_array(ptr, buffer_end_);
     if (ptr == nullptr) return nullptr;
     int overrun = static_cast<int>(ptr - buffer_end_);
     ABSL_DCHECK(overrun >= 0 && overrun <= kSlopBytes);
@@ -1246,7 +1318,7 @@ const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
       std::memcpy(buf, buffer_end_, kSlopBytes);
       ABSL_CHECK_LE(size - chunk_size, kSlopBytes);
       auto end = buf + (size - chunk_size);
-      auto res = ReadPackedVarintArray(buf + overrun, end, add);
+      auto res = parse_array(buf + overrun, end);
       if (res == nullptr || res != end) return nullptr;
       return buffer_end_ + (res - buf);
     }
@@ -1260,10 +1332,35 @@ const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
     chunk_size = static_cast<int>(buffer_end_ - ptr);
   }
   auto end = ptr + size;
-  ptr = ReadPackedVarintArray(ptr, end, add);
+  ptr = parse_array(ptr, end);
   return end == ptr ? ptr : nullptr;
 }
 
+template <typename Add, typename SizeCb>
+const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
+                                                 SizeCb size_callback) {
+  int size = ReadSize(&ptr);
+  size_callback(size);
+
+  GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+  return ReadPackedVarintChunks(
+      ptr, size, [add](const char* p, const char* end) {
+        return ReadPackedVarintArray(p, end, add);
+      });
+}
+
+template <typename T, typename Convert>
+const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr,
+                                                 RepeatedField<T>* out,
+                                                 Convert convert) {
+  int size = ReadSize(&ptr);
+  GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+  return ReadPackedVarintChunks(
+      ptr, size, [out, convert](const char* p, const char* end) {
+        return ReadPackedVarintArray(p, end, out, convert);
+      });
+}
+
 // Helper for verification of utf8
 PROTOBUF_EXPORT
 bool VerifyUTF8(absl::string_view s, const char* field_name);
@@ -2032,11 +2032,13 @@ void TextFormat::FastFieldValuePrinter::PrintUInt64(
 }
 void TextFormat::FastFieldValuePrinter::PrintFloat(
     float val, BaseTextGenerator* generator) const {
-  generator->PrintString(!std::isnan(val) ? io::SimpleFtoa(val) : "nan");
+  char buffer[io::kFloatToBufferSize];
+  generator->PrintString(io::FloatToBuffer(val, buffer));
 }
 void TextFormat::FastFieldValuePrinter::PrintDouble(
     double val, BaseTextGenerator* generator) const {
-  generator->PrintString(!std::isnan(val) ? io::SimpleDtoa(val) : "nan");
+  char buffer[io::kDoubleToBufferSize];
+  generator->PrintString(io::DoubleToBuffer(val, buffer));
 }
 void TextFormat::FastFieldValuePrinter::PrintEnum(
     int32_t /*val*/, const std::string& name,
@@ -62,6 +62,12 @@ class PROTOBUF_EXPORT ThreadSafeArena {
 
   uint64_t Reset();
 
+  // Same as Reset(), but keeps up to `max_retained_bytes` of the blocks it
+  // would free as spare blocks for later allocations. Adds the bytes kept and
+  // the bytes freed to `retained` and `released`.
+  uint64_t ResetRetainingCapacity(size_t max_retained_bytes,
+                                  uint64_t& retained, uint64_t& released);
+
   uint64_t SpaceAllocated() const;
   uint64_t SpaceUsed() const;
 
@@ -115,6 +121,12 @@ class PROTOBUF_EXPORT ThreadSafeArena {
 
   class SerialArenaChunk;
 
+  // Header written over a block kept by ResetRetainingCapacity().
+  struct SpareBlock {
+    SpareBlock* next;
+    size_t size;
+  };
+
   // Returns a new SerialArenaChunk that has {id, serial} at slot 0. It may
   // grow based on "prev_num_slots".
   static SerialArenaChunk* NewSerialArenaChunk(uint32_t prev_capacity, void* id,
@@ -147,6 +159,10 @@ class PROTOBUF_EXPORT ThreadSafeArena {
   // Pointer to a linked list of SerialArenaChunk.
   std::atomic<SerialArenaChunk*> head_{nullptr};
 
+  // Blocks kept by ResetRetainingCapacity() and not reused yet. Taking a block
+  // must be protected by mutex_.
+  std::atomic<SpareBlock*> spare_blocks_{nullptr};
+
   void* first_owner_;
   // Must be declared after alloc_policy_; otherwise, it may lose info on
   // user-provided initial block.
@@ -165,6 +181,9 @@ class PROTOBUF_EXPORT ThreadSafeArena {
   // Delete or Destruct all objects owned by the arena.
   void CleanupList();
 
+  // Reports the space used so far to the policy's ArenaSizeHint, if any.
+  void RecordSizeHint();
+
   inline void CacheSerialArena(SerialArena* serial) {
     thread_cache().last_serial_arena = serial;
     thread_cache().last_lifecycle_id_seen = tag_and_id_;
@@ -209,7 +228,28 @@ class PROTOBUF_EXPORT ThreadSafeArena {
   // Releases all memory except the first block which it returns. The first
   // block might be owned by the user and thus need some extra checks before
   // deleting.
-  SizedPtr Free();
+  SizedPtr Free() {
+    uint64_t retained = 0;
+    uint64_t released = 0;
+    return Free(0, retained, released);
+  }
+  // Same as above, but keeps up to `max_retained_bytes` of the memory as spare
+  // blocks. Adds the bytes kept and freed to `retained` and `released`.
+  SizedPtr Free(size_t max_retained_bytes, uint64_t& retained,
+                uint64_t& released);
+
+  // Pushes `mem` onto the spare block list. Not thread-safe.
+  void AddSpareBlock(SizedPtr mem);
+
+  // Returns a spare block of at least `min_size` bytes, or {nullptr, 0}.
+  SizedPtr AllocateSpareBlock(size_t min_size) {
+    if (PROTOBUF_PREDICT_TRUE(spare_blocks_.load(std::memory_order_relaxed) ==
+                              nullptr)) {
+      return {nullptr, 0};
+    }
+    return AllocateSpareBlockSlow(min_size);
+  }
+  SizedPtr AllocateSpareBlockSlow(size_t min_size);
 
   // ThreadCache is accessed very frequently, so we align it such that it's
   // located within a single cache line.
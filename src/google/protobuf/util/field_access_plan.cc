@@ -0,0 +1,359 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/field_access_plan.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/base/casts.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/protobuf/arenastring.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/generated_message_reflection.h"
+#include "google/protobuf/inlined_string_field.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/repeated_field.h"
+#include "google/protobuf/repeated_ptr_field.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+template <typename T>
+bool MatchesCppType(FieldDescriptor::CppType cpp_type) {
+  if constexpr (std::is_same<T, int32_t>::value) {
+    return cpp_type == FieldDescriptor::CPPTYPE_INT32 ||
+           cpp_type == FieldDescriptor::CPPTYPE_ENUM;
+  } else if constexpr (std::is_same<T, int64_t>::value) {
+    return cpp_type == FieldDescriptor::CPPTYPE_INT64;
+  } else if constexpr (std::is_same<T, uint32_t>::value) {
+    return cpp_type == FieldDescriptor::CPPTYPE_UINT32;
+  } else if constexpr (std::is_same<T, uint64_t>::value) {
+    return cpp_type == FieldDescriptor::CPPTYPE_UINT64;
+  } else if constexpr (std::is_same<T, float>::value) {
+    return cpp_type == FieldDescriptor::CPPTYPE_FLOAT;
+  } else if constexpr (std::is_same<T, double>::value) {
+    return cpp_type == FieldDescriptor::CPPTYPE_DOUBLE;
+  } else if constexpr (std::is_same<T, bool>::value) {
+    return cpp_type == FieldDescriptor::CPPTYPE_BOOL;
+  } else {
+    static_assert(std::is_same<T, absl::string_view>::value,
+                  "Unsupported value type.");
+    return cpp_type == FieldDescriptor::CPPTYPE_STRING;
+  }
+}
+
+template <typename T>
+T DefaultValue(const FieldDescriptor* field) {
+  if constexpr (std::is_same<T, int32_t>::value) {
+    return field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM
+               ? field->default_value_enum()->number()
+               : field->default_value_int32();
+  } else if constexpr (std::is_same<T, int64_t>::value) {
+    return field->default_value_int64();
+  } else if constexpr (std::is_same<T, uint32_t>::value) {
+    return field->default_value_uint32();
+  } else if constexpr (std::is_same<T, uint64_t>::value) {
+    return field->default_value_uint64();
+  } else if constexpr (std::is_same<T, float>::value) {
+    return field->default_value_float();
+  } else if constexpr (std::is_same<T, double>::value) {
+    return field->default_value_double();
+  } else if constexpr (std::is_same<T, bool>::value) {
+    return field->default_value_bool();
+  } else {
+    return field->default_value_string();
+  }
+}
+
+// Whether a field without presence tracking counts as set, which matches
+// Reflection::HasField(): floating point fields are compared bitwise, so that
+// -0.0 is set.
+template <typename T>
+bool IsNonDefault(T value) {
+  if constexpr (std::is_same<T, absl::string_view>::value) {
+    return !value.empty();
+  } else if constexpr (std::is_same<T, float>::value) {
+    return absl::bit_cast<uint32_t>(value) != 0;
+  } else if constexpr (std::is_same<T, double>::value) {
+    return absl::bit_cast<uint64_t>(value) != 0;
+  } else {
+    return value != T{};
+  }
+}
+
+}  // namespace
+
+absl::StatusOr<FieldAccessPlan> FieldAccessPlan::Create(
+    const Message& prototype, absl::Span<const std::string> paths) {
+  FieldAccessPlan plan(prototype.GetReflection());
+  plan.paths_.reserve(paths.size());
+  for (const std::string& path : paths) {
+    absl::StatusOr<Path> resolved = ResolvePath(prototype, path);
+    if (!resolved.ok()) return resolved.status();
+    plan.paths_.push_back(*std::move(resolved));
+  }
+  return plan;
+}
+
+const FieldDescriptor* FieldAccessPlan::field(int index) const {
+  return paths_[index].field;
+}
+
+absl::StatusOr<FieldAccessPlan::Path> FieldAccessPlan::ResolvePath(
+    const Message& prototype, const std::string& path) {
+  std::vector<absl::string_view> names = absl::StrSplit(path, '.');
+  Path result;
+  const Message* message = &prototype;
+  for (size_t i = 0; i < names.size(); ++i) {
+    const Descriptor* type = message->GetDescriptor();
+    const FieldDescriptor* field = type->FindFieldByName(names[i]);
+    if (field == nullptr) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Path \"", path, "\": ", type->full_name(), " has no field named \"",
+          names[i], "\"."));
+    }
+    if (field->options().weak()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Path \"", path, "\": ", field->full_name(), " is a weak field."));
+    }
+    bool last = i + 1 == names.size();
+    if (!last && (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE ||
+                  field->is_repeated())) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Path \"", path, "\": ", field->full_name(),
+                       " is not a singular message field."));
+    }
+    if (last && field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Path \"", path, "\": ", field->full_name(), " is a message field."));
+    }
+    if (last && field->cpp_type() == FieldDescriptor::CPPTYPE_STRING &&
+        field->cpp_string_type() == FieldDescriptor::CppStringType::kCord) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Path \"", path, "\": ", field->full_name(), " is a Cord field."));
+    }
+
+    const Reflection* reflection = message->GetReflection();
+    result.steps.push_back(MakeStep(reflection, field));
+    if (last) {
+      result.field = field;
+      result.inlined_string =
+          field->cpp_type() == FieldDescriptor::CPPTYPE_STRING &&
+          !field->is_repeated() && reflection->IsInlined(field);
+    } else {
+      message = result.steps.back().message_default;
+    }
+  }
+  return result;
+}
+
+FieldAccessPlan::Step FieldAccessPlan::MakeStep(const Reflection* reflection,
+                                                const FieldDescriptor* field) {
+  const internal::ReflectionSchema& schema = reflection->schema_;
+  Step step;
+  step.offset = schema.GetFieldOffset(field);
+  step.split_offset =
+      schema.IsSplit(field) ? static_cast<int32_t>(schema.SplitOffset()) : -1;
+  step.split_indirect = step.split_offset != -1 &&
+                        internal::SplitFieldHasExtraIndirection(field);
+  step.has_bit_index = schema.InRealOneof(field) ? static_cast<uint32_t>(-1)
+                                                 : schema.HasBitIndex(field);
+  step.has_bits_offset = step.has_bit_index == static_cast<uint32_t>(-1)
+                             ? -1
+                             : static_cast<int32_t>(schema.HasBitsOffset());
+  step.oneof_case_offset =
+      schema.InRealOneof(field)
+          ? static_cast<int32_t>(
+                schema.GetOneofCaseOffset(field->containing_oneof()))
+          : -1;
+  step.number = static_cast<uint32_t>(field->number());
+  step.owner_default = schema.default_instance_;
+  step.message_default =
+      field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE
+          ? &reflection->GetMessage(*schema.default_instance_, field)
+          : nullptr;
+  return step;
+}
+
+const void* FieldAccessPlan::FieldAddress(const Step& step,
+                                          const Message* message) {
+  const void* base = message;
+  if (step.split_offset != -1) {
+    base = *internal::GetConstPointerAtOffset<const void*>(
+        message, static_cast<uint32_t>(step.split_offset));
+  }
+  const void* address =
+      internal::GetConstPointerAtOffset<char>(base, step.offset);
+  if (step.split_indirect) {
+    address = *static_cast<const void* const*>(address);
+  }
+  return address;
+}
+
+bool FieldAccessPlan::HasBit(const Step& step, const Message* message) {
+  const uint32_t* has_bits = internal::GetConstPointerAtOffset<uint32_t>(
+      message, static_cast<uint32_t>(step.has_bits_offset));
+  return (has_bits[step.has_bit_index / 32] >> (step.has_bit_index % 32)) & 1;
+}
+
+const Message* FieldAccessPlan::FindLeafOwner(const Path& path,
+                                              const Message* message,
+                                              bool* present) {
+  for (size_t i = 0; i + 1 < path.steps.size(); ++i) {
+    const Step& step = path.steps[i];
+    const Message* next = nullptr;
+    if (step.oneof_case_offset != -1) {
+      if (internal::GetConstRefAtOffset<uint32_t>(
+              *message, static_cast<uint32_t>(step.oneof_case_offset)) ==
+          step.number) {
+        next = *static_cast<const Message* const*>(FieldAddress(step, message));
+      }
+    } else if (message != step.owner_default &&
+               (step.has_bits_offset == -1 || HasBit(step, message))) {
+      // Without a has-bit, a message field is set iff its pointer is non-null,
+      // except in the default instance, which may be cross-linked.
+      next = *static_cast<const Message* const*>(FieldAddress(step, message));
+    }
+    if (next == nullptr) {
+      *present = false;
+      next = step.message_default;
+    }
+    message = next;
+  }
+  return message;
+}
+
+template <typename T>
+T FieldAccessPlan::GetValue(const Path& path, const Message* owner,
+                            bool* present) {
+  const Step& step = path.steps.back();
+  if (step.oneof_case_offset != -1 &&
+      internal::GetConstRefAtOffset<uint32_t>(
+          *owner, static_cast<uint32_t>(step.oneof_case_offset)) !=
+          step.number) {
+    *present = false;
+    return DefaultValue<T>(path.field);
+  }
+
+  const void* address = FieldAddress(step, owner);
+  T value;
+  if constexpr (std::is_same<T, absl::string_view>::value) {
+    if (path.inlined_string) {
+      value = static_cast<const internal::InlinedStringField*>(address)
+                  ->GetNoArena();
+    } else {
+      const auto* str = static_cast<const internal::ArenaStringPtr*>(address);
+      value = str->IsDefault() ? path.field->default_value_string()
+                               : absl::string_view(str->Get());
+    }
+  } else {
+    value = *static_cast<const T*>(address);
+  }
+
+  if (step.oneof_case_offset != -1) return value;
+  if (step.has_bits_offset != -1) {
+    if (!HasBit(step, owner)) *present = false;
+  } else if (!IsNonDefault(value)) {
+    *present = false;
+  }
+  return value;
+}
+
+template <typename T>
+void FieldAccessPlan::Extract(int index,
+                              absl::Span<const Message* const> messages,
+                              absl::Span<T> values,
+                              absl::Span<bool> has) const {
+  const Path& path = paths_[index];
+  ABSL_CHECK(!path.field->is_repeated())
+      << path.field->full_name() << " is repeated; use ExtractRepeated().";
+  ABSL_CHECK(MatchesCppType<T>(path.field->cpp_type()))
+      << "Wrong value type for " << path.field->full_name() << ".";
+  ABSL_CHECK_GE(values.size(), messages.size());
+  ABSL_CHECK(has.empty() || has.size() >= messages.size());
+
+  for (size_t i = 0; i < messages.size(); ++i) {
+    ABSL_DCHECK_EQ(messages[i]->GetReflection(), reflection_);
+    bool present = true;
+    const Message* owner = FindLeafOwner(path, messages[i], &present);
+    values[i] = GetValue<T>(path, owner, &present);
+    if (!has.empty()) has[i] = present;
+  }
+}
+
+template <typename T>
+void FieldAccessPlan::ExtractRepeated(int index,
+                                      absl::Span<const Message* const> messages,
+                                      std::vector<T>* values,
+                                      std::vector<size_t>* ends) const {
+  const Path& path = paths_[index];
+  ABSL_CHECK(path.field->is_repeated())
+      << path.field->full_name() << " is not repeated; use Extract().";
+  ABSL_CHECK(MatchesCppType<T>(path.field->cpp_type()))
+      << "Wrong value type for " << path.field->full_name() << ".";
+
+  ends->reserve(ends->size() + messages.size());
+  for (const Message* message : messages) {
+    ABSL_DCHECK_EQ(message->GetReflection(), reflection_);
+    bool present = true;
+    const Message* owner = FindLeafOwner(path, message, &present);
+    if (present) {
+      const void* address = FieldAddress(path.steps.back(), owner);
+      if constexpr (std::is_same<T, absl::string_view>::value) {
+        const auto& field =
+            *static_cast<const RepeatedPtrField<std::string>*>(address);
+        for (const std::string& value : field) values->emplace_back(value);
+      } else {
+        const auto& field = *static_cast<const RepeatedField<T>*>(address);
+        values->insert(values->end(), field.begin(), field.end());
+      }
+    }
+    ends->push_back(values->size());
+  }
+}
+
+#define PROTOBUF_INSTANTIATE_FIELD_ACCESS(T)                                  \
+  template void FieldAccessPlan::Extract<T>(                                  \
+      int, absl::Span<const Message* const>, absl::Span<T>, absl::Span<bool>) \
+      const;                                                                  \
+  template void FieldAccessPlan::ExtractRepeated<T>(                          \
+      int, absl::Span<const Message* const>, std::vector<T>*,                 \
+      std::vector<size_t>*) const;
+
+PROTOBUF_INSTANTIATE_FIELD_ACCESS(int32_t)
+PROTOBUF_INSTANTIATE_FIELD_ACCESS(int64_t)
+PROTOBUF_INSTANTIATE_FIELD_ACCESS(uint32_t)
+PROTOBUF_INSTANTIATE_FIELD_ACCESS(uint64_t)
+PROTOBUF_INSTANTIATE_FIELD_ACCESS(float)
+PROTOBUF_INSTANTIATE_FIELD_ACCESS(double)
+PROTOBUF_INSTANTIATE_FIELD_ACCESS(bool)
+PROTOBUF_INSTANTIATE_FIELD_ACCESS(absl::string_view)
+
+#undef PROTOBUF_INSTANTIATE_FIELD_ACCESS
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
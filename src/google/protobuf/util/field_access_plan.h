@@ -0,0 +1,153 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Defines FieldAccessPlan, which reads a fixed set of fields out of many
+// messages of the same type without going through Reflection for each value.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_FIELD_ACCESS_PLAN_H__
+#define GOOGLE_PROTOBUF_UTIL_FIELD_ACCESS_PLAN_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+// A FieldAccessPlan resolves a list of field paths against a message type
+// once, recording where each field lives in the message's memory layout:
+// its offset, has-bit, oneof case and whether it is in the split struct.  It
+// then extracts the values of a path from a whole batch of messages in a
+// single loop, without the per-value checks, schema lookups and virtual calls
+// of going through Reflection.
+//
+// Example:
+//   absl::StatusOr<FieldAccessPlan> plan = FieldAccessPlan::Create(
+//       Event::default_instance(), {"user.id", "labels"});
+//   std::vector<int64_t> ids(events.size());
+//   plan->Extract<int64_t>(0, events, absl::MakeSpan(ids));
+//   std::vector<absl::string_view> labels;
+//   std::vector<size_t> ends;
+//   plan->ExtractRepeated<absl::string_view>(1, events, &labels, &ends);
+//
+// A plan is immutable once created, and may be used from several threads at
+// once.  It depends on the layout of the prototype's implementation, so it
+// must only be used with messages of the exact class of that prototype (for
+// example, not with a DynamicMessage of the same type when the prototype is
+// generated), and must not outlive the prototype.
+class PROTOBUF_EXPORT FieldAccessPlan {
+ public:
+  // Creates a plan for reading `paths` from messages with the same
+  // implementation as `prototype`.  Each path is a dot-separated list of field
+  // names, such as "user.address.zip".  Every field but the last must be a
+  // singular message field.  The last one may be a singular or repeated field
+  // of any type except message and Cord, which are not supported.  Returns an
+  // InvalidArgument error naming the path if any path does not meet these
+  // requirements.
+  static absl::StatusOr<FieldAccessPlan> Create(
+      const Message& prototype, absl::Span<const std::string> paths);
+
+  FieldAccessPlan(FieldAccessPlan&&) = default;
+  FieldAccessPlan& operator=(FieldAccessPlan&&) = default;
+
+  // The number of paths in the plan, in the order they were given to Create().
+  int path_count() const { return static_cast<int>(paths_.size()); }
+
+  // The last field of path `index`.
+  const FieldDescriptor* field(int index) const;
+
+  // For path `index`, whose last field must be singular, stores in
+  // `values[i]` the value of that field in `messages[i]`, which is its default
+  // if the field or any message field along the path is not set.  If `has` is
+  // not empty, `has[i]` is set to whether all fields along the path are set,
+  // as HasField() would report for each of them.  `values` and `has` must
+  // have room for all of `messages`.
+  //
+  // `T` must be the field's C++ type: int32_t (also used for enums), int64_t,
+  // uint32_t, uint64_t, float, double, bool, or absl::string_view for strings
+  // and bytes.  The string views point into the messages.
+  template <typename T>
+  void Extract(int index, absl::Span<const Message* const> messages,
+               absl::Span<T> values, absl::Span<bool> has = {}) const;
+
+  // For path `index`, whose last field must be repeated, appends the elements
+  // of that field in each of `messages` to `values`, and appends to `ends` the
+  // size of `values` after the elements of each message.  A message in which
+  // a message field along the path is not set contributes no elements.  `T`
+  // is as for Extract().
+  template <typename T>
+  void ExtractRepeated(int index, absl::Span<const Message* const> messages,
+                       std::vector<T>* values, std::vector<size_t>* ends) const;
+
+ private:
+  // Where one field along a path lives within the message holding it.
+  struct Step {
+    uint32_t offset;
+    // Offset of the pointer to the split struct holding the field, or -1 if
+    // the field is not split.
+    int32_t split_offset;
+    // Split repeated fields are stored behind a pointer.
+    bool split_indirect;
+    // Offset of the has-bits and the field's bit, or -1 if it has none.
+    int32_t has_bits_offset;
+    uint32_t has_bit_index;
+    // Offset of the case of the field's real oneof, or -1 if it has none.
+    int32_t oneof_case_offset;
+    uint32_t number;
+    // The default instance of the message holding the field.
+    const Message* owner_default;
+    // For message fields, the default instance of the field's type, read
+    // through when the field is not set.
+    const Message* message_default;
+  };
+
+  struct Path {
+    std::vector<Step> steps;
+    const FieldDescriptor* field;
+    bool inlined_string;
+  };
+
+  explicit FieldAccessPlan(const Reflection* reflection)
+      : reflection_(reflection) {}
+
+  static absl::StatusOr<Path> ResolvePath(const Message& prototype,
+                                          const std::string& path);
+  static Step MakeStep(const Reflection* reflection,
+                       const FieldDescriptor* field);
+
+  // Returns the message holding the last field of `path`, walking from
+  // `message` through the default instances of unset message fields.  Clears
+  // `*present` if any of those is not set.
+  static const Message* FindLeafOwner(const Path& path, const Message* message,
+                                      bool* present);
+  static const void* FieldAddress(const Step& step, const Message* message);
+  static bool HasBit(const Step& step, const Message* message);
+
+  template <typename T>
+  static T GetValue(const Path& path, const Message* owner, bool* present);
+
+  const Reflection* reflection_;
+  std::vector<Path> paths_;
+};
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_FIELD_ACCESS_PLAN_H__
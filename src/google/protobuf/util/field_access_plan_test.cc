@@ -0,0 +1,281 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/field_access_plan.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unittest_no_field_presence.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::NestedTestAllTypes;
+using ::protobuf_unittest::TestAllTypes;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+// Builds a set of messages covering set, unset and default fields, oneofs
+// and nested messages, as copies of `prototype`'s implementation.
+std::vector<std::unique_ptr<Message>> MakeMessages(const Message& prototype) {
+  std::vector<std::unique_ptr<Message>> messages;
+  for (int i = 0; i < 4; ++i) {
+    messages.emplace_back(prototype.New());
+  }
+
+  TestAllTypes all;
+  TestUtil::SetAllFields(&all);
+  messages[0]->ParseFromString(all.SerializeAsString());
+
+  TestAllTypes oneof;
+  oneof.mutable_oneof_nested_message()->set_bb(7);
+  oneof.mutable_optional_nested_message();
+  oneof.add_repeated_string("x");
+  messages[1]->ParseFromString(oneof.SerializeAsString());
+
+  TestAllTypes defaults;
+  defaults.set_default_int32(41);
+  defaults.set_oneof_string("");
+  messages[2]->ParseFromString(defaults.SerializeAsString());
+  return messages;
+}
+
+// Reads `path` from `message` one field at a time through Reflection.  `T` is
+// std::string for string fields.
+template <typename T>
+T ReadWithReflection(const Message& message, const std::string& path,
+                     bool* has) {
+  const Message* current = &message;
+  *has = true;
+  std::vector<std::string> names = absl::StrSplit(path, '.');
+  for (size_t i = 0; i + 1 < names.size(); ++i) {
+    const FieldDescriptor* field =
+        current->GetDescriptor()->FindFieldByName(names[i]);
+    *has = *has && current->GetReflection()->HasField(*current, field);
+    current = &current->GetReflection()->GetMessage(*current, field);
+  }
+  const Reflection* reflection = current->GetReflection();
+  const FieldDescriptor* field =
+      current->GetDescriptor()->FindFieldByName(names.back());
+  *has = *has && reflection->HasField(*current, field);
+  if constexpr (std::is_same<T, int32_t>::value) {
+    return field->cpp_type() == FieldDescriptor::CPPTYPE_ENUM
+               ? reflection->GetEnumValue(*current, field)
+               : reflection->GetInt32(*current, field);
+  } else if constexpr (std::is_same<T, int64_t>::value) {
+    return reflection->GetInt64(*current, field);
+  } else if constexpr (std::is_same<T, uint32_t>::value) {
+    return reflection->GetUInt32(*current, field);
+  } else if constexpr (std::is_same<T, double>::value) {
+    return reflection->GetDouble(*current, field);
+  } else if constexpr (std::is_same<T, bool>::value) {
+    return reflection->GetBool(*current, field);
+  } else {
+    return reflection->GetString(*current, field);
+  }
+}
+
+// Extracts path `index` of `plan` as `T`, and checks each value against
+// Reflection, which returns it as `Expected`.
+template <typename T, typename Expected = T>
+void ExpectMatchesReflection(const FieldAccessPlan& plan, int index,
+                             const std::string& path,
+                             absl::Span<const Message* const> messages) {
+  std::unique_ptr<T[]> values(new T[messages.size()]());
+  std::unique_ptr<bool[]> has(new bool[messages.size()]());
+  plan.Extract<T>(index, messages,
+                  absl::MakeSpan(values.get(), messages.size()),
+                  absl::MakeSpan(has.get(), messages.size()));
+  for (size_t i = 0; i < messages.size(); ++i) {
+    bool expected_has;
+    Expected expected_value =
+        ReadWithReflection<Expected>(*messages[i], path, &expected_has);
+    EXPECT_EQ(values[i], expected_value) << path << " in message " << i;
+    EXPECT_EQ(has[i], expected_has) << path << " in message " << i;
+  }
+}
+
+void ExpectPlanMatchesReflection(const Message& prototype) {
+  std::vector<std::unique_ptr<Message>> owned = MakeMessages(prototype);
+  std::vector<const Message*> messages;
+  for (const auto& message : owned) messages.push_back(message.get());
+  messages.push_back(&prototype);
+
+  const std::vector<std::string> paths = {"optional_int32",
+                                          "optional_int64",
+                                          "optional_uint32",
+                                          "optional_double",
+                                          "optional_bool",
+                                          "optional_nested_enum",
+                                          "default_int32",
+                                          "default_int64",
+                                          "optional_string",
+                                          "optional_bytes",
+                                          "default_string",
+                                          "optional_string_piece",
+                                          "oneof_uint32",
+                                          "oneof_string",
+                                          "oneof_nested_message.bb",
+                                          "optional_nested_message.bb",
+                                          "optional_lazy_message.bb"};
+  absl::StatusOr<FieldAccessPlan> plan =
+      FieldAccessPlan::Create(prototype, paths);
+  ASSERT_TRUE(plan.ok()) << plan.status();
+  ASSERT_EQ(plan->path_count(), static_cast<int>(paths.size()));
+
+  for (int i = 0; i < plan->path_count(); ++i) {
+    switch (plan->field(i)->cpp_type()) {
+      case FieldDescriptor::CPPTYPE_INT32:
+      case FieldDescriptor::CPPTYPE_ENUM:
+        ExpectMatchesReflection<int32_t>(*plan, i, paths[i], messages);
+        break;
+      case FieldDescriptor::CPPTYPE_INT64:
+        ExpectMatchesReflection<int64_t>(*plan, i, paths[i], messages);
+        break;
+      case FieldDescriptor::CPPTYPE_UINT32:
+        ExpectMatchesReflection<uint32_t>(*plan, i, paths[i], messages);
+        break;
+      case FieldDescriptor::CPPTYPE_DOUBLE:
+        ExpectMatchesReflection<double>(*plan, i, paths[i], messages);
+        break;
+      case FieldDescriptor::CPPTYPE_BOOL:
+        ExpectMatchesReflection<bool>(*plan, i, paths[i], messages);
+        break;
+      case FieldDescriptor::CPPTYPE_STRING:
+        ExpectMatchesReflection<absl::string_view, std::string>(
+            *plan, i, paths[i], messages);
+        break;
+      default:
+        ADD_FAILURE() << "Unexpected type for " << paths[i];
+    }
+  }
+}
+
+TEST(FieldAccessPlanTest, GeneratedMatchesReflection) {
+  ExpectPlanMatchesReflection(TestAllTypes::default_instance());
+}
+
+TEST(FieldAccessPlanTest, DynamicMatchesReflection) {
+  DynamicMessageFactory factory;
+  ExpectPlanMatchesReflection(
+      *factory.GetPrototype(TestAllTypes::descriptor()));
+}
+
+TEST(FieldAccessPlanTest, NoFieldPresence) {
+  using ::proto2_nofieldpresence_unittest::TestAllTypes;
+  TestAllTypes set;
+  set.set_optional_int32(5);
+  set.set_optional_double(-0.0);
+  set.mutable_optional_nested_message()->set_bb(3);
+  TestAllTypes empty;
+  std::vector<const Message*> messages = {&set, &empty};
+
+  absl::StatusOr<FieldAccessPlan> plan = FieldAccessPlan::Create(
+      TestAllTypes::default_instance(),
+      {"optional_int32", "optional_double", "optional_nested_message.bb"});
+  ASSERT_TRUE(plan.ok()) << plan.status();
+
+  std::vector<int32_t> ints(2);
+  bool has[2];
+  plan->Extract<int32_t>(0, messages, absl::MakeSpan(ints), has);
+  EXPECT_THAT(ints, ElementsAre(5, 0));
+  EXPECT_TRUE(has[0]);
+  EXPECT_FALSE(has[1]);
+
+  std::vector<double> doubles(2);
+  plan->Extract<double>(1, messages, absl::MakeSpan(doubles), has);
+  EXPECT_TRUE(has[0]);
+  EXPECT_FALSE(has[1]);
+
+  plan->Extract<int32_t>(2, messages, absl::MakeSpan(ints), has);
+  EXPECT_THAT(ints, ElementsAre(3, 0));
+  EXPECT_TRUE(has[0]);
+  EXPECT_FALSE(has[1]);
+}
+
+TEST(FieldAccessPlanTest, Repeated) {
+  NestedTestAllTypes first;
+  first.mutable_payload()->add_repeated_int32(1);
+  first.mutable_payload()->add_repeated_int32(2);
+  first.mutable_payload()->add_repeated_string("a");
+  NestedTestAllTypes second;
+  NestedTestAllTypes third;
+  third.mutable_child()->mutable_payload()->add_repeated_int32(3);
+  third.mutable_payload()->add_repeated_string("b");
+  third.mutable_payload()->add_repeated_string("c");
+  std::vector<const Message*> messages = {&first, &second, &third};
+
+  absl::StatusOr<FieldAccessPlan> plan = FieldAccessPlan::Create(
+      NestedTestAllTypes::default_instance(),
+      {"payload.repeated_int32", "payload.repeated_string",
+       "child.payload.repeated_int32"});
+  ASSERT_TRUE(plan.ok()) << plan.status();
+
+  std::vector<int32_t> ints;
+  std::vector<size_t> ends;
+  plan->ExtractRepeated<int32_t>(0, messages, &ints, &ends);
+  EXPECT_THAT(ints, ElementsAre(1, 2));
+  EXPECT_THAT(ends, ElementsAre(2, 2, 2));
+
+  std::vector<absl::string_view> strings;
+  ends.clear();
+  plan->ExtractRepeated<absl::string_view>(1, messages, &strings, &ends);
+  EXPECT_THAT(strings, ElementsAre("a", "b", "c"));
+  EXPECT_THAT(ends, ElementsAre(1, 1, 3));
+
+  ints.clear();
+  ends.clear();
+  plan->ExtractRepeated<int32_t>(2, messages, &ints, &ends);
+  EXPECT_THAT(ints, ElementsAre(3));
+  EXPECT_THAT(ends, ElementsAre(0, 0, 1));
+}
+
+TEST(FieldAccessPlanTest, InvalidPaths) {
+  const Message& prototype = NestedTestAllTypes::default_instance();
+  struct {
+    std::string path;
+    const char* error;
+  } cases[] = {
+      {"payload.no_such_field", "has no field named \"no_such_field\""},
+      {"payload.optional_int32.x", "is not a singular message field"},
+      {"repeated_child.payload.optional_int32",
+       "is not a singular message field"},
+      {"payload.optional_nested_message", "is a message field"},
+      {"payload.optional_bytes_cord", "is a Cord field"},
+  };
+  for (const auto& c : cases) {
+    absl::StatusOr<FieldAccessPlan> plan =
+        FieldAccessPlan::Create(prototype, {c.path});
+    EXPECT_EQ(plan.status().code(), absl::StatusCode::kInvalidArgument)
+        << c.path;
+    EXPECT_THAT(plan.status().message(), HasSubstr(c.error)) << c.path;
+  }
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,294 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/parallel_message_util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/strings/internal/resize_uninitialized.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/unknown_field_set.h"
+#include "google/protobuf/wire_format.h"
+#include "google/protobuf/wire_format_lite.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+namespace {
+
+using internal::WireFormat;
+using internal::WireFormatLite;
+
+// Splits `data` into the payloads of the top-level occurrences of `field`,
+// appended to `elements`, and the encoding of everything else, appended to
+// `rest`.  Returns false if `data` is not a sequence of well-formed fields.
+bool ScanTopLevelFields(const FieldDescriptor* field, absl::string_view data,
+                        std::vector<absl::string_view>* elements,
+                        std::string* rest) {
+  // CodedInputStream positions are ints.
+  if (data.size() > static_cast<size_t>(INT_MAX)) return false;
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(data.data()),
+                             static_cast<int>(data.size()));
+  const uint32_t element_tag = WireFormatLite::MakeTag(
+      field->number(), WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  while (!input.ExpectAtEnd()) {
+    const int start = input.CurrentPosition();
+    const uint32_t tag = input.ReadTag();
+    if (tag == 0) return false;
+    if (tag == element_tag) {
+      uint32_t length;
+      if (!input.ReadVarint32(&length)) return false;
+      const int offset = input.CurrentPosition();
+      if (length > static_cast<uint32_t>(INT_MAX) ||
+          !input.Skip(static_cast<int>(length))) {
+        return false;
+      }
+      elements->push_back(data.substr(offset, length));
+    } else {
+      if (!WireFormatLite::SkipField(&input, tag)) return false;
+      rest->append(data.data() + start, input.CurrentPosition() - start);
+    }
+  }
+  return true;
+}
+
+// Returns the start of each of at most `num_tasks` contiguous ranges of
+// [0, count) with roughly the same total `weight`, followed by `count`.
+std::vector<size_t> SplitByWeight(size_t count, int num_tasks,
+                                  absl::FunctionRef<size_t(size_t)> weight) {
+  if (count == 0) return {0};
+  size_t total_weight = 0;
+  for (size_t i = 0; i < count; ++i) total_weight += weight(i);
+  const size_t weight_per_task =
+      std::max<size_t>(1, total_weight / static_cast<size_t>(num_tasks));
+
+  std::vector<size_t> bounds = {0};
+  size_t task_weight = 0;
+  for (size_t i = 0; i < count; ++i) {
+    task_weight += weight(i);
+    if (task_weight >= weight_per_task && i + 1 < count &&
+        bounds.size() < static_cast<size_t>(num_tasks)) {
+      bounds.push_back(i + 1);
+      task_weight = 0;
+    }
+  }
+  bounds.push_back(count);
+  return bounds;
+}
+
+// Hands `task` for each range of `bounds` to `executor`, then runs
+// `on_caller` on the calling thread and waits for all tasks to finish.
+void RunInParallel(const std::vector<size_t>& bounds,
+                   ParallelExecutor executor,
+                   absl::FunctionRef<void(size_t begin, size_t end)> task,
+                   absl::FunctionRef<void()> on_caller) {
+  absl::BlockingCounter pending(static_cast<int>(bounds.size() - 1));
+  for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+    const size_t begin = bounds[i];
+    const size_t end = bounds[i + 1];
+    executor([&, begin, end] {
+      task(begin, end);
+      pending.DecrementCount();
+    });
+  }
+  on_caller();
+  pending.Wait();
+}
+
+void CheckRepeatedMessageField(const Descriptor* descriptor,
+                               const FieldDescriptor* field, int num_tasks) {
+  ABSL_CHECK_EQ(field->containing_type(), descriptor);
+  ABSL_CHECK(field->is_repeated() && !field->is_map() &&
+             field->type() == FieldDescriptor::TYPE_MESSAGE)
+      << field->full_name() << " is not a repeated message field.";
+  ABSL_CHECK_GT(num_tasks, 0);
+}
+
+}  // namespace
+
+bool ParseRepeatedFieldInParallel(Message* message,
+                                  const FieldDescriptor* field,
+                                  absl::string_view data, int num_tasks,
+                                  ParallelExecutor executor) {
+  CheckRepeatedMessageField(message->GetDescriptor(), field, num_tasks);
+
+  message->Clear();
+  std::vector<absl::string_view> elements;
+  std::string rest;
+  if (!ScanTopLevelFields(field, data, &elements, &rest)) return false;
+
+  Arena* const arena = message->GetArena();
+  const Reflection* const reflection = message->GetReflection();
+  const Message* const prototype =
+      reflection->GetMessageFactory()->GetPrototype(field->message_type());
+  std::vector<Message*> parsed(elements.size(), nullptr);
+  std::atomic<bool> failed{false};
+  bool rest_ok = true;
+
+  RunInParallel(
+      SplitByWeight(elements.size(), num_tasks,
+                    [&](size_t i) { return elements[i].size(); }),
+      executor,
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin;
+             i < end && !failed.load(std::memory_order_relaxed); ++i) {
+          parsed[i] = prototype->New(arena);
+          if (!parsed[i]->ParsePartialFromString(elements[i])) {
+            failed.store(true, std::memory_order_relaxed);
+          }
+        }
+      },
+      // The remaining fields cannot contain elements of `field`, so the
+      // elements are appended to an empty field.
+      [&] { rest_ok = rest.empty() || message->ParsePartialFromString(rest); });
+
+  if (!rest_ok || failed.load(std::memory_order_relaxed)) {
+    if (arena == nullptr) {
+      for (Message* element : parsed) delete element;
+    }
+    return false;
+  }
+  for (Message* element : parsed) {
+    reflection->AddAllocatedMessage(message, field, element);
+  }
+  return message->IsInitialized();
+}
+
+bool SerializeRepeatedFieldInParallel(const Message& message,
+                                      const FieldDescriptor* field,
+                                      int num_tasks, ParallelExecutor executor,
+                                      std::string* output) {
+  CheckRepeatedMessageField(message.GetDescriptor(), field, num_tasks);
+  ABSL_CHECK(!message.GetDescriptor()->options().message_set_wire_format());
+  ABSL_DCHECK(message.IsInitialized())
+      << "Can't serialize message of type \"" << message.GetTypeName()
+      << "\" because it is missing required fields: "
+      << message.InitializationErrorString();
+
+  // Like WireFormat::_InternalSerialize(), write the set fields in field
+  // number order followed by the unknown fields. The fields numbered below
+  // `field` form the head and the others, with the unknown fields, the tail.
+  const Reflection* const reflection = message.GetReflection();
+  std::vector<const FieldDescriptor*> fields;
+  reflection->ListFields(message, &fields);
+  fields.erase(std::remove(fields.begin(), fields.end(), field), fields.end());
+  const auto tail_begin = std::find_if(
+      fields.begin(), fields.end(), [field](const FieldDescriptor* f) {
+        return f->number() > field->number();
+      });
+  const UnknownFieldSet& unknown_fields = reflection->GetUnknownFields(message);
+
+  const auto element = [&](size_t i) -> const Message& {
+    return reflection->GetRepeatedMessage(message, field, static_cast<int>(i));
+  };
+
+  // Computing the sizes caches them in every submessage.
+  const size_t num_elements =
+      static_cast<size_t>(reflection->FieldSize(message, field));
+  const size_t tag_size =
+      WireFormatLite::TagSize(field->number(), WireFormatLite::TYPE_MESSAGE);
+  std::vector<size_t> element_sizes(num_elements);
+  size_t head_size = 0;
+  size_t tail_size = 0;
+  RunInParallel(
+      SplitByWeight(num_elements, num_tasks, [](size_t) { return 1; }),
+      executor,
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          element_sizes[i] = element(i).ByteSizeLong();
+        }
+      },
+      [&] {
+        for (auto it = fields.begin(); it != tail_begin; ++it) {
+          head_size += WireFormat::FieldByteSize(*it, message);
+        }
+        for (auto it = tail_begin; it != fields.end(); ++it) {
+          tail_size += WireFormat::FieldByteSize(*it, message);
+        }
+        tail_size += WireFormat::ComputeUnknownFieldsSize(unknown_fields);
+      });
+
+  // offsets[i] is where element i starts relative to the first element.
+  std::vector<size_t> offsets(num_elements + 1, 0);
+  for (size_t i = 0; i < num_elements; ++i) {
+    offsets[i + 1] = offsets[i] + tag_size +
+                     WireFormatLite::LengthDelimitedSize(element_sizes[i]);
+  }
+  const size_t byte_size = head_size + offsets[num_elements] + tail_size;
+  if (byte_size > INT_MAX) {
+    ABSL_LOG(ERROR) << message.GetTypeName()
+                    << " exceeded maximum protobuf size of 2GB: " << byte_size;
+    return false;
+  }
+
+  absl::strings_internal::STLStringResizeUninitialized(output, byte_size);
+  uint8_t* const start =
+      reinterpret_cast<uint8_t*>(io::mutable_string_data(output));
+  uint8_t* const elements_start = start + head_size;
+  const bool deterministic =
+      io::CodedOutputStream::IsDefaultSerializationDeterministic();
+  // Each range is written through its own stream over its exact slice of the
+  // output, so the tasks never touch each other's bytes.
+  RunInParallel(
+      SplitByWeight(num_elements, num_tasks,
+                    [&](size_t i) { return offsets[i + 1] - offsets[i]; }),
+      executor,
+      [&](size_t begin, size_t end) {
+        uint8_t* target = elements_start + offsets[begin];
+        io::EpsCopyOutputStream stream(
+            target, static_cast<int>(offsets[end] - offsets[begin]),
+            deterministic);
+        for (size_t i = begin; i < end; ++i) {
+          target = WireFormatLite::InternalWriteMessage(
+              field->number(), element(i), static_cast<int>(element_sizes[i]),
+              target, &stream);
+        }
+        ABSL_DCHECK(target == elements_start + offsets[end]);
+      },
+      [&] {
+        uint8_t* target = start;
+        io::EpsCopyOutputStream head(target, static_cast<int>(head_size),
+                                     deterministic);
+        for (auto it = fields.begin(); it != tail_begin; ++it) {
+          target = WireFormat::InternalSerializeField(*it, message, target,
+                                                      &head);
+        }
+        ABSL_DCHECK(target == elements_start);
+
+        target = elements_start + offsets[num_elements];
+        io::EpsCopyOutputStream tail(target, static_cast<int>(tail_size),
+                                     deterministic);
+        for (auto it = tail_begin; it != fields.end(); ++it) {
+          target = WireFormat::InternalSerializeField(*it, message, target,
+                                                      &tail);
+        }
+        target = WireFormat::InternalSerializeUnknownFieldsToArray(
+            unknown_fields, target, &tail);
+        ABSL_DCHECK(target == start + byte_size);
+      });
+  return true;
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,80 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Utilities for parsing and serializing messages whose bulk is a single large
+// repeated message field, such as a batch of records, using several threads.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_PARALLEL_MESSAGE_UTIL_H__
+#define GOOGLE_PROTOBUF_UTIL_PARALLEL_MESSAGE_UTIL_H__
+
+#include <functional>
+#include <string>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+// Runs `task`, possibly on another thread. The task must eventually run;
+// it may also run inline before the executor returns.
+using ParallelExecutor = absl::FunctionRef<void(std::function<void()> task)>;
+
+// Parses `data` into `message` like Message::ParseFromArray(), but parses the
+// elements of the repeated message field `field` concurrently.
+//
+// The buffer is first scanned for the top-level occurrences of `field`. Their
+// elements are then split into at most `num_tasks` contiguous ranges of
+// roughly equal size, and each range is parsed by a task handed to
+// `executor`. This call blocks until all tasks have finished. All other
+// fields are parsed on the calling thread.
+//
+// When `message` is on an arena, the elements are allocated on that arena
+// from the worker threads, each of which uses its own block of the arena.
+// Either way the elements are spliced into the field without being copied.
+//
+// `field` must be a repeated, non-map field of message type belonging to
+// `message`'s type. Returns false, leaving `message` in an unspecified but
+// valid state, if `data` is malformed or required fields are missing.
+bool PROTOBUF_EXPORT ParseRepeatedFieldInParallel(Message* message,
+                                                  const FieldDescriptor* field,
+                                                  absl::string_view data,
+                                                  int num_tasks,
+                                                  ParallelExecutor executor);
+
+// Serializes `message` to `output` like Message::SerializeToString(), but
+// sizes and writes the elements of the repeated message field `field`
+// concurrently.
+//
+// The elements are first split into at most `num_tasks` contiguous ranges
+// whose sizes are computed by tasks handed to `executor`. The sizes give the
+// exact offset of every element in the output, which is then allocated once.
+// The ranges are then written by a second round of tasks, each through its
+// own stream over its slice of the output. All other fields are sized and
+// written on the calling thread. This call blocks until all tasks have
+// finished. The output is identical to that of the serial serializer.
+//
+// `field` must be a repeated, non-map field of message type belonging to
+// `message`'s type, and `message` must not use the MessageSet wire format.
+// Returns false if the serialized message would exceed 2GB.
+bool PROTOBUF_EXPORT SerializeRepeatedFieldInParallel(
+    const Message& message, const FieldDescriptor* field, int num_tasks,
+    ParallelExecutor executor, std::string* output);
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_PARALLEL_MESSAGE_UTIL_H__
@@ -0,0 +1,215 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/parallel_message_util.h"
+
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+
+// Runs each task on its own thread; the threads are joined on destruction.
+class ThreadExecutor {
+ public:
+  ~ThreadExecutor() {
+    for (auto& thread : threads_) thread.join();
+  }
+
+  // ParallelExecutor invokes the executor through a const reference.
+  void operator()(std::function<void()> task) const {
+    threads_.emplace_back(std::move(task));
+  }
+
+ private:
+  mutable std::vector<std::thread> threads_;
+};
+
+TestAllTypes MakeRecords(int num_records) {
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  for (int i = 0; i < num_records; ++i) {
+    message.add_repeated_nested_message()->set_bb(i);
+  }
+  return message;
+}
+
+const FieldDescriptor* RecordsField() {
+  return TestAllTypes::descriptor()->FindFieldByName(
+      "repeated_nested_message");
+}
+
+TEST(ParallelMessageUtilTest, ParsesLikeParseFromString) {
+  const TestAllTypes expected = MakeRecords(10000);
+  const std::string data = expected.SerializeAsString();
+
+  for (int num_tasks : {1, 3, 8, 64}) {
+    TestAllTypes message;
+    {
+      ThreadExecutor executor;
+      EXPECT_TRUE(ParseRepeatedFieldInParallel(&message, RecordsField(), data,
+                                               num_tasks, executor));
+    }
+    EXPECT_EQ(message.SerializeAsString(), data) << num_tasks;
+  }
+}
+
+TEST(ParallelMessageUtilTest, ParsesOnArena) {
+  const std::string data = MakeRecords(1000).SerializeAsString();
+
+  Arena arena;
+  auto* message = Arena::Create<TestAllTypes>(&arena);
+  ThreadExecutor executor;
+  EXPECT_TRUE(
+      ParseRepeatedFieldInParallel(message, RecordsField(), data, 4, executor));
+  ASSERT_EQ(message->repeated_nested_message_size(), 1002);
+  for (const auto& record : message->repeated_nested_message()) {
+    EXPECT_EQ(record.GetArena(), &arena);
+  }
+  EXPECT_EQ(message->SerializeAsString(), data);
+}
+
+TEST(ParallelMessageUtilTest, InlineExecutor) {
+  const std::string data = MakeRecords(100).SerializeAsString();
+
+  // More tasks than records.
+  TestAllTypes message;
+  EXPECT_TRUE(ParseRepeatedFieldInParallel(
+      &message, RecordsField(), data, 1000,
+      [](std::function<void()> task) { task(); }));
+  EXPECT_EQ(message.SerializeAsString(), data);
+}
+
+TEST(ParallelMessageUtilTest, NoRecords) {
+  TestAllTypes expected;
+  TestUtil::SetAllFields(&expected);
+  expected.clear_repeated_nested_message();
+  const std::string data = expected.SerializeAsString();
+
+  TestAllTypes message;
+  EXPECT_TRUE(ParseRepeatedFieldInParallel(
+      &message, RecordsField(), data, 4,
+      [](std::function<void()> task) { task(); }));
+  EXPECT_EQ(message.SerializeAsString(), data);
+}
+
+TEST(ParallelMessageUtilTest, MalformedInput) {
+  const std::string data = MakeRecords(100).SerializeAsString();
+
+  TestAllTypes message;
+  ThreadExecutor executor;
+  EXPECT_FALSE(ParseRepeatedFieldInParallel(
+      &message, RecordsField(), data.substr(0, data.size() - 1), 4, executor));
+  // A record that is not a valid NestedMessage.
+  EXPECT_FALSE(ParseRepeatedFieldInParallel(
+      &message, RecordsField(), absl::string_view("\202\003\002\010\200", 5),
+      4, executor));
+}
+
+TEST(ParallelMessageUtilTest, MissingRequiredFields) {
+  protobuf_unittest::TestRequiredForeign expected;
+  for (int i = 0; i < 10; ++i) {
+    auto* record = expected.add_repeated_message();
+    record->set_a(i);
+    record->set_b(i);
+    record->set_c(i);
+  }
+  expected.mutable_repeated_message(7)->clear_b();
+  const std::string data = expected.SerializePartialAsString();
+  const FieldDescriptor* field =
+      protobuf_unittest::TestRequiredForeign::descriptor()->FindFieldByName(
+          "repeated_message");
+
+  protobuf_unittest::TestRequiredForeign message;
+  ThreadExecutor executor;
+  EXPECT_FALSE(
+      ParseRepeatedFieldInParallel(&message, field, data, 4, executor));
+}
+
+TEST(ParallelMessageUtilTest, SerializesLikeSerializeToString) {
+  TestAllTypes message = MakeRecords(10000);
+  message.GetReflection()->MutableUnknownFields(&message)->AddVarint(123456,
+                                                                      7);
+  const std::string expected = message.SerializeAsString();
+
+  for (int num_tasks : {1, 3, 8, 64}) {
+    std::string output;
+    {
+      ThreadExecutor executor;
+      EXPECT_TRUE(SerializeRepeatedFieldInParallel(message, RecordsField(),
+                                                   num_tasks, executor,
+                                                   &output));
+    }
+    EXPECT_EQ(output, expected) << num_tasks;
+  }
+}
+
+TEST(ParallelMessageUtilTest, SerializesWithoutRecords) {
+  TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  message.clear_repeated_nested_message();
+
+  std::string output;
+  EXPECT_TRUE(SerializeRepeatedFieldInParallel(
+      message, RecordsField(), 4, [](std::function<void()> task) { task(); },
+      &output));
+  EXPECT_EQ(output, message.SerializeAsString());
+}
+
+TEST(ParallelMessageUtilTest, SerializesExtensions) {
+  protobuf_unittest::TestAllExtensions message;
+  TestUtil::SetAllExtensions(&message);
+  for (int i = 0; i < 1000; ++i) {
+    message.AddExtension(protobuf_unittest::repeated_nested_message_extension)
+        ->set_bb(i);
+  }
+  const FieldDescriptor* field =
+      protobuf_unittest::repeated_nested_message_extension.descriptor();
+
+  std::string output;
+  {
+    ThreadExecutor executor;
+    EXPECT_TRUE(
+        SerializeRepeatedFieldInParallel(message, field, 4, executor, &output));
+  }
+  EXPECT_EQ(output, message.SerializeAsString());
+}
+
+TEST(ParallelMessageUtilTest, RoundTrip) {
+  const TestAllTypes expected = MakeRecords(1000);
+
+  std::string data;
+  TestAllTypes message;
+  {
+    ThreadExecutor executor;
+    EXPECT_TRUE(SerializeRepeatedFieldInParallel(expected, RecordsField(), 4,
+                                                 executor, &data));
+    EXPECT_TRUE(
+        ParseRepeatedFieldInParallel(&message, RecordsField(), data, 4,
+                                     executor));
+  }
+  EXPECT_EQ(message.SerializeAsString(), expected.SerializeAsString());
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
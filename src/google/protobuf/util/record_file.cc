@@ -0,0 +1,405 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/record_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/crc/crc32c.h"
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "absl/strings/internal/resize_uninitialized.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/message_lite.h"
+
+#if HAVE_ZLIB
+#include "google/protobuf/io/gzip_stream.h"
+#endif  // HAVE_ZLIB
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+namespace {
+
+// "PBRF" in little-endian order.
+constexpr uint32_t kMagic = 0x46524250;
+constexpr int kDefaultBlockSize = 64 * 1024;
+constexpr int kMaxVarint32Bytes = 5;
+constexpr size_t kBlockHeaderSize = 4 + 4 + 4 + 1;
+constexpr size_t kIndexEntrySize = 8 + 8;
+constexpr size_t kFooterSize = 8 + 8 + 4 + 4;
+
+uint32_t Crc32c(absl::string_view data) {
+  return static_cast<uint32_t>(absl::ComputeCrc32c(data));
+}
+
+const uint8_t* AsBytes(const char* data) {
+  return reinterpret_cast<const uint8_t*>(data);
+}
+
+uint32_t ReadFixed32(const char* data) {
+  uint32_t value;
+  io::CodedInputStream::ReadLittleEndian32FromArray(AsBytes(data), &value);
+  return value;
+}
+
+uint64_t ReadFixed64(const char* data) {
+  uint64_t value;
+  io::CodedInputStream::ReadLittleEndian64FromArray(AsBytes(data), &value);
+  return value;
+}
+
+void AppendFixed32(uint32_t value, std::string* output) {
+  uint8_t buffer[4];
+  io::CodedOutputStream::WriteLittleEndian32ToArray(value, buffer);
+  output->append(reinterpret_cast<const char*>(buffer), sizeof(buffer));
+}
+
+void AppendFixed64(uint64_t value, std::string* output) {
+  uint8_t buffer[8];
+  io::CodedOutputStream::WriteLittleEndian64ToArray(value, buffer);
+  output->append(reinterpret_cast<const char*>(buffer), sizeof(buffer));
+}
+
+}  // namespace
+
+// ===================================================================
+
+RecordFileWriter::Options::Options()
+    : block_size(kDefaultBlockSize), compression(NONE) {}
+
+RecordFileWriter::RecordFileWriter(io::ZeroCopyOutputStream* output)
+    : RecordFileWriter(output, Options()) {}
+
+RecordFileWriter::RecordFileWriter(io::ZeroCopyOutputStream* output,
+                                   const Options& options)
+    : output_(output), options_(options) {
+  ABSL_CHECK_GT(options.block_size, 0);
+#if !HAVE_ZLIB
+  ABSL_CHECK_EQ(options.compression, NONE)
+      << "ZLIB compression requires protobuf to be built with zlib.";
+#endif  // !HAVE_ZLIB
+}
+
+RecordFileWriter::~RecordFileWriter() {
+  if (!closed_) Close();
+}
+
+bool RecordFileWriter::Write(const MessageLite& message) {
+  const size_t size = message.ByteSizeLong();
+  if (size > static_cast<size_t>(INT_MAX - kMaxVarint32Bytes)) return false;
+  return AppendRecord(size, [&message](uint8_t* target) {
+    message.SerializeWithCachedSizesToArray(target);
+  });
+}
+
+bool RecordFileWriter::WriteSerialized(absl::string_view record) {
+  if (record.size() > static_cast<size_t>(INT_MAX - kMaxVarint32Bytes)) {
+    return false;
+  }
+  return AppendRecord(record.size(), [record](uint8_t* target) {
+    memcpy(target, record.data(), record.size());
+  });
+}
+
+bool RecordFileWriter::AppendRecord(size_t size,
+                                    absl::FunctionRef<void(uint8_t*)> write) {
+  ABSL_CHECK(!closed_) << "RecordFileWriter is closed.";
+  if (failed_) return false;
+  // Keep blocks below 2GB so that readers can use CodedInputStream on them.
+  if (block_.size() > static_cast<size_t>(INT_MAX) - kMaxVarint32Bytes - size &&
+      !WriteBlock()) {
+    return false;
+  }
+
+  const size_t start = block_.size();
+  absl::strings_internal::STLStringResizeUninitialized(
+      &block_, start + kMaxVarint32Bytes + size);
+  uint8_t* target = reinterpret_cast<uint8_t*>(&block_[start]);
+  target = io::CodedOutputStream::WriteVarint32ToArray(
+      static_cast<uint32_t>(size), target);
+  write(target);
+  block_.resize(reinterpret_cast<char*>(target + size) - block_.data());
+  ++num_records_;
+
+  if (block_.size() >= static_cast<size_t>(options_.block_size)) {
+    return WriteBlock();
+  }
+  return true;
+}
+
+bool RecordFileWriter::WriteBlock() {
+  if (block_.empty()) return true;
+
+  std::string compressed;
+  absl::string_view payload = block_;
+  if (options_.compression == ZLIB) {
+#if HAVE_ZLIB
+    io::StringOutputStream string_output(&compressed);
+    io::GzipOutputStream::Options gzip_options;
+    gzip_options.format = io::GzipOutputStream::ZLIB;
+    io::GzipOutputStream gzip_output(&string_output, gzip_options);
+    {
+      io::CodedOutputStream coded_output(&gzip_output);
+      coded_output.WriteRaw(block_.data(), static_cast<int>(block_.size()));
+    }
+    if (!gzip_output.Close() || compressed.size() > INT_MAX) {
+      failed_ = true;
+      return false;
+    }
+    payload = compressed;
+#endif  // HAVE_ZLIB
+  }
+
+  std::string header;
+  AppendFixed32(static_cast<uint32_t>(payload.size()), &header);
+  AppendFixed32(static_cast<uint32_t>(block_.size()), &header);
+  AppendFixed32(Crc32c(payload), &header);
+  header.push_back(static_cast<char>(options_.compression));
+
+  index_.push_back({offset_, block_first_record_});
+  block_first_record_ = num_records_;
+  failed_ = !WriteBytes(header) || !WriteBytes(payload);
+  // `payload` may point into the block.
+  block_.clear();
+  return !failed_;
+}
+
+bool RecordFileWriter::WriteBytes(absl::string_view bytes) {
+  io::CodedOutputStream output(output_);
+  output.WriteRaw(bytes.data(), static_cast<int>(bytes.size()));
+  offset_ += bytes.size();
+  return !output.HadError();
+}
+
+bool RecordFileWriter::Close() {
+  if (closed_) return !failed_;
+  if (!failed_) WriteBlock();
+  closed_ = true;
+  if (failed_) return false;
+
+  const uint64_t index_offset = offset_;
+  std::string index;
+  index.reserve(index_.size() * kIndexEntrySize);
+  for (const BlockInfo& block : index_) {
+    AppendFixed64(block.offset, &index);
+    AppendFixed64(static_cast<uint64_t>(block.first_record), &index);
+  }
+  std::string footer;
+  AppendFixed64(index_offset, &footer);
+  AppendFixed64(static_cast<uint64_t>(num_records_), &footer);
+  AppendFixed32(Crc32c(index), &footer);
+  AppendFixed32(kMagic, &footer);
+  failed_ = !WriteBytes(index) || !WriteBytes(footer);
+  return !failed_;
+}
+
+// ===================================================================
+
+std::unique_ptr<RecordFileReader> RecordFileReader::Open(
+    absl::string_view data) {
+  if (data.size() < kFooterSize) return nullptr;
+  const size_t index_end = data.size() - kFooterSize;
+  const char* footer = data.data() + index_end;
+  const uint64_t index_offset = ReadFixed64(footer);
+  const uint64_t num_records = ReadFixed64(footer + 8);
+  if (ReadFixed32(footer + 20) != kMagic || index_offset > index_end ||
+      (index_end - index_offset) % kIndexEntrySize != 0 ||
+      num_records > static_cast<uint64_t>(INT64_MAX)) {
+    return nullptr;
+  }
+  const absl::string_view index =
+      data.substr(index_offset, index_end - index_offset);
+  if (Crc32c(index) != ReadFixed32(footer + 16)) return nullptr;
+
+  // Every block holds at least one record and starts after the end of the
+  // previous block's header.
+  std::vector<BlockInfo> blocks(index.size() / kIndexEntrySize);
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    const char* entry = index.data() + i * kIndexEntrySize;
+    blocks[i].offset = ReadFixed64(entry);
+    blocks[i].first_record = static_cast<int64_t>(ReadFixed64(entry + 8));
+    const bool ordered =
+        i == 0 ? blocks[i].first_record == 0
+               : blocks[i].offset > blocks[i - 1].offset &&
+                     blocks[i].offset - blocks[i - 1].offset >=
+                         kBlockHeaderSize &&
+                     blocks[i].first_record > blocks[i - 1].first_record;
+    if (!ordered ||
+        blocks[i].first_record >= static_cast<int64_t>(num_records)) {
+      return nullptr;
+    }
+  }
+  if (blocks.empty() != (num_records == 0) ||
+      blocks.size() > static_cast<size_t>(INT_MAX)) {
+    return nullptr;
+  }
+  if (!blocks.empty() && (blocks.back().offset > index_offset ||
+                          index_offset - blocks.back().offset <
+                              kBlockHeaderSize)) {
+    return nullptr;
+  }
+  return std::unique_ptr<RecordFileReader>(new RecordFileReader(
+      data, index_offset, static_cast<int64_t>(num_records),
+      std::move(blocks)));
+}
+
+RecordFileReader::RecordFileReader(absl::string_view data,
+                                   uint64_t index_offset, int64_t num_records,
+                                   std::vector<BlockInfo> blocks)
+    : data_(data),
+      index_offset_(index_offset),
+      num_records_(num_records),
+      blocks_(std::move(blocks)) {}
+
+int RecordFileReader::FindBlock(int64_t index) const {
+  auto it = std::upper_bound(
+      blocks_.begin(), blocks_.end(), index,
+      [](int64_t i, const BlockInfo& block) { return i < block.first_record; });
+  return static_cast<int>(it - blocks_.begin()) - 1;
+}
+
+bool RecordFileReader::DecodeBlock(int block, std::string* scratch,
+                                   absl::string_view* records) const {
+  const uint64_t begin = blocks_[block].offset;
+  const uint64_t end = block + 1 < num_blocks() ? blocks_[block + 1].offset
+                                                : index_offset_;
+  // Open() checked that the header lies within the file.
+  const char* header = data_.data() + begin;
+  const uint32_t stored_size = ReadFixed32(header);
+  const uint32_t size = ReadFixed32(header + 4);
+  if (stored_size != end - begin - kBlockHeaderSize || size > INT_MAX) {
+    return false;
+  }
+  const absl::string_view payload =
+      data_.substr(begin + kBlockHeaderSize, stored_size);
+  if (Crc32c(payload) != ReadFixed32(header + 8)) return false;
+
+  switch (static_cast<uint8_t>(header[12])) {
+    case RecordFileWriter::NONE:
+      *records = payload;
+      return size == stored_size;
+    case RecordFileWriter::ZLIB: {
+#if HAVE_ZLIB
+      scratch->clear();
+      scratch->reserve(size);
+      io::ArrayInputStream input(payload.data(), static_cast<int>(stored_size));
+      io::GzipInputStream gzip_input(&input, io::GzipInputStream::ZLIB);
+      const void* buffer;
+      int buffer_size;
+      while (gzip_input.Next(&buffer, &buffer_size)) {
+        if (static_cast<size_t>(buffer_size) > size - scratch->size()) {
+          return false;
+        }
+        scratch->append(static_cast<const char*>(buffer), buffer_size);
+      }
+      *records = *scratch;
+      return scratch->size() == size;
+#else
+      (void)scratch;
+      return false;
+#endif  // HAVE_ZLIB
+    }
+  }
+  return false;
+}
+
+bool RecordFileReader::ForEachRecordInBlocks(int first_block, int last_block,
+                                             int64_t begin, int64_t end,
+                                             Callback callback) const {
+  std::string scratch;
+  for (int block = first_block; block <= last_block; ++block) {
+    absl::string_view records;
+    if (!DecodeBlock(block, &scratch, &records)) return false;
+    const int64_t block_end = block + 1 < num_blocks()
+                                  ? blocks_[block + 1].first_record
+                                  : num_records_;
+    io::CodedInputStream input(AsBytes(records.data()),
+                               static_cast<int>(records.size()));
+    for (int64_t i = blocks_[block].first_record; i < block_end; ++i) {
+      uint32_t size;
+      if (!input.ReadVarint32(&size) || size > INT_MAX) return false;
+      const int offset = input.CurrentPosition();
+      if (!input.Skip(static_cast<int>(size))) return false;
+      if (i >= begin && !callback(i, records.substr(offset, size))) {
+        return false;
+      }
+      if (i + 1 == end) return true;
+    }
+    if (!input.ExpectAtEnd()) return false;
+  }
+  return true;
+}
+
+bool RecordFileReader::ReadRecord(int64_t index, MessageLite* message) const {
+  return ForEachRecord(index, index + 1,
+                       [message](int64_t, absl::string_view record) {
+                         return message->ParseFromString(record);
+                       });
+}
+
+bool RecordFileReader::ForEachRecord(int64_t begin, int64_t end,
+                                     Callback callback) const {
+  ABSL_CHECK(0 <= begin && begin <= end && end <= num_records_)
+      << "Invalid record range [" << begin << ", " << end << ").";
+  if (begin == end) return true;
+  return ForEachRecordInBlocks(FindBlock(begin), FindBlock(end - 1), begin,
+                               end, callback);
+}
+
+bool RecordFileReader::ForEachRecordInParallel(int64_t begin, int64_t end,
+                                               int num_tasks,
+                                               ParallelExecutor executor,
+                                               Callback callback) const {
+  ABSL_CHECK(0 <= begin && begin <= end && end <= num_records_)
+      << "Invalid record range [" << begin << ", " << end << ").";
+  ABSL_CHECK_GT(num_tasks, 0);
+  if (begin == end) return true;
+
+  // Blocks hold roughly the same number of bytes, so split them evenly.
+  const int first_block = FindBlock(begin);
+  const int64_t count = FindBlock(end - 1) - first_block + 1;
+  const int64_t tasks = std::min<int64_t>(num_tasks, count);
+  std::atomic<bool> failed{false};
+  absl::BlockingCounter pending(static_cast<int>(tasks));
+  for (int64_t task = 0; task < tasks; ++task) {
+    const int task_first = first_block + static_cast<int>(count * task / tasks);
+    const int task_last =
+        first_block + static_cast<int>(count * (task + 1) / tasks) - 1;
+    executor([&, task_first, task_last] {
+      // Stop all tasks as soon as one of them fails.
+      if (!ForEachRecordInBlocks(
+              task_first, task_last, begin, end,
+              [&](int64_t index, absl::string_view record) {
+                return !failed.load(std::memory_order_relaxed) &&
+                       callback(index, record);
+              })) {
+        failed.store(true, std::memory_order_relaxed);
+      }
+      pending.DecrementCount();
+    });
+  }
+  pending.Wait();
+  return !failed.load(std::memory_order_relaxed);
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,190 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// A file format for large sequences of records, such as serialized messages,
+// that supports random access.
+//
+// Like the output of SerializeDelimitedToZeroCopyStream(), a record file
+// holds a sequence of size-delimited records, but they are grouped into
+// blocks that are followed by an index of the blocks.  Readers can thus find
+// any record by decoding a single block, and can split a file into ranges of
+// records decoded on separate threads without scanning it first.  Each block
+// carries a CRC-32C of its contents and may be compressed with zlib.
+//
+// The layout of a file, with all integers little-endian, is:
+//
+//   file   := block* index footer
+//   block  := stored_size:fixed32 size:fixed32 crc32c:fixed32
+//             compression:uint8 payload[stored_size]
+//   index  := (block_offset:fixed64 first_record:fixed64)*
+//   footer := index_offset:fixed64 num_records:fixed64
+//             index_crc32c:fixed32 magic:fixed32
+//
+// where the payload, once uncompressed to `size` bytes, is a sequence of
+// size-delimited records and the CRC-32C covers the stored payload.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_RECORD_FILE_H__
+#define GOOGLE_PROTOBUF_UTIL_RECORD_FILE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/util/parallel_message_util.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+class PROTOBUF_EXPORT RecordFileWriter {
+ public:
+  enum Compression {
+    NONE = 0,
+    // Requires protobuf to be built with zlib.
+    ZLIB = 1,
+  };
+
+  struct PROTOBUF_EXPORT Options {
+    // Records are collected into a block until it holds at least this many
+    // bytes.  Smaller blocks make random access cheaper, larger ones compress
+    // better.  Defaults to 64kB.
+    int block_size;
+
+    // Defaults to NONE.
+    Compression compression;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Writes a record file to `output`, which must outlive the writer.
+  explicit RecordFileWriter(io::ZeroCopyOutputStream* output);
+  RecordFileWriter(io::ZeroCopyOutputStream* output, const Options& options);
+  RecordFileWriter(const RecordFileWriter&) = delete;
+  RecordFileWriter& operator=(const RecordFileWriter&) = delete;
+
+  // Calls Close() if it has not been called yet.
+  ~RecordFileWriter();
+
+  // Appends `message` as the next record.  Returns false if writing to the
+  // underlying stream failed, or if the current block would exceed 2GB.
+  bool Write(const MessageLite& message);
+
+  // Appends the already serialized `record`.
+  bool WriteSerialized(absl::string_view record);
+
+  // Writes out the last block, the index and the footer.  The file is not
+  // readable until this has been called.  It is the caller's responsibility
+  // to flush and close the underlying stream if necessary.  Returns true if
+  // no error occurred at any point.
+  bool Close();
+
+  // The number of records written so far.
+  int64_t num_records() const { return num_records_; }
+
+ private:
+  struct BlockInfo {
+    uint64_t offset;
+    int64_t first_record;
+  };
+
+  // Appends a record of `size` bytes written by `write`.
+  bool AppendRecord(size_t size, absl::FunctionRef<void(uint8_t*)> write);
+  bool WriteBlock();
+  bool WriteBytes(absl::string_view bytes);
+
+  io::ZeroCopyOutputStream* output_;
+  const Options options_;
+  std::string block_;
+  int64_t num_records_ = 0;
+  int64_t block_first_record_ = 0;
+  uint64_t offset_ = 0;
+  std::vector<BlockInfo> index_;
+  bool closed_ = false;
+  bool failed_ = false;
+};
+
+// Reads records from a complete record file held in memory, for example in
+// a memory-mapped file.  All methods are const and may be called from
+// several threads at once.
+class PROTOBUF_EXPORT RecordFileReader {
+ public:
+  // Called with the index and contents of each record read.  Returning false
+  // stops reading.
+  using Callback =
+      absl::FunctionRef<bool(int64_t index, absl::string_view record)>;
+
+  // Returns null if `data` does not end with a valid index.  The blocks are
+  // only checked as they are read.  `data` must outlive the reader.
+  static std::unique_ptr<RecordFileReader> Open(absl::string_view data);
+
+  RecordFileReader(const RecordFileReader&) = delete;
+  RecordFileReader& operator=(const RecordFileReader&) = delete;
+
+  int64_t num_records() const { return num_records_; }
+  int num_blocks() const { return static_cast<int>(blocks_.size()); }
+
+  // Parses record `index`, which must be in [0, num_records()), decoding
+  // only the block containing it.  Returns false if that block is corrupt or
+  // the record does not parse.
+  bool ReadRecord(int64_t index, MessageLite* message) const;
+
+  // Calls `callback` on the records numbered [begin, end) in order, where
+  // 0 <= begin <= end <= num_records().  Returns false if a block is corrupt
+  // or the callback returned false.
+  bool ForEachRecord(int64_t begin, int64_t end, Callback callback) const;
+
+  // Like ForEachRecord(), but splits the blocks covering [begin, end) into
+  // at most `num_tasks` contiguous ranges which are decoded by tasks handed
+  // to `executor`.  `callback` is thus called concurrently, in order within
+  // each range but in no particular order across ranges.  Blocks until all
+  // tasks have finished.
+  bool ForEachRecordInParallel(int64_t begin, int64_t end, int num_tasks,
+                               ParallelExecutor executor,
+                               Callback callback) const;
+
+ private:
+  struct BlockInfo {
+    uint64_t offset;
+    int64_t first_record;
+  };
+
+  RecordFileReader(absl::string_view data, uint64_t index_offset,
+                   int64_t num_records, std::vector<BlockInfo> blocks);
+
+  // Returns the block containing record `index`.
+  int FindBlock(int64_t index) const;
+  // Sets `*records` to the uncompressed payload of `block`, decompressing
+  // into `scratch` if needed.
+  bool DecodeBlock(int block, std::string* scratch,
+                   absl::string_view* records) const;
+  // Calls `callback` on the records of the blocks [first_block, last_block]
+  // whose index is in [begin, end).
+  bool ForEachRecordInBlocks(int first_block, int last_block, int64_t begin,
+                             int64_t end, Callback callback) const;
+
+  const absl::string_view data_;
+  const uint64_t index_offset_;
+  const int64_t num_records_;
+  const std::vector<BlockInfo> blocks_;
+};
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_RECORD_FILE_H__
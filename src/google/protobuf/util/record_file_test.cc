@@ -0,0 +1,242 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/record_file.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+
+// Runs each task on its own thread; the threads are joined on destruction.
+class ThreadExecutor {
+ public:
+  ~ThreadExecutor() {
+    for (auto& thread : threads_) thread.join();
+  }
+
+  // ParallelExecutor invokes the executor through a const reference.
+  void operator()(std::function<void()> task) const {
+    threads_.emplace_back(std::move(task));
+  }
+
+ private:
+  mutable std::vector<std::thread> threads_;
+};
+
+TestAllTypes MakeRecord(int64_t i) {
+  TestAllTypes record;
+  record.set_optional_int64(i);
+  record.set_optional_string(absl::StrCat("record ", i));
+  return record;
+}
+
+std::string WriteRecords(int num_records,
+                         const RecordFileWriter::Options& options) {
+  std::string data;
+  io::StringOutputStream output(&data);
+  RecordFileWriter writer(&output, options);
+  for (int i = 0; i < num_records; ++i) {
+    EXPECT_TRUE(writer.Write(MakeRecord(i)));
+  }
+  EXPECT_EQ(writer.num_records(), num_records);
+  EXPECT_TRUE(writer.Close());
+  return data;
+}
+
+std::vector<RecordFileWriter::Options> AllOptions() {
+  std::vector<RecordFileWriter::Options> all;
+  for (int block_size : {1, 100, 4096, 1 << 20}) {
+    RecordFileWriter::Options options;
+    options.block_size = block_size;
+    all.push_back(options);
+#if HAVE_ZLIB
+    options.compression = RecordFileWriter::ZLIB;
+    all.push_back(options);
+#endif  // HAVE_ZLIB
+  }
+  return all;
+}
+
+TEST(RecordFileTest, ReadsAllRecords) {
+  for (const auto& options : AllOptions()) {
+    const std::string data = WriteRecords(1000, options);
+    auto reader = RecordFileReader::Open(data);
+    ASSERT_NE(reader, nullptr) << options.block_size;
+    EXPECT_EQ(reader->num_records(), 1000);
+
+    int64_t expected = 0;
+    EXPECT_TRUE(reader->ForEachRecord(
+        0, reader->num_records(), [&](int64_t index, absl::string_view record) {
+          EXPECT_EQ(index, expected);
+          EXPECT_EQ(record, MakeRecord(expected).SerializeAsString());
+          ++expected;
+          return true;
+        }));
+    EXPECT_EQ(expected, 1000);
+  }
+}
+
+TEST(RecordFileTest, ReadsRecordsAtRandom) {
+  for (const auto& options : AllOptions()) {
+    const std::string data = WriteRecords(1000, options);
+    auto reader = RecordFileReader::Open(data);
+    ASSERT_NE(reader, nullptr);
+    for (int64_t index : {999, 0, 500, 1, 998, 317}) {
+      TestAllTypes record;
+      ASSERT_TRUE(reader->ReadRecord(index, &record));
+      EXPECT_EQ(record.optional_int64(), index);
+    }
+  }
+}
+
+TEST(RecordFileTest, ReadsRanges) {
+  RecordFileWriter::Options options;
+  options.block_size = 256;
+  const std::string data = WriteRecords(1000, options);
+  auto reader = RecordFileReader::Open(data);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_GT(reader->num_blocks(), 10);
+
+  for (auto range : std::vector<std::pair<int64_t, int64_t>>{
+           {0, 0}, {10, 11}, {123, 456}, {999, 1000}, {0, 1000}}) {
+    std::vector<int64_t> indices;
+    EXPECT_TRUE(reader->ForEachRecord(
+        range.first, range.second, [&](int64_t index, absl::string_view) {
+          indices.push_back(index);
+          return true;
+        }));
+    ASSERT_EQ(static_cast<int64_t>(indices.size()), range.second - range.first);
+    for (size_t i = 0; i < indices.size(); ++i) {
+      EXPECT_EQ(indices[i], range.first + static_cast<int64_t>(i));
+    }
+  }
+}
+
+TEST(RecordFileTest, ReadsInParallel) {
+  for (const auto& options : AllOptions()) {
+    const std::string data = WriteRecords(1000, options);
+    auto reader = RecordFileReader::Open(data);
+    ASSERT_NE(reader, nullptr);
+
+    for (int num_tasks : {1, 3, 64}) {
+      std::vector<std::string> records(1000);
+      {
+        ThreadExecutor executor;
+        EXPECT_TRUE(reader->ForEachRecordInParallel(
+            100, 900, num_tasks, executor,
+            [&](int64_t index, absl::string_view record) {
+              records[index] = std::string(record);
+              return true;
+            }));
+      }
+      for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(records[i], i < 100 || i >= 900
+                                  ? ""
+                                  : MakeRecord(i).SerializeAsString())
+            << i;
+      }
+    }
+  }
+}
+
+TEST(RecordFileTest, StopsWhenCallbackFails) {
+  const std::string data = WriteRecords(100, RecordFileWriter::Options());
+  auto reader = RecordFileReader::Open(data);
+  ASSERT_NE(reader, nullptr);
+  int calls = 0;
+  EXPECT_FALSE(reader->ForEachRecord(0, 100, [&](int64_t index,
+                                                 absl::string_view) {
+    ++calls;
+    return index < 10;
+  }));
+  EXPECT_EQ(calls, 11);
+}
+
+TEST(RecordFileTest, WritesSerializedRecords) {
+  std::string data;
+  {
+    io::StringOutputStream output(&data);
+    RecordFileWriter writer(&output);
+    EXPECT_TRUE(writer.WriteSerialized("foo"));
+    EXPECT_TRUE(writer.WriteSerialized(""));
+    EXPECT_TRUE(writer.WriteSerialized(std::string(100000, 'x')));
+  }
+  auto reader = RecordFileReader::Open(data);
+  ASSERT_NE(reader, nullptr);
+  std::vector<std::string> records;
+  EXPECT_TRUE(reader->ForEachRecord(0, reader->num_records(),
+                                    [&](int64_t, absl::string_view record) {
+                                      records.emplace_back(record);
+                                      return true;
+                                    }));
+  EXPECT_EQ(records,
+            std::vector<std::string>({"foo", "", std::string(100000, 'x')}));
+}
+
+TEST(RecordFileTest, EmptyFile) {
+  const std::string data = WriteRecords(0, RecordFileWriter::Options());
+  auto reader = RecordFileReader::Open(data);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(reader->num_records(), 0);
+  EXPECT_EQ(reader->num_blocks(), 0);
+  EXPECT_TRUE(reader->ForEachRecord(
+      0, 0, [](int64_t, absl::string_view) { return false; }));
+}
+
+TEST(RecordFileTest, RejectsBadIndex) {
+  const std::string data = WriteRecords(100, RecordFileWriter::Options());
+  EXPECT_EQ(RecordFileReader::Open(""), nullptr);
+  EXPECT_EQ(RecordFileReader::Open(data.substr(0, data.size() - 1)), nullptr);
+  EXPECT_EQ(RecordFileReader::Open(data + "x"), nullptr);
+
+  // The index is covered by its checksum.
+  std::string corrupt = data;
+  corrupt[corrupt.size() - 30] ^= 1;
+  EXPECT_EQ(RecordFileReader::Open(corrupt), nullptr);
+}
+
+TEST(RecordFileTest, DetectsCorruptBlock) {
+  for (const auto& options : AllOptions()) {
+    if (options.block_size != 100) continue;
+    std::string data = WriteRecords(100, options);
+    // Corrupt a byte in the first block's payload.
+    data[20] ^= 1;
+    auto reader = RecordFileReader::Open(data);
+    ASSERT_NE(reader, nullptr);
+
+    TestAllTypes record;
+    EXPECT_FALSE(reader->ReadRecord(0, &record));
+    EXPECT_TRUE(reader->ReadRecord(99, &record));
+    EXPECT_EQ(record.optional_int64(), 99);
+    ThreadExecutor executor;
+    EXPECT_FALSE(reader->ForEachRecordInParallel(
+        0, 100, 4, executor,
+        [](int64_t, absl::string_view) { return true; }));
+  }
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
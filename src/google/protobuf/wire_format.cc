@@ -1685,17 +1685,31 @@ size_t WireFormat::FieldDataOnlyByteSize(const FieldDescriptor* field,
     }                                                                       \
     break;
 
+// Repeated varint fields are sized in bulk over the underlying RepeatedField,
+// which uses the vectorized kernels in WireFormatLite.
+#define HANDLE_VARINT_TYPE(TYPE, TYPE_METHOD, CPPTYPE_METHOD, CPPTYPE)      \
+  case FieldDescriptor::TYPE_##TYPE:                                        \
+    if (field->is_repeated()) {                                             \
+      data_size += WireFormatLite::TYPE_METHOD##Size(                       \
+          message_reflection->GetRepeatedFieldInternal<CPPTYPE>(message,    \
+                                                                field));    \
+    } else {                                                                \
+      data_size += WireFormatLite::TYPE_METHOD##Size(                       \
+          message_reflection->Get##CPPTYPE_METHOD(message, field));         \
+    }                                                                       \
+    break;
+
 #define HANDLE_FIXED_TYPE(TYPE, TYPE_METHOD)                   \
   case FieldDescriptor::TYPE_##TYPE:                           \
     data_size += count * WireFormatLite::k##TYPE_METHOD##Size; \
     break;
 
-    HANDLE_TYPE(INT32, Int32, Int32)
-    HANDLE_TYPE(INT64, Int64, Int64)
-    HANDLE_TYPE(SINT32, SInt32, Int32)
-    HANDLE_TYPE(SINT64, SInt64, Int64)
-    HANDLE_TYPE(UINT32, UInt32, UInt32)
-    HANDLE_TYPE(UINT64, UInt64, UInt64)
+    HANDLE_VARINT_TYPE(INT32, Int32, Int32, int32_t)
+    HANDLE_VARINT_TYPE(INT64, Int64, Int64, int64_t)
+    HANDLE_VARINT_TYPE(SINT32, SInt32, Int32, int32_t)
+    HANDLE_VARINT_TYPE(SINT64, SInt64, Int64, int64_t)
+    HANDLE_VARINT_TYPE(UINT32, UInt32, UInt32, uint32_t)
+    HANDLE_VARINT_TYPE(UINT64, UInt64, UInt64, uint64_t)
 
     HANDLE_FIXED_TYPE(FIXED32, Fixed32)
     HANDLE_FIXED_TYPE(FIXED64, Fixed64)
@@ -1729,14 +1743,13 @@ size_t WireFormat::FieldDataOnlyByteSize(const FieldDescriptor* field,
     }
 
 #undef HANDLE_TYPE
+#undef HANDLE_VARINT_TYPE
 #undef HANDLE_FIXED_TYPE
 
     case FieldDescriptor::TYPE_ENUM: {
       if (field->is_repeated()) {
-        for (size_t j = 0; j < count; j++) {
-          data_size += WireFormatLite::EnumSize(
-              message_reflection->GetRepeatedEnum(message, field, j)->number());
-        }
+        data_size += WireFormatLite::EnumSize(
+            message_reflection->GetRepeatedFieldInternal<int>(message, field));
       } else {
         data_size += WireFormatLite::EnumSize(
             message_reflection->GetEnum(message, field)->number());